@@ -6,23 +6,30 @@
 #include "poisson2d.h"
 
 /**
- * @brief Initializes grid arrays with a default value.
+ * @brief Evaluates the analytical solution of the Poisson problem.
  *
- * Sets all elements in the grid arrays to an initial junk value.
+ * The problem is set up so that u(x,y)=y/((1+x)^2+y^2) solves it exactly; this
+ * is used both for the Dirichlet boundary conditions and for checking the
+ * numerical solution.
  *
- * @param[out] a Grid array for current solution iteration.
- * @param[out] b Grid array for next solution iteration.
- * @param[out] f Grid array for right-hand side function values.
+ * @param[in] x Physical x-coordinate.
+ * @param[in] y Physical y-coordinate.
+ *
+ * @returns The value of the analytical solution at (x, y).
  */
-void init_full_grids(double a[][maxn], double b[][maxn], double f[][maxn]);
+double analytical2d(double x, double y);
 
 /**
  * @brief Initializes the local grid portion with boundary conditions.
  *
  * Sets up the local portion of the grid assigned to a process, including ghost
  * cells and boundary conditions. Interior points are set to zero. Sets the
- * appropriate Dirichlet boundary conditions for the Poisson problem.
+ * appropriate Dirichlet boundary conditions for the Poisson problem, including
+ * the corner ghost cells that lie on the boundary. The grid spacing is
+ * h = 1/(nx+1) in both directions, so the domain is [0,1] x [0,(ny+1)h].
  *
+ * @param[in]  lnx   Number of local interior grid points in x-axis.
+ * @param[in]  lny   Number of local interior grid points in y-axis.
  * @param[out] a     Grid array for current solution iteration.
  * @param[out] b     Grid array for next solution iteration.
  * @param[out] f     Grid array for right-hand side function values.
@@ -33,6 +40,6 @@ void init_full_grids(double a[][maxn], double b[][maxn], double f[][maxn]);
  * @param[in]  col_s Starting column index of local domain.
  * @param[in]  col_e Ending column index of local domain.
  */
-void init_twod(double a[][maxn], double b[][maxn], double f[][maxn], int nx,
-               int ny __attribute__((unused)), int row_s, int row_e, int col_s,
-               int col_e);
+void init_twod(int lnx, int lny, double a[][lny + 2], double b[][lny + 2],
+               double f[][lny + 2], int nx, int ny, int row_s, int row_e,
+               int col_s, int col_e);
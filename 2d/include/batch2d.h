@@ -0,0 +1,172 @@
+/**
+ * @file  batch2d.h
+ * @brief Batched solves of several right-hand sides with the same operator.
+ *
+ * The k fields of a batch are stored interleaved, with the field fastest, as
+ * x[i][j][m], so that a sweep updates all fields of a point together in
+ * contiguous, vectorisable memory, and a single halo message per direction
+ * carries the ghost cells of every field. Each field is checked for
+ * convergence on its own and is left unchanged once it has converged.
+ *
+ * Field m solves the Poisson equation with u_m(x,y) = y/((1+m/2+x)^2+y^2) +
+ * m(x^2+y^2)/4 as its exact solution, i.e., with f_m = m and the matching
+ * Dirichlet boundary conditions; field 0 is the problem of the unbatched
+ * solver.
+ */
+
+#ifndef BATCH2D_H
+#define BATCH2D_H
+
+#include <mpi.h>
+
+/**
+ * @brief Evaluates the exact solution of a field of the batch.
+ *
+ * @param[in] m Field of the batch.
+ * @param[in] x Physical x-coordinate.
+ * @param[in] y Physical y-coordinate.
+ *
+ * @returns The value of the exact solution of field m at (x, y).
+ */
+double analytical2d_batch(int m, double x, double y);
+
+/**
+ * @brief Initializes the local grid portion of every field of a batch with
+ *        its right-hand side and boundary conditions.
+ *
+ * Interior points are set to zero as in init_twod.
+ *
+ * @param[in]  lnx   Number of local interior grid points in x-axis.
+ * @param[in]  lny   Number of local interior grid points in y-axis.
+ * @param[in]  k     Number of fields in the batch.
+ * @param[out] a     Grid array for current solution iteration.
+ * @param[out] b     Grid array for next solution iteration.
+ * @param[out] f     Grid array for right-hand side function values.
+ * @param[in]  nx    Number of interior grid points in x-axis.
+ * @param[in]  ny    Number of interior grid points in y-axis.
+ * @param[in]  row_s Starting row index of local domain.
+ * @param[in]  row_e Ending row index of local domain.
+ * @param[in]  col_s Starting column index of local domain.
+ * @param[in]  col_e Ending column index of local domain.
+ */
+void init_batch2d(int lnx, int lny, int k, double a[][lny + 2][k],
+                  double b[][lny + 2][k], double f[][lny + 2][k], int nx,
+                  int ny, int row_s, int row_e, int col_s, int col_e);
+
+/**
+ * @brief Exchanges the ghost cells of every field of a batch with
+ *        neighboring processes using non-blocking communication.
+ *
+ * The columns of all fields are contiguous in memory; the rows are described
+ * by row_type, so that each direction takes one message for the whole batch.
+ *
+ * @param[in]     lnx      Number of local interior grid points in x-axis.
+ * @param[in]     lny      Number of local interior grid points in y-axis.
+ * @param[in]     k        Number of fields in the batch.
+ * @param[in,out] x        Grid array to exchange ghost cells for.
+ * @param[in]     comm     MPI communicator.
+ * @param[in]     nbrleft  Rank of the left neighboring process.
+ * @param[in]     nbrright Rank of the right neighboring process.
+ * @param[in]     nbrup    Rank of the upper neighboring process.
+ * @param[in]     nbrdown  Rank of the lower neighboring process.
+ * @param[in]     row_type MPI datatype for a row of lnx points of k fields.
+ */
+void exchang2d_batch(int lnx, int lny, int k, double x[][lny + 2][k],
+                     MPI_Comm comm, int nbrleft, int nbrright, int nbrup,
+                     int nbrdown, MPI_Datatype row_type);
+
+/**
+ * @brief Performs one Jacobi iteration step on every field of a batch.
+ *
+ * Fields that are no longer active are copied unchanged from a to b.
+ *
+ * @param[in]  lnx    Number of local interior grid points in x-axis.
+ * @param[in]  lny    Number of local interior grid points in y-axis.
+ * @param[in]  k      Number of fields in the batch.
+ * @param[in]  a      Current iteration grid array.
+ * @param[in]  f      Right-hand side function values.
+ * @param[in]  h      Grid spacing.
+ * @param[in]  active Whether each field is still being iterated.
+ * @param[out] b      Next iteration grid array to store the updated values.
+ */
+void sweep2d_batch(int lnx, int lny, int k, double a[][lny + 2][k],
+                   double f[][lny + 2][k], double h, const int* active,
+                   double b[][lny + 2][k]);
+
+/**
+ * @brief Computes the local sum of squared differences between two grid
+ *        arrays for every field of a batch.
+ *
+ * @param[in]  lnx  Number of local interior grid points in x-axis.
+ * @param[in]  lny  Number of local interior grid points in y-axis.
+ * @param[in]  k    Number of fields in the batch.
+ * @param[in]  a    First grid array.
+ * @param[in]  b    Second grid array.
+ * @param[out] diff Sum of squared differences of each field.
+ */
+void griddiff2d_batch(int lnx, int lny, int k, double a[][lny + 2][k],
+                      double b[][lny + 2][k], double* diff);
+
+/**
+ * @brief Iterates a batch of k problems on the local domains of a Cartesian
+ *        communicator until every field has converged.
+ *
+ * All results are returned on every process of comm.
+ *
+ * @param[in]  nx        Number of interior grid points in x-axis.
+ * @param[in]  ny        Number of interior grid points in y-axis.
+ * @param[in]  k         Number of fields in the batch.
+ * @param[in]  row_s     Starting row index of local domain.
+ * @param[in]  row_e     Ending row index of local domain.
+ * @param[in]  col_s     Starting column index of local domain.
+ * @param[in]  col_e     Ending column index of local domain.
+ * @param[in]  nbrleft   Rank of the left neighboring process.
+ * @param[in]  nbrright  Rank of the right neighboring process.
+ * @param[in]  nbrup     Rank of the upper neighboring process.
+ * @param[in]  nbrdown   Rank of the lower neighboring process.
+ * @param[in]  niter     Maximum number of iterations.
+ * @param[in]  tol       Convergence tolerance of the global difference.
+ * @param[in]  comm      Cartesian MPI communicator.
+ * @param[out] iters     Iterations each field took; niter if it did not
+ *                       converge.
+ * @param[out] diff      Global difference of each field when it stopped.
+ * @param[out] max_error Maximum error of each field against its exact
+ *                       solution.
+ * @param[out] avg_error Average error of each field over the interior.
+ *
+ * @returns Number of iterations run, i.e., the largest of iters.
+ */
+int iterate_batch2d(int nx, int ny, int k, int row_s, int row_e, int col_s,
+                    int col_e, int nbrleft, int nbrright, int nbrup,
+                    int nbrdown, int niter, double tol, MPI_Comm comm,
+                    int* iters, double* diff, double* max_error,
+                    double* avg_error);
+
+/**
+ * @brief Solves a batch of k problems on the local domains of a Cartesian
+ *        communicator and reports each of them.
+ *
+ * The root process prints, for every field, the number of iterations it took
+ * to converge, its final global difference and its maximum and average error
+ * against the exact solution. No grid files are written.
+ *
+ * @param[in] nx       Number of interior grid points in x-axis.
+ * @param[in] ny       Number of interior grid points in y-axis.
+ * @param[in] k        Number of fields in the batch.
+ * @param[in] row_s    Starting row index of local domain.
+ * @param[in] row_e    Ending row index of local domain.
+ * @param[in] col_s    Starting column index of local domain.
+ * @param[in] col_e    Ending column index of local domain.
+ * @param[in] nbrleft  Rank of the left neighboring process.
+ * @param[in] nbrright Rank of the right neighboring process.
+ * @param[in] nbrup    Rank of the upper neighboring process.
+ * @param[in] nbrdown  Rank of the lower neighboring process.
+ * @param[in] niter    Maximum number of iterations.
+ * @param[in] tol      Convergence tolerance of the global difference.
+ * @param[in] comm     Cartesian MPI communicator.
+ */
+void solve_batch2d(int nx, int ny, int k, int row_s, int row_e, int col_s,
+                   int col_e, int nbrleft, int nbrright, int nbrup,
+                   int nbrdown, int niter, double tol, MPI_Comm comm);
+
+#endif
@@ -0,0 +1,116 @@
+/**
+ * @file  checkpoint.h
+ * @brief Checkpointing and restarting of the 2D solver state.
+ *
+ * A checkpoint is a global grid file in the binary format of gridfile.h whose
+ * header records the number of completed iterations and the last global
+ * difference. As it holds the global grid rather than the local blocks, a run
+ * can be restarted with any number of processes.
+ */
+
+#include "gridfile.h"
+#include "poisson2d.h"
+
+/**
+ * @brief State of the checkpoints written by one process.
+ *
+ * The local interior is copied into buf so that the solver can carry on
+ * while the collective write of the copy is in progress.
+ */
+typedef struct {
+  char         filename[256]; // Name of the checkpoint file
+  char         tmpname[264];  // Name the file is written under until complete
+  MPI_Datatype filetype;      // Position of the local block in the file
+  MPI_File     fh;            // File being written
+  MPI_Request  req;           // Pending collective write
+  double*      buf;           // Copy of the local interior
+  grid_header  hdr;           // Header written by the root process
+  int          active;        // Whether a checkpoint is being written
+  int          err;           // Error of starting the checkpoint being written
+  double       time;          // Time spent in checkpoint calls
+} checkpoint;
+
+/**
+ * @brief Prepares the checkpoint state of a process.
+ *
+ * @param[out] ck       Checkpoint state.
+ * @param[in]  filename Base name of the checkpoint file; ".bin" is appended.
+ * @param[in]  nx       Number of interior grid points in x-axis.
+ * @param[in]  ny       Number of interior grid points in y-axis.
+ * @param[in]  lnx      Number of local interior grid points in x-axis.
+ * @param[in]  lny      Number of local interior grid points in y-axis.
+ * @param[in]  row_s    Starting row index of local domain.
+ * @param[in]  col_s    Starting column index of local domain.
+ */
+void checkpoint_init(checkpoint* ck, const char* filename, int nx, int ny,
+                     int lnx, int lny, int row_s, int col_s);
+
+/**
+ * @brief Starts writing a checkpoint of the local grid.
+ *
+ * Any previous checkpoint is completed first. The interior of a is copied
+ * and written with MPI_File_iwrite_all where the MPI library provides it (MPI
+ * 3.1 and later), or with MPI_File_write_all otherwise. The file is written
+ * under a temporary name and only renamed once complete, so that a run which
+ * is killed while writing leaves the previous checkpoint intact.
+ *
+ * @param[in,out] ck       Checkpoint state.
+ * @param[in]     lnx      Number of local interior grid points in x-axis.
+ * @param[in]     lny      Number of local interior grid points in y-axis.
+ * @param[in]     a        Local grid array to save.
+ * @param[in]     h        Grid spacing.
+ * @param[in]     it       Number of completed iterations.
+ * @param[in]     residual Global difference of the last iteration.
+ * @param[in]     comm     MPI communicator.
+ *
+ * @returns MPI_SUCCESS on success, or the error code of the failing MPI-IO
+ *          call.
+ */
+int checkpoint_start(checkpoint* ck, int lnx, int lny, double a[][lny + 2],
+                     double h, int it, double residual, MPI_Comm comm);
+
+/**
+ * @brief Waits for the checkpoint being written, if any, to complete.
+ *
+ * The temporary file only replaces the previous checkpoint if every process
+ * started and completed its part of the write.
+ *
+ * @param[in,out] ck   Checkpoint state.
+ * @param[in]     comm MPI communicator.
+ *
+ * @returns MPI_SUCCESS on success, or MPI_ERR_IO if the checkpoint could not
+ *          be written or renamed (on all processes).
+ */
+int checkpoint_finish(checkpoint* ck, MPI_Comm comm);
+
+/**
+ * @brief Releases the checkpoint state; checkpoint_finish must be called
+ *        first.
+ *
+ * @param[in,out] ck Checkpoint state.
+ */
+void checkpoint_free(checkpoint* ck);
+
+/**
+ * @brief Restores the local grid from a checkpoint.
+ *
+ * The file may have been written with any number of processes, as only the
+ * block of the calling process is read from the global grid.
+ *
+ * @param[in]  filename Full name of the checkpoint file.
+ * @param[in]  nx       Number of interior grid points in x-axis.
+ * @param[in]  ny       Number of interior grid points in y-axis.
+ * @param[in]  lnx      Number of local interior grid points in x-axis.
+ * @param[in]  lny      Number of local interior grid points in y-axis.
+ * @param[out] a        Local grid array whose interior is restored.
+ * @param[in]  row_s    Starting row index of local domain.
+ * @param[in]  col_s    Starting column index of local domain.
+ * @param[out] it       Number of iterations completed before the checkpoint.
+ * @param[out] residual Global difference at the checkpoint.
+ * @param[in]  comm     MPI communicator.
+ *
+ * @returns 0 on success, non-zero on error (on all processes).
+ */
+int checkpoint_read(const char* filename, int nx, int ny, int lnx, int lny,
+                    double a[][lny + 2], int row_s, int col_s, int* it,
+                    double* residual, MPI_Comm comm);
@@ -0,0 +1,87 @@
+/**
+ * @file  compress.h
+ * @brief Error-bounded lossy compression of 2D grids.
+ *
+ * Every point of a block is predicted from its already reconstructed
+ * neighbours on the left, below and below-left (the 2D Lorenzo predictor),
+ * and the prediction error is quantised in steps of 2 * tol, so that every
+ * reconstructed value is within tol of the original. The quantisation codes,
+ * which are mostly zero for smooth solutions, are then entropy coded with an
+ * adaptive binary range coder. Points that cannot be predicted within the
+ * bound are stored exactly.
+ *
+ * A compressed grid file starts with a zgrid_header and holds one or more
+ * blocks, each a zgrid_block followed by its compressed data, in any order.
+ */
+
+#ifndef COMPRESS_H
+#define COMPRESS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ZGRID_MAGIC "P2DZGRD" // Including the terminating '\0'
+#define ZGRID_VERSION 1
+
+/**
+ * @brief Header of a compressed grid file; 64 bytes without padding.
+ */
+typedef struct {
+  char     magic[8]; // ZGRID_MAGIC
+  uint32_t order;    // GRID_ORDER as written by the host
+  int32_t  version;  // ZGRID_VERSION
+  int32_t  nx;       // Number of interior columns of the global grid
+  int32_t  ny;       // Number of interior rows of the global grid
+  int32_t  it;       // Number of iterations carried out
+  int32_t  nblocks;  // Number of blocks following the header
+  double   h;        // Grid spacing
+  double   residual; // Global difference of the last iteration
+  double   tol;      // Absolute error bound
+} zgrid_header;
+
+/**
+ * @brief Header of one compressed block; 24 bytes without padding.
+ */
+typedef struct {
+  int32_t  col_s;  // Global index of the first column
+  int32_t  row_s;  // Global index of the first row
+  int32_t  nx;     // Number of columns in the block
+  int32_t  ny;     // Number of rows in the block
+  uint64_t nbytes; // Size of the compressed data following this header
+} zgrid_block;
+
+/**
+ * @brief Compresses the interior of a grid to within an absolute error bound.
+ *
+ * @param[in]  lnx Number of interior grid points in x-axis.
+ * @param[in]  lny Number of interior grid points in y-axis.
+ * @param[in]  a   Grid array containing the data to compress.
+ * @param[in]  tol Absolute error bound; must be positive.
+ * @param[out] out Newly allocated buffer with the compressed data, which the
+ *                 caller must free.
+ *
+ * @returns Size of the compressed data in bytes.
+ */
+size_t compress_grid(int lnx, int lny, double a[][lny + 2], double tol,
+                     unsigned char** out);
+
+/**
+ * @brief Decompresses data made by compress_grid.
+ *
+ * Value (i, j), counted from 0, is stored in first[i * col_stride + j].
+ *
+ * @param[in]  in         Compressed data.
+ * @param[in]  len        Size of the compressed data in bytes.
+ * @param[in]  nx         Number of columns in the block.
+ * @param[in]  ny         Number of rows in the block.
+ * @param[in]  tol        Absolute error bound used for compression.
+ * @param[out] first      Where to store the value in the first column and
+ *                        bottom row.
+ * @param[in]  col_stride Distance between consecutive columns in memory.
+ *
+ * @returns 0 on success, non-zero if the data is truncated.
+ */
+int decompress_grid(const unsigned char* in, size_t len, int nx, int ny,
+                    double tol, double* first, size_t col_stride);
+
+#endif
@@ -0,0 +1,51 @@
+/**
+ * @file  ensemble2d.h
+ * @brief Ensembles of independent solves shared out among groups of
+ *        processes.
+ *
+ * A single job splits its processes into groups with MPI_Comm_split, each of
+ * which solves one problem of a task list at a time on a Cartesian
+ * communicator of its own. Tasks are handed out dynamically: whenever a
+ * group is idle, its leader takes the next task from a counter held by the
+ * root process with MPI_Fetch_and_op, so that groups that draw small
+ * problems simply solve more of them.
+ */
+
+#ifndef ENSEMBLE2D_H
+#define ENSEMBLE2D_H
+
+#include <mpi.h>
+
+/**
+ * @brief Reads a task list of grid sizes from a text file.
+ *
+ * Every line holds nx and optionally ny, which defaults to nx; blank lines
+ * and lines starting with # are skipped.
+ *
+ * @param[in]  filename Path to the task list.
+ * @param[out] sizes    Newly allocated array of nx and ny of every task.
+ *
+ * @returns Number of tasks, or -1 if the file cannot be read or holds an
+ *          invalid line.
+ */
+int read_tasks2d(const char* filename, int** sizes);
+
+/**
+ * @brief Solves every task of a task list with groups of processes.
+ *
+ * The processes of comm are split into ngroups groups of consecutive ranks,
+ * so that a group tends to share a node. Every task solves the problem of
+ * the unbatched solver on its grid, using the kernels of batch2d.h. The root
+ * process prints the result of every task, with the group that solved it,
+ * and how busy each group was, and writes the results to a CSV file.
+ *
+ * @param[in] filename Path to the task list.
+ * @param[in] ngroups  Number of groups.
+ * @param[in] niter    Maximum number of iterations of every task.
+ * @param[in] tol      Convergence tolerance of every task.
+ * @param[in] comm     MPI communicator of all processes.
+ */
+void run_ensemble2d(const char* filename, int ngroups, int niter, double tol,
+                    MPI_Comm comm);
+
+#endif
@@ -3,6 +3,8 @@
  * @brief Utility functions for collecting and writing distributed 2D grid data.
  */
 
+#include "compress.h"
+#include "gridfile.h"
 #include "poisson2d.h"
 
 /**
@@ -10,50 +12,104 @@
  *        process.
  *
  * Collects 2D grid sections from all MPI processes and combines them into a
- * complete global grid on the root process.
+ * complete global grid on the root process. The root computes the bounds of
+ * every process itself from its Cartesian coordinates, and the interior of
+ * each local grid is moved in a single MPI_Alltoallw, described on both sides
+ * by subarray datatypes so that no packing is needed.
  *
- * @param[out] global_grid Array to store the complete gathered grid (only used
- *                         by root process).
- * @param[in]  a           Local grid array containing this process's portion of
- *                         the solution.
- * @param[in]  row_s       Starting row index of local domain.
- * @param[in]  row_e       Ending row index of local domain.
- * @param[in]  col_s       Starting column index of local domain.
- * @param[in]  col_e       Ending column index of local domain.
  * @param[in]  nx          Number of interior grid points in x-axis.
  * @param[in]  ny          Number of interior grid points in y-axis.
+ * @param[out] global_grid Array of size (nx + 2) x (ny + 2) to store the
+ *                         complete gathered grid (only used by root process).
+ * @param[in]  lnx         Number of local interior grid points in x-axis.
+ * @param[in]  lny         Number of local interior grid points in y-axis.
+ * @param[in]  a           Local grid array containing this process's portion of
+ *                         the solution.
  * @param[in]  myid        Rank of the current MPI process.
  * @param[in]  nprocs      Total number of MPI processes.
- * @param[in]  row_s_vals  Array containing start row indices for all processes.
- * @param[in]  row_e_vals  Array containing end row indices for all processes.
- * @param[in]  col_s_vals  Array containing start column indices for all
- *                         processes.
- * @param[in]  col_e_vals  Array containing end column indices for all
- *                         processes.
- * @param[in]  comm        MPI communicator.
+ * @param[in]  dims        Array containing the dimensions of the 2D process
+ *                         grid.
+ * @param[in]  row_w       Weight of each process row as passed to
+ *                         MPE_Decomp2d_weighted, or NULL if the domain was
+ *                         split with MPE_Decomp2d.
+ * @param[in]  col_w       Weight of each process column, or NULL.
+ * @param[in]  comm        2D Cartesian communicator.
  */
-void GatherGrid2D(double global_grid[][maxn], double a[][maxn], int row_s,
-                  int row_e, int col_s, int col_e, int nx, int ny, int myid,
-                  int nprocs, int* row_s_vals, int* row_e_vals, int* col_s_vals,
-                  int* col_e_vals, MPI_Comm comm);
+void GatherGrid2D(int nx, int ny, double global_grid[][ny + 2], int lnx,
+                  int lny, double a[][lny + 2], int myid, int nprocs, int* dims,
+                  double* row_w, double* col_w, MPI_Comm comm);
 
 /**
  * @brief Writes 2D grid data to a file or terminal for visualization.
  *
+ * Only the interior points of the grid are written, i.e., the ghost cells (or,
+ * for a global grid, the boundary) are skipped.
+ *
  * @param[in] filename        Base name of the file to write.
+ * @param[in] lnx             Number of interior grid points in x-axis.
+ * @param[in] lny             Number of interior grid points in y-axis.
  * @param[in] a               Grid array containing the data to write.
- * @param[in] nx              Number of interior grid points in x-axis.
- * @param[in] ny              Number of interior grid points in y-axis.
  * @param[in] rank            Rank of the current MPI process.
- * @param[in] row_s           Starting row index of the grid portion to write.
- * @param[in] row_e           Ending row index of the grid portion to write.
- * @param[in] col_s           Starting column index of the grid portion to
- *                            write.
- * @param[in] col_e           Ending column index of the grid portion to write.
  * @param[in] write_to_stdout Flag to control whether to also print grid to
  *                            standard output.
  */
-void write_grid(char* filename, double a[][maxn],
-                int nx __attribute__((unused)), int ny __attribute__((unused)),
-                int rank, int row_s, int row_e, int col_s, int col_e,
-                int write_to_stdout);
+void write_grid(char* filename, int lnx, int lny, double a[][lny + 2],
+                int rank, int write_to_stdout);
+
+/**
+ * @brief Writes the distributed 2D grid into a single binary file using
+ *        collective MPI-IO.
+ *
+ * Every process sets a file view describing where its block lies in the
+ * global interior and writes the block straight from its local array with
+ * MPI_File_write_all, so that no process ever holds the whole grid. The file
+ * contains the nx x ny interior as native doubles, indexed as [column][row]
+ * like the in-memory grids, i.e., the row (y) index varies fastest.
+ *
+ * @param[in] filename Base name of the file to write.
+ * @param[in] nx       Number of interior grid points in x-axis.
+ * @param[in] ny       Number of interior grid points in y-axis.
+ * @param[in] lnx      Number of local interior grid points in x-axis.
+ * @param[in] lny      Number of local interior grid points in y-axis.
+ * @param[in] a        Local grid array containing this process's portion of
+ *                     the solution.
+ * @param[in] row_s    Starting row index of local domain.
+ * @param[in] col_s    Starting column index of local domain.
+ * @param[in] hdr      Header of the global grid, identical on all processes.
+ * @param[in] comm     MPI communicator.
+ *
+ * @returns MPI_SUCCESS on success, or the error code of the failing MPI-IO
+ *          call.
+ */
+int write_grid_mpiio(char* filename, int nx, int ny, int lnx, int lny,
+                     double a[][lny + 2], int row_s, int col_s,
+                     const grid_header* hdr, MPI_Comm comm);
+
+/**
+ * @brief Writes the distributed 2D grid into a single compressed file using
+ *        MPI-IO.
+ *
+ * Every process compresses its own block with compress_grid, the offsets of
+ * the compressed blocks are found with MPI_Exscan, and the blocks are written
+ * with MPI_File_write_at_all after the zgrid_header written by the root
+ * process.
+ *
+ * @param[in]  filename Base name of the file to write; ".zgrid" is appended.
+ * @param[in]  lnx      Number of local interior grid points in x-axis.
+ * @param[in]  lny      Number of local interior grid points in y-axis.
+ * @param[in]  a        Local grid array containing this process's portion of
+ *                      the solution.
+ * @param[in]  row_s    Starting row index of local domain.
+ * @param[in]  col_s    Starting column index of local domain.
+ * @param[in]  hdr      Header of the global grid, identical on all processes.
+ * @param[in]  tol      Absolute error bound; must be positive.
+ * @param[in]  comm     MPI communicator.
+ * @param[out] nbytes   Size of the file in bytes on all processes, or NULL.
+ *
+ * @returns MPI_SUCCESS on success, or the error code of the failing MPI-IO
+ *          call.
+ */
+int write_grid_compressed(char* filename, int lnx, int lny,
+                          double a[][lny + 2], int row_s, int col_s,
+                          const grid_header* hdr, double tol, MPI_Comm comm,
+                          long long* nbytes);
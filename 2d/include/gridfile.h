@@ -0,0 +1,151 @@
+/**
+ * @file  gridfile.h
+ * @brief Self-describing binary format for 2D grids.
+ *
+ * A grid file starts with a grid_header and is followed by the interior
+ * points of the block as raw doubles, indexed as [column][row] like the
+ * in-memory grids, i.e., the row (y) index varies fastest. Values are stored
+ * in the byte order of the host that wrote them; the order field lets readers
+ * reject files from hosts of the other endianness, and on the little-endian
+ * machines we run on the whole file is little-endian.
+ */
+
+#ifndef GRIDFILE_H
+#define GRIDFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define GRID_MAGIC "P2DGRID"  // Including the terminating '\0'
+#define GRID_ORDER 0x01020304 // Byte order marker
+#define GRID_VERSION 1
+#define GRID_TEXT_MAX 400     // Longest output of format_grid_value
+
+/**
+ * @brief Header of a binary grid file; 56 bytes without padding.
+ */
+typedef struct {
+  char     magic[8]; // GRID_MAGIC
+  uint32_t order;    // GRID_ORDER as written by the host
+  int32_t  version;  // GRID_VERSION
+  int32_t  nx;       // Number of interior columns in the file
+  int32_t  ny;       // Number of interior rows in the file
+  int32_t  col_s;    // Global index of the first column (1 for a global grid)
+  int32_t  row_s;    // Global index of the first row (1 for a global grid)
+  int32_t  it;       // Number of iterations carried out
+  int32_t  reserved; // Always 0
+  double   h;        // Grid spacing
+  double   residual; // Global difference of the last iteration
+} grid_header;
+
+/**
+ * @brief Read-only memory mapping of a binary grid file.
+ *
+ * data points straight into the mapping, so that point (i, j) of the block,
+ * counted from 1, is data[(i - 1) * hdr->ny + (j - 1)].
+ */
+typedef struct {
+  const grid_header* hdr;  // Header at the start of the mapping
+  const double*      data; // Interior points following the header
+  void*              base; // Start of the mapping
+  size_t             len;  // Length of the mapping in bytes
+} grid_map;
+
+/**
+ * @brief Fills in a grid header.
+ *
+ * @param[out] hdr      Header to fill in.
+ * @param[in]  nx       Number of interior columns in the file.
+ * @param[in]  ny       Number of interior rows in the file.
+ * @param[in]  col_s    Global index of the first column.
+ * @param[in]  row_s    Global index of the first row.
+ * @param[in]  h        Grid spacing.
+ * @param[in]  it       Number of iterations carried out.
+ * @param[in]  residual Global difference of the last iteration.
+ */
+void grid_header_init(grid_header* hdr, int nx, int ny, int col_s, int row_s,
+                      double h, int it, double residual);
+
+/**
+ * @brief Writes the interior of a grid to a binary grid file.
+ *
+ * The ghost cells (or, for a global grid, the boundary) are skipped.
+ *
+ * @param[in] filename Base name of the file to write; ".bin" is appended.
+ * @param[in] lnx      Number of interior grid points in x-axis.
+ * @param[in] lny      Number of interior grid points in y-axis.
+ * @param[in] a        Grid array containing the data to write.
+ * @param[in] hdr      Header to write in front of the data; its nx and ny must
+ *                     match lnx and lny.
+ *
+ * @returns 0 on success, non-zero on error.
+ */
+int write_grid_bin(char* filename, int lnx, int lny, double a[][lny + 2],
+                   const grid_header* hdr);
+
+/**
+ * @brief Maps a binary grid file into memory and checks its header.
+ *
+ * @param[in]  filename Full name of the file to read.
+ * @param[out] map      Mapping of the file; release it with grid_map_close.
+ *
+ * @returns 0 on success, non-zero on error.
+ */
+int grid_map_open(const char* filename, grid_map* map);
+
+/**
+ * @brief Releases a mapping made by grid_map_open.
+ *
+ * @param[in,out] map Mapping to release.
+ */
+void grid_map_close(grid_map* map);
+
+/**
+ * @brief Formats a value exactly as printf("%.6lf ", x) would.
+ *
+ * Values below 2^52 / 10^6 in magnitude are rounded to six decimals with
+ * integer arithmetic; the error of x * 10^6 is recovered with fma so that
+ * ties are broken on the exact binary value, like printf does. Larger values,
+ * infinities and NaNs are handed to snprintf.
+ *
+ * @param[in]  x   Value to format.
+ * @param[out] out Buffer with room for at least GRID_TEXT_MAX characters; the
+ *                 result is not terminated.
+ *
+ * @returns Number of characters written.
+ */
+size_t format_grid_value(double x, char* out);
+
+/**
+ * @brief Writes a block of values in the text layout of write_grid.
+ *
+ * Rows are formatted with format_grid_value into a large buffer, which is
+ * only written to the stream when full, so that large grids take few system
+ * calls. Value (i, j), counted from 0, is first[i * col_stride + j].
+ *
+ * @param[in] file       Stream to write to.
+ * @param[in] nx         Number of columns.
+ * @param[in] ny         Number of rows.
+ * @param[in] first      Value in the first column and bottom row.
+ * @param[in] col_stride Distance between consecutive columns in memory.
+ *
+ * @returns 0 on success, non-zero on error.
+ */
+int write_grid_text(FILE* file, int nx, int ny, const double* first,
+                    size_t col_stride);
+
+/**
+ * @brief Writes a mapped grid in the text layout of write_grid.
+ *
+ * Rows are written from the top (largest y) down, with "%.6lf " per point, so
+ * that the output can be plotted with scripts/heatmap.gp.
+ *
+ * @param[in] map  Mapping of the grid file.
+ * @param[in] file Stream to write to.
+ *
+ * @returns 0 on success, non-zero on error.
+ */
+int grid_map_write_text(const grid_map* map, FILE* file);
+
+#endif
@@ -13,12 +13,9 @@
  * MPI_Sendrecv calls in both horizontal and vertical directions. Uses a custom
  * MPI datatype for exchanging non-contiguous vertical data.
  *
+ * @param[in]     lnx      Number of local interior grid points in x-axis.
+ * @param[in]     lny      Number of local interior grid points in y-axis.
  * @param[in,out] x        Grid array to exchange ghost cells for.
- * @param[in]     nx       Number of interior grid points in x-axis.
- * @param[in]     row_s    Starting row index of local domain.
- * @param[in]     row_e    Ending row index of local domain.
- * @param[in]     col_s    Starting column index of local domain.
- * @param[in]     col_e    Ending column index of local domain.
  * @param[in]     comm     MPI communicator.
  * @param[in]     nbrleft  Rank of the left neighboring process.
  * @param[in]     nbrright Rank of the right neighboring process.
@@ -26,9 +23,9 @@
  * @param[in]     nbrdown  Rank of the lower neighboring process.
  * @param[in]     row_type MPI datatype for exchanging non-contiguous row data.
  */
-void exchang2d_1(double x[][maxn], int nx __attribute__((unused)), int row_s,
-                 int row_e, int col_s, int col_e, MPI_Comm comm, int nbrleft,
-                 int nbrright, int nbrup, int nbrdown, MPI_Datatype row_type);
+void exchang2d_1(int lnx, int lny, double x[][lny + 2], MPI_Comm comm,
+                 int nbrleft, int nbrright, int nbrup, int nbrdown,
+                 MPI_Datatype row_type);
 
 /**
  * @brief Exchanges ghost cells with neighboring processes using non-blocking
@@ -40,12 +37,9 @@ void exchang2d_1(double x[][maxn], int nx __attribute__((unused)), int row_s,
  * allows for potential overlap of communication and computation, improving
  * performance.
  *
+ * @param[in]     lnx      Number of local interior grid points in x-axis.
+ * @param[in]     lny      Number of local interior grid points in y-axis.
  * @param[in,out] x        Grid array to exchange ghost cells for.
- * @param[in]     nx       Number of interior grid points in x-axis.
- * @param[in]     row_s    Starting row index of local domain.
- * @param[in]     row_e    Ending row index of local domain.
- * @param[in]     col_s    Starting column index of local domain.
- * @param[in]     col_e    Ending column index of local domain.
  * @param[in]     comm     MPI communicator.
  * @param[in]     nbrleft  Rank of the left neighboring process.
  * @param[in]     nbrright Rank of the right neighboring process.
@@ -53,9 +47,94 @@ void exchang2d_1(double x[][maxn], int nx __attribute__((unused)), int row_s,
  * @param[in]     nbrdown  Rank of the lower neighboring process.
  * @param[in]     row_type MPI datatype for exchanging non-contiguous row data.
  */
-void exchang2d_nb(double x[][maxn], int nx __attribute__((unused)), int row_s,
-                  int row_e, int col_s, int col_e, MPI_Comm comm, int nbrleft,
-                  int nbrright, int nbrup, int nbrdown, MPI_Datatype row_type);
+void exchang2d_nb(int lnx, int lny, double x[][lny + 2], MPI_Comm comm,
+                  int nbrleft, int nbrright, int nbrup, int nbrdown,
+                  MPI_Datatype row_type);
+
+/**
+ * @brief Exchanges ghost cells, including the four corners, with neighboring
+ *        processes using blocking communication.
+ *
+ * Performs a two-phase exchange: the columns are exchanged with the left and
+ * right neighbors first, and the rows are then exchanged with the upper and
+ * lower neighbors. As the rows include the ghost columns filled in the first
+ * phase, the corner values of the diagonal neighbors are forwarded without
+ * any diagonal messages.
+ *
+ * @param[in]     lnx           Number of local interior grid points in x-axis.
+ * @param[in]     lny           Number of local interior grid points in y-axis.
+ * @param[in,out] x             Grid array to exchange ghost cells for.
+ * @param[in]     comm          MPI communicator.
+ * @param[in]     nbrleft       Rank of the left neighboring process.
+ * @param[in]     nbrright      Rank of the right neighboring process.
+ * @param[in]     nbrup         Rank of the upper neighboring process.
+ * @param[in]     nbrdown       Rank of the lower neighboring process.
+ * @param[in]     full_row_type MPI datatype for a row of lnx + 2 elements,
+ *                              i.e., including both ghost columns.
+ */
+void exchang2d_corner(int lnx, int lny, double x[][lny + 2], MPI_Comm comm,
+                      int nbrleft, int nbrright, int nbrup, int nbrdown,
+                      MPI_Datatype full_row_type);
+
+/**
+ * @brief Creates the MPI datatypes used by the RMA ghost cell exchanges.
+ *
+ * The four sides are ordered as (left, right, down, up), i.e., (x-, x+, y-,
+ * y+). Both sets of datatypes are described with MPI_Type_create_subarray
+ * relative to the start of a local array, so that MPI_Get needs no
+ * displacement.
+ *
+ * @param[in]  lnx        Number of local interior grid points in x-axis.
+ * @param[in]  lny        Number of local interior grid points in y-axis.
+ * @param[in]  nbr_lsize  Extent of the neighbor on each side along the axis
+ *                        of the exchange, i.e., its lnx for the left and right
+ *                        sides and its lny for the lower and upper sides.
+ * @param[out] recv_types Ghost cells on each side, to be read into.
+ * @param[out] get_types  Interior cells of the neighbor on each side next to
+ *                        our block, in the neighbor's memory layout.
+ */
+void create_rma_types2d(int lnx, int lny, int* nbr_lsize,
+                        MPI_Datatype* recv_types, MPI_Datatype* get_types);
+
+/**
+ * @brief Frees the datatypes created by create_rma_types2d.
+ *
+ * @param[in,out] recv_types Ghost cells on each side.
+ * @param[in,out] get_types  Interior cells of the neighbor on each side.
+ */
+void free_rma_types2d(MPI_Datatype* recv_types, MPI_Datatype* get_types);
+
+/**
+ * @brief Exchanges ghost cells with neighboring processes using RMA with
+ *        MPI_Win_fence synchronization.
+ *
+ * @param[in,out] x          Grid array exposed by win.
+ * @param[in]     nbrs       Ranks of the left, right, lower and upper
+ *                           neighboring processes.
+ * @param[in]     recv_types Ghost cells on each side.
+ * @param[in]     get_types  Interior cells of the neighbor on each side.
+ * @param[in]     win        MPI window object exposing the grid array.
+ */
+void exchang2d_rma_fence(double* x, int* nbrs, MPI_Datatype* recv_types,
+                         MPI_Datatype* get_types, MPI_Win win);
+
+/**
+ * @brief Exchanges ghost cells with neighboring processes using RMA with
+ *        general active target (post-start-complete-wait) synchronization.
+ *
+ * Only the neighbors take part in each epoch, so that, unlike with
+ * MPI_Win_fence, no process waits for the whole communicator.
+ *
+ * @param[in,out] x          Grid array exposed by win.
+ * @param[in]     nbrs       Ranks of the left, right, lower and upper
+ *                           neighboring processes.
+ * @param[in]     recv_types Ghost cells on each side.
+ * @param[in]     get_types  Interior cells of the neighbor on each side.
+ * @param[in]     win        MPI window object exposing the grid array.
+ * @param[in]     group      MPI group of the communicator used for win.
+ */
+void exchang2d_rma_pscw(double* x, int* nbrs, MPI_Datatype* recv_types,
+                        MPI_Datatype* get_types, MPI_Win win, MPI_Group group);
 
 /**
  * @brief Calculates the squared difference between two grid arrays.
@@ -63,19 +142,15 @@ void exchang2d_nb(double x[][maxn], int nx __attribute__((unused)), int row_s,
  * Computes the sum of squared differences between two grid arrays, which is
  * used to check for convergence between iterations of the Jacobi method.
  *
- * @param[in] a     First grid array.
- * @param[in] b     Second grid array.
- * @param[in] nx    Number of interior grid points in x-axis.
- * @param[in] row_s Starting row index of local domain.
- * @param[in] row_e Ending row index of local domain.
- * @param[in] col_s Starting column index of local domain.
- * @param[in] col_e Ending column index of local domain.
+ * @param[in] lnx Number of local interior grid points in x-axis.
+ * @param[in] lny Number of local interior grid points in y-axis.
+ * @param[in] a   First grid array.
+ * @param[in] b   Second grid array.
  *
  * @returns Sum of squared differences between the two grid arrays.
  */
-double griddiff2d(double a[][maxn], double b[][maxn],
-                  int nx __attribute__((unused)), int row_s, int row_e,
-                  int col_s, int col_e);
+double griddiff2d(int lnx, int lny, double a[][lny + 2],
+                  double b[][lny + 2]);
 
 /**
  * @brief Performs one Jacobi iteration step.
@@ -84,14 +159,54 @@ double griddiff2d(double a[][maxn], double b[][maxn],
  * point, computes the average of its four neighbors, adjusted by the right-hand
  * side function values, to solve the Poisson equation.
  *
- * @param[in]  a     Current iteration grid array.
- * @param[in]  f     Right-hand side function values.
- * @param[in]  nx    Number of interior grid points in x-axis.
- * @param[in]  row_s Starting row index of local domain.
- * @param[in]  row_e Ending row index of local domain.
- * @param[in]  col_s Starting column index of local domain.
- * @param[in]  col_e Ending column index of local domain.
- * @param[out] b     Next iteration grid array to store the updated values.
+ * @param[in]  lnx Number of local interior grid points in x-axis.
+ * @param[in]  lny Number of local interior grid points in y-axis.
+ * @param[in]  a   Current iteration grid array.
+ * @param[in]  f   Right-hand side function values.
+ * @param[in]  h   Grid spacing.
+ * @param[out] b   Next iteration grid array to store the updated values.
+ */
+void sweep2d(int lnx, int lny, double a[][lny + 2], double f[][lny + 2],
+             double h, double b[][lny + 2]);
+
+/**
+ * @brief Performs one Jacobi iteration step using the fourth-order compact
+ *        (Mehrstellen) 9-point stencil.
+ *
+ * Discretises the Poisson equation as
+ * 4(N+S+E+W) + (NE+NW+SE+SW) - 20u = h^2 (8f + f_N + f_S + f_E + f_W) / 2,
+ * which is fourth-order accurate. Requires the corner ghost cells of a and the
+ * edge ghost cells of f to be filled.
+ *
+ * @param[in]  lnx Number of local interior grid points in x-axis.
+ * @param[in]  lny Number of local interior grid points in y-axis.
+ * @param[in]  a   Current iteration grid array.
+ * @param[in]  f   Right-hand side function values.
+ * @param[in]  h   Grid spacing.
+ * @param[out] b   Next iteration grid array to store the updated values.
+ */
+void sweep2d_9pt(int lnx, int lny, double a[][lny + 2], double f[][lny + 2],
+                 double h, double b[][lny + 2]);
+
+// Floating-point operations per interior point of the kernels, as written in
+// jacobi.c once h * h is hoisted out of the loop; these must follow any
+// change to the kernels
+#define SWEEP2D_FLOPS     6  // 3 adds, h^2 f, the subtraction and 0.25 *
+#define SWEEP2D_9PT_FLOPS 16 // 3 + 3 adds for edges and corners, 1 mul and
+                             // 4 adds for rhs, then 4 *, +, *, - and / 20
+#define GRIDDIFF2D_FLOPS  3  // The difference, its square and the sum
+
+/**
+ * @brief Measures the speed of sweep2d on the calling process.
+ *
+ * Times a few sweeps over a private n x n grid, so that the result reflects
+ * the speed of the core (and any other load on the node) rather than the
+ * problem being solved. Used to derive weights for the weighted
+ * decomposition.
+ *
+ * @param[in] n    Size of the calibration grid; interior points only.
+ * @param[in] reps Number of sweeps to time.
+ *
+ * @returns Grid points updated per second.
  */
-void sweep2d(double a[][maxn], double f[][maxn], int nx, int row_s, int row_e,
-             int col_s, int col_e, double b[][maxn]);
+double calibrate_sweep2d(int n, int reps);
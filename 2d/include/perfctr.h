@@ -0,0 +1,62 @@
+/**
+ * @file  perfctr.h
+ * @brief Hardware performance counters of the solver phases.
+ *
+ * The counters are read with the perf_event_open system call, without any
+ * external library, at the start and end of every timed phase (see
+ * timers.h), and accumulated per process and per phase. Counting only starts
+ * once perf_init has been called, so runs without --perf pay nothing but a
+ * test of perf_enabled. Where counters are not available (another operating
+ * system than Linux, a container or a kernel that forbids perf events, or a
+ * virtual machine without a PMU), perf_init says so and the run carries on
+ * without them.
+ */
+
+#ifndef PERFCTR_H
+#define PERFCTR_H
+
+#include <mpi.h>
+
+extern int perf_enabled; // Whether the counters are being read
+
+/**
+ * @brief Opens the hardware counters of the calling thread.
+ *
+ * Events the processor does not support are left out of the group rather
+ * than disabling the others. The root process reports which events are
+ * counted and on how many processes.
+ *
+ * @param[in] comm MPI communicator.
+ *
+ * @returns Number of events being counted on this process, 0 if none.
+ */
+int perf_init(MPI_Comm comm);
+
+/**
+ * @brief Reads the counters at the start of a phase.
+ *
+ * @param[in] phase Phase being started, as in timers.h.
+ */
+void perf_phase_start(int phase);
+
+/**
+ * @brief Reads the counters at the end of a phase and accumulates the counts
+ *        since perf_phase_start.
+ *
+ * @param[in] phase Phase being stopped, as in timers.h.
+ */
+void perf_phase_stop(int phase);
+
+/**
+ * @brief Reports the counts of every phase and closes the counters.
+ *
+ * The root process prints the average count per process for every phase,
+ * along with instructions per cycle and the last-level cache miss ratio, and
+ * writes the counts of every process to a CSV file.
+ *
+ * @param[in] comm     MPI communicator.
+ * @param[in] filename Name of the CSV file to write.
+ */
+void perf_report(MPI_Comm comm, const char* filename);
+
+#endif
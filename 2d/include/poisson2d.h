@@ -1,6 +1,11 @@
 /**
  * @file  poisson2d.h
- * @brief Header defining grid dimensions.
+ * @brief Header defining default grid dimensions.
+ *
+ * Grids are stored per process as (lnx + 2) x (lny + 2) arrays, i.e., the
+ * local interior plus one layer of ghost cells on each side. The first index
+ * is the x-coordinate (column) and the second is the y-coordinate (row), so
+ * that columns are contiguous in memory.
  */
 
-#define maxn (31 + 2)
+#define default_nx 31
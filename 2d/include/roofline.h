@@ -0,0 +1,57 @@
+/**
+ * @file  roofline.h
+ * @brief Achieved bandwidth and FLOP rate of the solver kernels.
+ *
+ * The kernels of the Jacobi iteration do only a few flops per point, so their
+ * speed is bounded by memory bandwidth rather than by the floating-point
+ * units. The attainable bandwidth is measured with a STREAM-style triad run
+ * on all processes of a node at once, and each kernel is reported as a
+ * percentage of it.
+ *
+ * Bytes are counted as the compulsory traffic of one call: every array the
+ * kernel reads or writes is moved once per point, as the neighbours of a
+ * stencil are expected to come from cache, and write-allocate traffic is not
+ * counted, as in STREAM.
+ */
+
+#ifndef ROOFLINE_H
+#define ROOFLINE_H
+
+#include <mpi.h>
+#include <stddef.h>
+
+/**
+ * @brief Measures the memory bandwidth of the calling process with a
+ *        STREAM-style triad, a[k] = b[k] + s * c[k].
+ *
+ * @param[in] n    Length of each of the three arrays.
+ * @param[in] reps Number of timed triads; the fastest is used.
+ *
+ * @returns Bandwidth in bytes per second, counting 24 bytes per element.
+ */
+double stream_triad(size_t n, int reps);
+
+/**
+ * @brief Measures and reports the bandwidth and FLOP rate of the sweep and of
+ *        griddiff2d on the solver's own arrays.
+ *
+ * All processes run the triad and then each kernel at the same time, so that
+ * they compete for memory bandwidth as they do while solving. The root
+ * process prints the minimum, average and maximum over all processes of the
+ * GB/s and GFLOP/s per process, and of the percentage of the triad bandwidth
+ * of each process. b is overwritten.
+ *
+ * @param[in]     lnx     Number of local interior grid points in x-axis.
+ * @param[in]     lny     Number of local interior grid points in y-axis.
+ * @param[in]     a       Current iteration grid array.
+ * @param[in,out] b       Next iteration grid array, used as scratch.
+ * @param[in]     f       Right-hand side function values.
+ * @param[in]     h       Grid spacing.
+ * @param[in]     stencil 5 or 9, selecting sweep2d or sweep2d_9pt.
+ * @param[in]     comm    MPI communicator.
+ */
+void roofline_report(int lnx, int lny, double a[][lny + 2],
+                     double b[][lny + 2], double f[][lny + 2], double h,
+                     int stencil, MPI_Comm comm);
+
+#endif
@@ -0,0 +1,97 @@
+/**
+ * @file  snapshot.h
+ * @brief Snapshots of the 2D solution written in the background.
+ *
+ * Every snapshot is a global grid file in the binary format of gridfile.h.
+ * The solver only copies its local interior into a staging buffer and
+ * carries on straight away; a helper thread then writes the copy into its
+ * place in the file with collective MPI-IO. Unlike independent POSIX writes
+ * to one shared file, this keeps the snapshots consistent on file systems
+ * without POSIX coherence across nodes, such as NFS. The helper threads
+ * synchronise on a communicator of their own, which needs
+ * MPI_THREAD_MULTIPLE; without it, the snapshots are written on the calling
+ * thread instead.
+ */
+
+#include <mpi.h>
+#include <pthread.h>
+
+#include "gridfile.h"
+#include "poisson2d.h"
+
+/**
+ * @brief State of the snapshots written by one process.
+ */
+typedef struct {
+  char         filename[256]; // Name of the snapshot being written
+  pthread_t    thread;        // Helper thread writing the snapshot
+  MPI_Comm     comm;          // Communicator used by the helper threads only
+  MPI_Datatype filetype;      // Position of the local block in the file
+  double*      buf;           // Copy of the local interior
+  grid_header  hdr;           // Header of the global grid
+  int          lnx, lny;      // Size of the local interior
+  int          rank;          // Rank of the process; 0 writes the header
+  int          threaded;      // Whether a helper thread may be used
+  int          active;        // Whether a snapshot is being written
+  int          err;           // Whether writing any snapshot failed
+  int          count;         // Number of snapshots started
+  double       time;          // Time the solver spent in snapshot calls
+  double       copy_time;     // Part of time spent copying into buf
+} snapshot;
+
+/**
+ * @brief Prepares the snapshot state of a process.
+ *
+ * The snapshots are written on a duplicate of comm, so this is collective.
+ *
+ * @param[out] sn       Snapshot state.
+ * @param[in]  nx       Number of interior grid points in x-axis.
+ * @param[in]  ny       Number of interior grid points in y-axis.
+ * @param[in]  lnx      Number of local interior grid points in x-axis.
+ * @param[in]  lny      Number of local interior grid points in y-axis.
+ * @param[in]  row_s    Starting row index of local domain.
+ * @param[in]  col_s    Starting column index of local domain.
+ * @param[in]  threaded Whether a helper thread may be used, i.e., whether MPI
+ *                      provides MPI_THREAD_MULTIPLE; if not, the snapshots
+ *                      are written before snapshot_start returns.
+ * @param[in]  comm     MPI communicator.
+ */
+void snapshot_init(snapshot* sn, int nx, int ny, int lnx, int lny, int row_s,
+                   int col_s, int threaded, MPI_Comm comm);
+
+/**
+ * @brief Starts writing a snapshot of the local grid.
+ *
+ * Waits for the previous snapshot of this process, if any, copies the
+ * interior of a and hands the copy to the helper thread. As the write is
+ * collective, every process must start the same snapshots in the same order.
+ *
+ * @param[in,out] sn       Snapshot state.
+ * @param[in]     filename Base name of the file; ".bin" is appended.
+ * @param[in]     lnx      Number of local interior grid points in x-axis.
+ * @param[in]     lny      Number of local interior grid points in y-axis.
+ * @param[in]     a        Local grid array to save.
+ * @param[in]     h        Grid spacing.
+ * @param[in]     it       Number of completed iterations.
+ * @param[in]     residual Global difference of the last iteration.
+ */
+void snapshot_start(snapshot* sn, const char* filename, int lnx, int lny,
+                    double a[][lny + 2], double h, int it, double residual);
+
+/**
+ * @brief Waits for the snapshot being written, if any, to complete.
+ *
+ * @param[in,out] sn Snapshot state.
+ *
+ * @returns 0 on success, non-zero if writing any snapshot failed.
+ */
+int snapshot_finish(snapshot* sn);
+
+/**
+ * @brief Releases the snapshot state; snapshot_finish must be called first.
+ *
+ * This frees the communicator of the snapshots, so it is collective.
+ *
+ * @param[in,out] sn Snapshot state.
+ */
+void snapshot_free(snapshot* sn);
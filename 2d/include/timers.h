@@ -0,0 +1,109 @@
+/**
+ * @file  timers.h
+ * @brief Per-phase timers of the 2D solver.
+ *
+ * Every process accumulates the time it spends in each phase of the solver;
+ * timers_report then reduces these to the minimum, average and maximum over
+ * all processes, and reads the hardware counters of perfctr.h if they are
+ * enabled. The timers are only compiled in when POISSON_TIMERS is
+ * defined (make TIMERS=1, the default); otherwise TIMER_START, TIMER_STOP and
+ * timers_report expand to nothing.
+ */
+
+#ifndef TIMERS_H
+#define TIMERS_H
+
+#include <mpi.h>
+
+#include "perfctr.h"
+#include "trace.h"
+
+/**
+ * @brief Phases of the solver that are timed.
+ */
+enum {
+  PHASE_EXCHANGE,   // Ghost cell exchanges
+  PHASE_SWEEP,      // Jacobi sweeps
+  PHASE_RESIDUAL,   // Local differences between iterations (griddiff2d)
+  PHASE_ALLREDUCE,  // Reduction of the global difference
+  PHASE_WAIT,       // Waiting for the slowest process (--wait-time only)
+  PHASE_CHECKPOINT, // Checkpoints and snapshots during the solve
+  PHASE_GATHER,     // Gathering the solution onto the root process
+  PHASE_WRITE,      // Writing the solution files
+  NPHASES
+};
+
+/**
+ * @brief Name of a phase as used in reports.
+ *
+ * @param[in] phase Phase to name.
+ *
+ * @returns Name of the phase.
+ */
+const char* timer_phase_name(int phase);
+
+extern int timer_wait_split; // Whether TIMER_WAIT measures wait time
+
+#ifdef POISSON_TIMERS
+
+extern double timer_start[NPHASES]; // Start of the current call of each phase
+extern double timer_total[NPHASES]; // Time spent in each phase so far
+extern long   timer_calls[NPHASES]; // Number of calls of each phase so far
+
+// The hardware counters, if enabled, are read outside the timed interval,
+// and so are the events of a trace recorded
+#define TIMER_START(p)                                                         \
+  ((perf_enabled ? perf_phase_start(p) : (void) 0),                            \
+   timer_start[p] = MPI_Wtime())
+#define TIMER_STOP(p)                                                          \
+  (timer_total[p] += MPI_Wtime() - timer_start[p], timer_calls[p]++,           \
+   (trace_active ? trace_event(p, timer_start[p]) : (void) 0),                 \
+   (perf_enabled ? perf_phase_stop(p) : (void) 0))
+
+// Placed before a synchronising call, a barrier takes the time spent waiting
+// for the slowest process, so that the phase of the call only takes the time
+// of the transfer itself
+#define TIMER_WAIT(comm)                                                       \
+  (timer_wait_split ? (TIMER_START(PHASE_WAIT), (void) MPI_Barrier(comm),      \
+                       TIMER_STOP(PHASE_WAIT))                                 \
+                    : (void) 0)
+
+/**
+ * @brief Reports the time spent in each phase.
+ *
+ * The root process prints a table of the minimum, average and maximum time
+ * over all processes for every phase, along with max / avg as a measure of
+ * load imbalance, and writes the same to a CSV file.
+ *
+ * @param[in] comm     MPI communicator.
+ * @param[in] filename Name of the CSV file to write.
+ */
+void timers_report(MPI_Comm comm, const char* filename);
+
+/**
+ * @brief Reports the load imbalance between processes and the slowest of
+ *        them.
+ *
+ * The compute time of a process is the time of its sweeps and residuals. The
+ * root process prints max / avg of the compute time as the imbalance of the
+ * solve, and the slowest processes with their coordinates in comm, which
+ * must have a Cartesian topology, along with their time in synchronising
+ * calls and, with timer_wait_split set, in waiting. The same is written to a
+ * CSV file for every process.
+ *
+ * @param[in] comm     Cartesian MPI communicator.
+ * @param[in] filename Name of the CSV file to write.
+ */
+void imbalance_report(MPI_Comm comm, const char* filename);
+
+#else
+
+#define TIMER_START(p) ((void) 0)
+#define TIMER_STOP(p) ((void) 0)
+#define TIMER_WAIT(comm) ((void) 0)
+#define timers_report(comm, filename) ((void) 0)
+#define imbalance_report(comm, filename) ((void) 0)
+
+#endif
+
+#endif
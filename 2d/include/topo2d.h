@@ -0,0 +1,54 @@
+/**
+ * @file  topo2d.h
+ * @brief Node-aware placement of processes on the 2D process grid.
+ *
+ * MPI_Cart_create(..., reorder = 1, ...) is free to ignore the hardware, and
+ * most implementations do. These functions find which processes share a node
+ * and give each node a contiguous tile of the process grid, so that most halo
+ * exchanges stay within a node.
+ */
+
+/**
+ * @brief Identifies the node of every process.
+ *
+ * Processes on the same node are found with MPI_Comm_split_type, and each
+ * node is identified by the lowest rank in comm running on it. For testing on
+ * a single machine, nodes of ranks_per_node consecutive ranks can be
+ * simulated instead.
+ *
+ * @param[in]  comm           Communicator whose processes are to be placed.
+ * @param[in]  ranks_per_node Number of ranks per simulated node, or 0 to use
+ *                            the real nodes.
+ * @param[out] leaders        Node identifier of every rank in comm.
+ *
+ * @returns MPI_SUCCESS on successful completion.
+ */
+int topo2d_node_leaders(MPI_Comm comm, int ranks_per_node, int* leaders);
+
+/**
+ * @brief Assigns processes to the 2D process grid in node-sized tiles.
+ *
+ * Ranks are ordered node by node and then laid out over the process grid in
+ * bands of th rows, column by column within a band. A node with th * tw
+ * processes therefore receives a th x tw tile; th is the divisor of dims[0]
+ * that gives the most compact tile for the largest node.
+ *
+ * @param[in]  nprocs        Number of processes.
+ * @param[in]  dims          Dimensions of the 2D process grid.
+ * @param[in]  leaders       Node identifier of every rank.
+ * @param[out] cart_to_world Rank placed at each position of the process grid,
+ *                           indexed by row-major Cartesian rank.
+ */
+void topo2d_map_tiles(int nprocs, int* dims, int* leaders, int* cart_to_world);
+
+/**
+ * @brief Counts the halo edges of the process grid within and between nodes.
+ *
+ * @param[in]  dims          Dimensions of the 2D process grid.
+ * @param[in]  cart_to_world Rank placed at each position of the process grid.
+ * @param[in]  leaders       Node identifier of every rank.
+ * @param[out] intra         Number of neighbor pairs on the same node.
+ * @param[out] inter         Number of neighbor pairs on different nodes.
+ */
+void topo2d_count_edges(int* dims, int* cart_to_world, int* leaders,
+                        int* intra, int* inter);
@@ -0,0 +1,63 @@
+/**
+ * @file  trace.h
+ * @brief Event tracing of the solver phases.
+ *
+ * Every timed phase (see timers.h) can be recorded as an event with its start
+ * and end time in a fixed-size ring buffer per process, so that a long run
+ * keeps its most recent events without allocating or writing anything while
+ * solving. Only every trace_every-th iteration need be recorded, which bounds
+ * the overhead further. After the solve the buffers are merged into one file
+ * in the Chrome trace event format, which chrome://tracing and Perfetto both
+ * open, with one track per process.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <mpi.h>
+
+extern int trace_active; // Whether the current phase is being recorded
+
+/**
+ * @brief Allocates the ring buffer of the calling process and sets the time
+ *        origin of its events.
+ *
+ * The origin is taken straight after a barrier on every process, so that the
+ * tracks line up even if the clocks of the nodes do not agree.
+ *
+ * @param[in] capacity Number of events kept per process.
+ * @param[in] every    Record only the iterations that are a multiple of this.
+ * @param[in] comm     MPI communicator.
+ */
+void trace_init(int capacity, int every, MPI_Comm comm);
+
+/**
+ * @brief Selects whether the phases of an iteration are recorded.
+ *
+ * @param[in] it Iteration about to start, or -1 for the phases after the
+ *               iteration loop, which are always recorded.
+ */
+void trace_iteration(int it);
+
+/**
+ * @brief Records a phase that started at start and ends now.
+ *
+ * @param[in] phase Phase being stopped, as in timers.h.
+ * @param[in] start Value of MPI_Wtime when the phase started.
+ */
+void trace_event(int phase, double start);
+
+/**
+ * @brief Merges the events of all processes into a trace file and frees the
+ *        ring buffers.
+ *
+ * The root process receives the events of one process at a time, so its
+ * memory use does not grow with the number of processes, and reports how
+ * many events were overwritten because the buffers were full.
+ *
+ * @param[in] comm     MPI communicator.
+ * @param[in] filename Name of the JSON file to write.
+ */
+void trace_report(MPI_Comm comm, const char* filename);
+
+#endif
@@ -0,0 +1,59 @@
+/**
+ * @file  warmstart2d.h
+ * @brief Initial guesses from a solve on a coarser grid (nested iteration).
+ *
+ * Jacobi damps the smooth components of the error slowly, so starting from
+ * zero spends most iterations on them. The problem is first solved on a grid
+ * coarsened by a factor in both directions, where these components take far
+ * fewer (and cheaper) iterations, and the result is bilinearly interpolated
+ * onto the target grid as its initial guess.
+ *
+ * The coarse grid has nxc = (nx+1)/factor - 1 interior points in x-axis and
+ * spans [0,1] exactly; in y-axis it has just enough points to cover the
+ * domain of the target grid, whose top it may overshoot. Every coarse point
+ * belongs to the process that owns the target points around it, so that the
+ * coarse decomposition nests with the fine one on the same Cartesian
+ * communicator and the interpolation only reads the local coarse block and
+ * its ghost cells.
+ */
+
+#ifndef WARMSTART2D_H
+#define WARMSTART2D_H
+
+#include <mpi.h>
+
+/**
+ * @brief Replaces the interior of the local grid with the interpolated
+ *        solution of the problem on a coarser grid.
+ *
+ * The root process prints the size of the coarse grid and how long solving
+ * it took. If the grid is too small to be coarsened by factor, or a process
+ * would own no coarse points, a is left unchanged.
+ *
+ * @param[in]     factor   Coarsening factor in both directions.
+ * @param[in]     nx       Number of interior grid points in x-axis.
+ * @param[in]     ny       Number of interior grid points in y-axis.
+ * @param[in]     lnx      Number of local interior grid points in x-axis.
+ * @param[in]     lny      Number of local interior grid points in y-axis.
+ * @param[in,out] a        Grid array for current solution iteration.
+ * @param[in]     row_s    Starting row index of local domain.
+ * @param[in]     row_e    Ending row index of local domain.
+ * @param[in]     col_s    Starting column index of local domain.
+ * @param[in]     col_e    Ending column index of local domain.
+ * @param[in]     nbrleft  Rank of the left neighboring process.
+ * @param[in]     nbrright Rank of the right neighboring process.
+ * @param[in]     nbrup    Rank of the upper neighboring process.
+ * @param[in]     nbrdown  Rank of the lower neighboring process.
+ * @param[in]     niter    Maximum number of iterations of the coarse solve.
+ * @param[in]     tol      Convergence tolerance of the coarse solve.
+ * @param[in]     comm     Cartesian MPI communicator.
+ *
+ * @returns Number of iterations of the coarse solve, or -1 if a was left
+ *          unchanged.
+ */
+int warm_start2d(int factor, int nx, int ny, int lnx, int lny,
+                 double a[][lny + 2], int row_s, int row_e, int col_s,
+                 int col_e, int nbrleft, int nbrright, int nbrup, int nbrdown,
+                 int niter, double tol, MPI_Comm comm);
+
+#endif
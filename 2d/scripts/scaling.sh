@@ -0,0 +1,156 @@
+#!/bin/bash
+#
+# Strong- and weak-scaling benchmarks for the 2D solver on a single node.
+#
+# Usage: ./scripts/scaling.sh strong|weak
+#
+# Strong scaling keeps the global grid fixed at N x N while the number of
+# processes grows; weak scaling keeps roughly N x N points per process. Every
+# configuration is run WARMUP times without being recorded and then REPS
+# times, and the fastest repetition is used for the parallel efficiency, as it
+# is the least disturbed by other load on the node. Runs stop at convergence
+# or after ITERS iterations, whichever comes first. The results are written to
+# scaling-<mode>.csv. The following variables can be overridden from the
+# environment:
+#
+#   NPROCS    Process counts to run         (default "1 2 4 8")
+#   N         Grid points per axis          (default 512 strong, 128 weak)
+#   ITERS     Maximum iterations per run    (default 200)
+#   TOL       Convergence tolerance         (default 1e-11)
+#   WARMUP    Unrecorded runs per config    (default 1)
+#   REPS      Recorded runs per config      (default 3)
+#   EXCHANGES Exchange strategies to run    (default "blocking nb fence pscw")
+#   STENCILS  Stencils to run               (default "5 9")
+#   MPIRUN    Launcher                      (default "mpirun")
+#
+# The 9-point stencil always exchanges its corners with exchang2d_corner, so it
+# is run once per process count with the exchange recorded as "corner".
+# Running more processes than there are cores needs oversubscription to be
+# allowed, e.g., with OMPI_MCA_rmaps_base_oversubscribe=1 for Open MPI.
+
+set -e
+
+mode=${1:-strong}
+if [ "$mode" != "strong" ] && [ "$mode" != "weak" ]; then
+  echo "Usage: $0 strong|weak" >&2
+  exit 1
+fi
+
+NPROCS=${NPROCS:-"1 2 4 8"}
+ITERS=${ITERS:-200}
+TOL=${TOL:-1e-11}
+WARMUP=${WARMUP:-1}
+REPS=${REPS:-3}
+EXCHANGES=${EXCHANGES:-"blocking nb fence pscw"}
+STENCILS=${STENCILS:-"5 9"}
+MPIRUN=${MPIRUN:-mpirun}
+if [ "$mode" = "strong" ]; then
+  N=${N:-512}
+else
+  N=${N:-128}
+fi
+
+# The solver writes its report files into the working directory, so every
+# run takes place in a scratch directory which is removed afterwards
+main="$PWD/bin/main"
+scratch=$(mktemp -d)
+trap 'rm -rf "$scratch"' EXIT
+
+# Process grid of np processes over nd axes, largest first: every prime
+# factor of np in turn goes to the axis with the fewest processes
+proc_grid() {
+  awk -v np="$1" -v nd="$2" 'BEGIN {
+    for (i = 1; i <= nd; i++) d[i] = 1
+    p = np
+    for (f = 2; p > 1; f++) {
+      while (p % f == 0) {
+        m = 1
+        for (i = 2; i <= nd; i++) if (d[i] < d[m]) m = i
+        d[m] *= f
+        p /= f
+      }
+    }
+    for (i = 1; i <= nd; i++)
+      for (j = i + 1; j <= nd; j++)
+        if (d[j] > d[i]) { t = d[i]; d[i] = d[j]; d[j] = t }
+    s = d[1]
+    for (i = 2; i <= nd; i++) s = s " " d[i]
+    print s
+  }'
+}
+
+out="scaling-$mode.csv"
+echo "mode,stencil,exchange,nprocs,nx,ny,iterations,converged,time," \
+     "time_per_iteration,time_per_iteration_mean,time_per_iteration_max," \
+     "efficiency" | tr -d ' ' > "$out"
+
+for stencil in $STENCILS; do
+  if [ "$stencil" = "9" ]; then
+    exchanges="corner"
+  else
+    exchanges=$EXCHANGES
+  fi
+  for exch in $exchanges; do
+    base=""
+    for np in $NPROCS; do
+
+      # For weak scaling, grow the global grid with the process grid so that
+      # every process keeps about N x N points; the solver splits the longer
+      # axis further, so the x-axis gets the larger factor
+      if [ "$mode" = "weak" ]; then
+        read -r px py <<< "$(proc_grid "$np" 2)"
+        nx=$((N * px)); ny=$((N * py))
+      else
+        nx=$N; ny=$N
+      fi
+
+      args=(-s "$stencil" -i "$ITERS" -t "$TOL" -o none)
+      if [ "$stencil" != "9" ]; then
+        args+=(-e "$exch")
+      fi
+
+      for ((r = 0; r < WARMUP; r++)); do
+        (cd "$scratch" && $MPIRUN -np "$np" "$main" "${args[@]}" "$nx" "$ny") \
+          > /dev/null
+      done
+
+      # Solver time and time per iteration of every repetition; the fastest
+      # repetition is reported along with the mean and slowest time per
+      # iteration
+      runs=""
+      for ((r = 0; r < REPS; r++)); do
+        log=$(cd "$scratch" &&
+              $MPIRUN -np "$np" "$main" "${args[@]}" "$nx" "$ny")
+        runs="$runs$(echo "$log" | awk '/Solver completed in/ {t = $4}
+          /Time per iteration/ {print t, $4}')
+"
+      done
+      read -r time tpi tpi_mean tpi_max <<< "$(echo -n "$runs" | awk '{
+        if (NR == 1 || $2 < tpi) {time = $1; tpi = $2}
+        if (NR == 1 || $2 > max) max = $2
+        sum += $2}
+        END {printf "%s %s %.6e %.6e", time, tpi, sum / NR, max}')"
+      iters=$(echo "$log" | awk '/Converged after/ {print $3}')
+      converged=1
+      if [ -z "$iters" ]; then
+        iters=$ITERS
+        converged=0
+      fi
+
+      # Parallel efficiency relative to the first process count
+      if [ -z "$base" ]; then
+        base=$tpi
+        base_np=$np
+      fi
+      if [ "$mode" = "strong" ]; then
+        eff=$(awk -v b="$base" -v t="$tpi" -v p0="$base_np" -v p="$np" \
+              'BEGIN {printf "%.3f", (b * p0) / (t * p)}')
+      else
+        eff=$(awk -v b="$base" -v t="$tpi" 'BEGIN {printf "%.3f", b / t}')
+      fi
+
+      echo "$mode,$stencil,$exch,$np,$nx,$ny,$iters,$converged,$time,$tpi," \
+           "$tpi_mean,$tpi_max,$eff" | tr -d ' ' | tee -a "$out"
+    done
+  done
+done
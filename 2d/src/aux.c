@@ -13,23 +13,22 @@
 #include "../include/poisson2d.h"
 
 /**
- * @brief Initializes grid arrays with a default value.
+ * @brief Evaluates the analytical solution of the Poisson problem.
  *
- * Sets all elements in the grid arrays to an initial junk value.
+ * The problem is set up so that u(x,y)=y/((1+x)^2+y^2) solves it exactly; this
+ * is used both for the Dirichlet boundary conditions and for checking the
+ * numerical solution.
  *
- * @param[out] a Grid array for current solution iteration.
- * @param[out] b Grid array for next solution iteration.
- * @param[out] f Grid array for right-hand side function values.
+ * @param[in] x Physical x-coordinate.
+ * @param[in] y Physical y-coordinate.
+ *
+ * @returns The value of the analytical solution at (x, y).
  */
-void init_full_grids(double a[][maxn], double b[][maxn], double f[][maxn]) {
-  const double junkval = -5;
-  for (int i = 0; i < maxn; i++) {
-    for (int j = 0; j < maxn; j++) {
-      a[i][j] = junkval;
-      b[i][j] = junkval;
-      f[i][j] = junkval;
-    }
+double analytical2d(double x, double y) {
+  if (y == 0.0 || ((1.0 + x) * (1.0 + x) + y * y) == 0.0) {
+    return 0.0; // Protect against division by zero
   }
+  return y / ((1.0 + x) * (1.0 + x) + y * y);
 }
 
 /**
@@ -37,8 +36,12 @@ void init_full_grids(double a[][maxn], double b[][maxn], double f[][maxn]) {
  *
  * Sets up the local portion of the grid assigned to a process, including ghost
  * cells and boundary conditions. Interior points are set to zero. Sets the
- * appropriate Dirichlet boundary conditions for the Poisson problem.
+ * appropriate Dirichlet boundary conditions for the Poisson problem, including
+ * the corner ghost cells that lie on the boundary. The grid spacing is
+ * h = 1/(nx+1) in both directions, so the domain is [0,1] x [0,(ny+1)h].
  *
+ * @param[in]  lnx   Number of local interior grid points in x-axis.
+ * @param[in]  lny   Number of local interior grid points in y-axis.
  * @param[out] a     Grid array for current solution iteration.
  * @param[out] b     Grid array for next solution iteration.
  * @param[out] f     Grid array for right-hand side function values.
@@ -49,45 +52,49 @@ void init_full_grids(double a[][maxn], double b[][maxn], double f[][maxn]) {
  * @param[in]  col_s Starting column index of local domain.
  * @param[in]  col_e Ending column index of local domain.
  */
-void init_twod(double a[][maxn], double b[][maxn], double f[][maxn], int nx,
-               int ny __attribute__((unused)), int row_s, int row_e, int col_s,
-               int col_e) {
+void init_twod(int lnx, int lny, double a[][lny + 2], double b[][lny + 2],
+               double f[][lny + 2], int nx, int ny, int row_s, int row_e,
+               int col_s, int col_e) {
   double h = 1.0 / ((double) (nx + 1)); // Grid spacing
 
   // Set everything to zero first
-  for (int i = col_s - 1; i <= col_e + 1; i++) {
-    for (int j = row_s - 1; j <= row_e + 1; j++) {
+  for (int i = 0; i <= lnx + 1; i++) {
+    for (int j = 0; j <= lny + 1; j++) {
       a[i][j] = 0.0;
       b[i][j] = 0.0;
       f[i][j] = 0.0;
     }
   }
 
-  if (row_e == nx) {
-    for (int i = col_s; i <= col_e; i++) {
-      double x     = i * h; // Transform to coordinate system
-      a[i][nx + 1] = 1.0 / ((1.0 + x) * (1.0 + x) + 1.0);
-      b[i][nx + 1] = 1.0 / ((1.0 + x) * (1.0 + x) + 1.0);
+  // Local index i corresponds to global column col_s - 1 + i, and local index
+  // j to global row row_s - 1 + j
+  if (row_e == ny) {
+    double y = (ny + 1) * h; // Top of the domain
+    for (int i = 0; i <= lnx + 1; i++) {
+      double x      = (col_s - 1 + i) * h; // Transform to coordinate system
+      a[i][lny + 1] = analytical2d(x, y);
+      b[i][lny + 1] = analytical2d(x, y);
     }
   }
   if (row_s == 1) {
-    for (int i = col_s; i <= col_e; i++) {
+    for (int i = 0; i <= lnx + 1; i++) {
       a[i][0] = 0.0;
       b[i][0] = 0.0;
     }
   }
   if (col_s == 1) {
-    for (int j = row_s; j <= row_e; j++) {
-      double y = j * h; // Transform to coordinate system
-      a[0][j]  = y / (1.0 + y * y);
-      b[0][j]  = y / (1.0 + y * y);
+    for (int j = 0; j <= lny + 1; j++) {
+      double y = (row_s - 1 + j) * h; // Transform to coordinate system
+      a[0][j]  = analytical2d(0.0, y);
+      b[0][j]  = analytical2d(0.0, y);
     }
   }
   if (col_e == nx) {
-    for (int j = row_s; j <= row_e; j++) {
-      double y     = j * h; // Transform to coordinate system
-      a[nx + 1][j] = y / (4.0 + y * y);
-      b[nx + 1][j] = y / (4.0 + y * y);
+    double x = (nx + 1) * h; // Right of the domain
+    for (int j = 0; j <= lny + 1; j++) {
+      double y      = (row_s - 1 + j) * h; // Transform to coordinate system
+      a[lnx + 1][j] = analytical2d(x, y);
+      b[lnx + 1][j] = analytical2d(x, y);
     }
   }
 }
@@ -0,0 +1,270 @@
+/**
+ * @file  checkpoint.c
+ * @brief Implementation of checkpointing and restarting of the 2D solver.
+ */
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/checkpoint.h"
+#include "../include/gridfile.h"
+#include "../include/poisson2d.h"
+
+/**
+ * @brief Prepares the checkpoint state of a process.
+ *
+ * @param[out] ck       Checkpoint state.
+ * @param[in]  filename Base name of the checkpoint file; ".bin" is appended.
+ * @param[in]  nx       Number of interior grid points in x-axis.
+ * @param[in]  ny       Number of interior grid points in y-axis.
+ * @param[in]  lnx      Number of local interior grid points in x-axis.
+ * @param[in]  lny      Number of local interior grid points in y-axis.
+ * @param[in]  row_s    Starting row index of local domain.
+ * @param[in]  col_s    Starting column index of local domain.
+ */
+void checkpoint_init(checkpoint* ck, const char* filename, int nx, int ny,
+                     int lnx, int lny, int row_s, int col_s) {
+  memset(ck, 0, sizeof(checkpoint));
+  snprintf(ck->filename, sizeof(ck->filename), "%s.bin", filename);
+  snprintf(ck->tmpname, sizeof(ck->tmpname), "%s.tmp", ck->filename);
+
+  // Position of the local interior within the global interior in the file
+  int gsizes[2] = {nx, ny};
+  int lsizes[2] = {lnx, lny};
+  int starts[2] = {col_s - 1, row_s - 1};
+  MPI_Type_create_subarray(2, gsizes, lsizes, starts, MPI_ORDER_C, MPI_DOUBLE,
+                           &ck->filetype);
+  MPI_Type_commit(&ck->filetype);
+  grid_header_init(&ck->hdr, nx, ny, 1, 1, 0.0, 0, 0.0);
+
+  ck->buf = (double*) malloc((size_t) lnx * lny * sizeof(double));
+  if (!ck->buf) {
+    fprintf(stderr, "Memory allocation error\n");
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+}
+
+/**
+ * @brief Starts writing a checkpoint of the local grid.
+ *
+ * Any previous checkpoint is completed first. The interior of a is copied
+ * and written with MPI_File_iwrite_all where the MPI library provides it (MPI
+ * 3.1 and later), or with MPI_File_write_all otherwise. The file is written
+ * under a temporary name and only renamed once complete, so that a run which
+ * is killed while writing leaves the previous checkpoint intact.
+ *
+ * @param[in,out] ck       Checkpoint state.
+ * @param[in]     lnx      Number of local interior grid points in x-axis.
+ * @param[in]     lny      Number of local interior grid points in y-axis.
+ * @param[in]     a        Local grid array to save.
+ * @param[in]     h        Grid spacing.
+ * @param[in]     it       Number of completed iterations.
+ * @param[in]     residual Global difference of the last iteration.
+ * @param[in]     comm     MPI communicator.
+ *
+ * @returns MPI_SUCCESS on success, or the error code of the failing MPI-IO
+ *          call.
+ */
+int checkpoint_start(checkpoint* ck, int lnx, int lny, double a[][lny + 2],
+                     double h, int it, double residual, MPI_Comm comm) {
+  int err = checkpoint_finish(ck, comm);
+  if (err != MPI_SUCCESS) {
+    return err;
+  }
+  double t = MPI_Wtime();
+
+  // Take a copy so that the solver may overwrite a straight away
+  for (int i = 1; i <= lnx; i++) {
+    memcpy(&ck->buf[(size_t) (i - 1) * lny], &a[i][1], lny * sizeof(double));
+  }
+  ck->hdr.h        = h;
+  ck->hdr.it       = it;
+  ck->hdr.residual = residual;
+
+  err = MPI_File_open(comm, ck->tmpname, MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                      MPI_INFO_NULL, &ck->fh);
+  if (err != MPI_SUCCESS) {
+    fprintf(stderr, "Error opening file %s for writing\n", ck->tmpname);
+    return err;
+  }
+  err = MPI_File_set_size(ck->fh, 0);
+
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+  if (rank == 0 && err == MPI_SUCCESS) {
+    err = MPI_File_write_at(ck->fh, 0, &ck->hdr, sizeof(grid_header), MPI_BYTE,
+                            MPI_STATUS_IGNORE);
+  }
+  int verr = MPI_File_set_view(ck->fh, sizeof(grid_header), MPI_DOUBLE,
+                               ck->filetype, "native", MPI_INFO_NULL);
+  err      = (err == MPI_SUCCESS) ? verr : err;
+#if MPI_VERSION > 3 || (MPI_VERSION == 3 && MPI_SUBVERSION >= 1)
+  int werr = MPI_File_iwrite_all(ck->fh, ck->buf, lnx * lny, MPI_DOUBLE,
+                                 &ck->req);
+#else
+  int werr = MPI_File_write_all(ck->fh, ck->buf, lnx * lny, MPI_DOUBLE,
+                                MPI_STATUS_IGNORE);
+  ck->req  = MPI_REQUEST_NULL;
+#endif
+  if (werr != MPI_SUCCESS) {
+    ck->req = MPI_REQUEST_NULL; // The write never started
+  }
+
+  // The file stays open until checkpoint_finish, which decides collectively
+  // whether it may replace the previous checkpoint
+  err        = (err == MPI_SUCCESS) ? werr : err;
+  ck->err    = err;
+  ck->active = 1;
+
+  ck->time += MPI_Wtime() - t;
+  return err;
+}
+
+/**
+ * @brief Waits for the checkpoint being written, if any, to complete.
+ *
+ * The temporary file only replaces the previous checkpoint if every process
+ * started and completed its part of the write.
+ *
+ * @param[in,out] ck   Checkpoint state.
+ * @param[in]     comm MPI communicator.
+ *
+ * @returns MPI_SUCCESS on success, or MPI_ERR_IO if the checkpoint could not
+ *          be written or renamed (on all processes).
+ */
+int checkpoint_finish(checkpoint* ck, MPI_Comm comm) {
+  if (!ck->active) {
+    return MPI_SUCCESS;
+  }
+  double t = MPI_Wtime();
+
+  int err = ck->err;
+  if (ck->req != MPI_REQUEST_NULL) {
+    int werr = MPI_Wait(&ck->req, MPI_STATUS_IGNORE);
+    err      = (err == MPI_SUCCESS) ? werr : err;
+  }
+  MPI_File_close(&ck->fh);
+  ck->active = 0;
+
+  // Every process must have succeeded before the old checkpoint is replaced,
+  // and the root process tells the others whether the rename did
+  int all_ok, ok = (err == MPI_SUCCESS);
+  MPI_Allreduce(&ok, &all_ok, 1, MPI_INT, MPI_LAND, comm);
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+  if (rank == 0) {
+    all_ok = all_ok && rename(ck->tmpname, ck->filename) == 0;
+    if (!all_ok) {
+      fprintf(stderr, "Error writing file %s\n", ck->filename);
+    }
+  }
+  MPI_Bcast(&all_ok, 1, MPI_INT, 0, comm);
+
+  ck->time += MPI_Wtime() - t;
+  return all_ok ? MPI_SUCCESS : MPI_ERR_IO;
+}
+
+/**
+ * @brief Releases the checkpoint state; checkpoint_finish must be called
+ *        first.
+ *
+ * @param[in,out] ck Checkpoint state.
+ */
+void checkpoint_free(checkpoint* ck) {
+  MPI_Type_free(&ck->filetype);
+  free(ck->buf);
+  ck->buf = NULL;
+}
+
+/**
+ * @brief Restores the local grid from a checkpoint.
+ *
+ * The file may have been written with any number of processes, as only the
+ * block of the calling process is read from the global grid.
+ *
+ * @param[in]  filename Full name of the checkpoint file.
+ * @param[in]  nx       Number of interior grid points in x-axis.
+ * @param[in]  ny       Number of interior grid points in y-axis.
+ * @param[in]  lnx      Number of local interior grid points in x-axis.
+ * @param[in]  lny      Number of local interior grid points in y-axis.
+ * @param[out] a        Local grid array whose interior is restored.
+ * @param[in]  row_s    Starting row index of local domain.
+ * @param[in]  col_s    Starting column index of local domain.
+ * @param[out] it       Number of iterations completed before the checkpoint.
+ * @param[out] residual Global difference at the checkpoint.
+ * @param[in]  comm     MPI communicator.
+ *
+ * @returns 0 on success, non-zero on error (on all processes).
+ */
+int checkpoint_read(const char* filename, int nx, int ny, int lnx, int lny,
+                    double a[][lny + 2], int row_s, int col_s, int* it,
+                    double* residual, MPI_Comm comm) {
+  int         rank, bad = 0;
+  grid_header hdr;
+  MPI_File    fh;
+  MPI_Comm_rank(comm, &rank);
+
+  if (MPI_File_open(comm, filename, MPI_MODE_RDONLY, MPI_INFO_NULL, &fh) !=
+      MPI_SUCCESS) {
+    if (rank == 0) {
+      fprintf(stderr, "Error opening file %s for reading\n", filename);
+    }
+    return 1;
+  }
+
+  // Check that the checkpoint matches the problem being solved
+  if (MPI_File_read_at_all(fh, 0, &hdr, sizeof(grid_header), MPI_BYTE,
+                           MPI_STATUS_IGNORE) != MPI_SUCCESS ||
+      memcmp(hdr.magic, GRID_MAGIC, sizeof(GRID_MAGIC)) != 0 ||
+      hdr.order != GRID_ORDER || hdr.version != GRID_VERSION) {
+    if (rank == 0) {
+      fprintf(stderr, "%s is not a grid file\n", filename);
+    }
+    bad = 1;
+  } else if (hdr.nx != nx || hdr.ny != ny) {
+    if (rank == 0) {
+      fprintf(stderr, "%s holds a %d x %d grid rather than %d x %d\n",
+              filename, hdr.nx, hdr.ny, nx, ny);
+    }
+    bad = 1;
+  }
+  if (bad) {
+    MPI_File_close(&fh);
+    return 1;
+  }
+
+  // Read the local block straight into the interior of a
+  int          gsizes[2]  = {nx, ny};
+  int          lsizes[2]  = {lnx, lny};
+  int          starts[2]  = {col_s - 1, row_s - 1};
+  int          msizes[2]  = {lnx + 2, lny + 2};
+  int          mstarts[2] = {1, 1};
+  MPI_Datatype filetype, memtype;
+  MPI_Type_create_subarray(2, gsizes, lsizes, starts, MPI_ORDER_C, MPI_DOUBLE,
+                           &filetype);
+  MPI_Type_commit(&filetype);
+  MPI_Type_create_subarray(2, msizes, lsizes, mstarts, MPI_ORDER_C, MPI_DOUBLE,
+                           &memtype);
+  MPI_Type_commit(&memtype);
+  MPI_File_set_view(fh, sizeof(grid_header), MPI_DOUBLE, filetype, "native",
+                    MPI_INFO_NULL);
+  int ok = MPI_File_read_all(fh, a, 1, memtype, MPI_STATUS_IGNORE) ==
+           MPI_SUCCESS;
+  MPI_File_close(&fh);
+  MPI_Type_free(&filetype);
+  MPI_Type_free(&memtype);
+
+  int all_ok;
+  MPI_Allreduce(&ok, &all_ok, 1, MPI_INT, MPI_LAND, comm);
+  if (!all_ok) {
+    if (rank == 0) {
+      fprintf(stderr, "Error reading file %s\n", filename);
+    }
+    return 1;
+  }
+  *it       = hdr.it;
+  *residual = hdr.residual;
+  return 0;
+}
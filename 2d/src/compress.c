@@ -0,0 +1,361 @@
+/**
+ * @file  compress.c
+ * @brief Implementation of error-bounded lossy compression of 2D grids.
+ *
+ * The range coder is the carry-less binary coder of LZMA: probabilities are
+ * 11-bit and adapt by 1/32 of the distance to the coded bit on every use.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/compress.h"
+#include "../include/poisson2d.h"
+
+#define RC_BITS 11          // Precision of the probabilities
+#define RC_MOVE 5           // Adaptation rate of the probabilities
+#define RC_TOP (1u << 24)   // Renormalisation threshold
+#define ZGRID_QMAX (1 << 29) // Largest quantisation code
+#define ZGRID_ESCAPE 31     // Prefix length marking a value stored exactly
+
+/**
+ * @brief Adaptive probabilities used to code the quantisation codes.
+ */
+typedef struct {
+  uint16_t zero[2];    // Whether a code is zero, by whether the last one was
+  uint16_t sign;       // Sign of a non-zero code
+  uint16_t prefix[32]; // Unary number of bits of the magnitude
+  uint16_t suffix[32]; // Bits of the magnitude below the leading one
+  uint16_t raw;        // Bits of values stored exactly
+} zgrid_model;
+
+/**
+ * @brief State of the range encoder.
+ */
+typedef struct {
+  unsigned char* buf;        // Output
+  size_t         len;        // Bytes written to buf
+  size_t         cap;        // Size of buf
+  uint64_t       low;        // Low end of the current interval
+  uint32_t       range;      // Width of the current interval
+  unsigned char  cache;      // Byte held back in case of a carry
+  uint64_t       cache_size; // Number of bytes held back
+} rc_encoder;
+
+/**
+ * @brief State of the range decoder.
+ */
+typedef struct {
+  const unsigned char* buf;     // Input
+  size_t               len;     // Size of buf
+  size_t               pos;     // Bytes read from buf
+  uint32_t             range;   // Width of the current interval
+  uint32_t             code;    // Position of the code in the interval
+  int                  overrun; // Whether more than len bytes were needed
+} rc_decoder;
+
+/**
+ * @brief Sets all probabilities of a model to one half.
+ *
+ * @param[out] m Model to reset.
+ */
+static void zgrid_model_init(zgrid_model* m) {
+  uint16_t* p = (uint16_t*) m;
+  for (size_t k = 0; k < sizeof(zgrid_model) / sizeof(uint16_t); k++) {
+    p[k] = 1u << (RC_BITS - 1);
+  }
+}
+
+/**
+ * @brief Predicts a point from its reconstructed neighbours.
+ *
+ * Shared by the compressor and the decompressor, so that both make exactly
+ * the same floating-point operations.
+ *
+ * @param[in] prev Reconstructed values of the previous column.
+ * @param[in] cur  Reconstructed values of the current column.
+ * @param[in] i    Column within the block.
+ * @param[in] j    Row within the block.
+ *
+ * @returns Predicted value.
+ */
+static double zgrid_predict(const double* prev, const double* cur, int i,
+                            int j) {
+  if (i > 0 && j > 0) {
+    return prev[j] + cur[j - 1] - prev[j - 1];
+  }
+  if (i > 0) {
+    return prev[j];
+  }
+  if (j > 0) {
+    return cur[j - 1];
+  }
+  return 0.0;
+}
+
+/**
+ * @brief Reconstructs a point from its prediction and quantisation code.
+ *
+ * @param[in] pred Predicted value.
+ * @param[in] q    Quantisation code.
+ * @param[in] step Quantisation step, i.e., twice the error bound.
+ *
+ * @returns Reconstructed value.
+ */
+static double zgrid_reconstruct(double pred, long q, double step) {
+  return pred + (double) q * step;
+}
+
+/**
+ * @brief Appends a byte to the output of the encoder.
+ *
+ * @param[in,out] rc Encoder.
+ * @param[in]     b  Byte to append.
+ */
+static void rc_put_byte(rc_encoder* rc, unsigned char b) {
+  if (rc->len == rc->cap) {
+    rc->cap *= 2;
+    rc->buf = (unsigned char*) realloc(rc->buf, rc->cap);
+    if (!rc->buf) {
+      fprintf(stderr, "Memory allocation error\n");
+      exit(1);
+    }
+  }
+  rc->buf[rc->len++] = b;
+}
+
+/**
+ * @brief Moves the top byte of low to the output, resolving carries.
+ *
+ * @param[in,out] rc Encoder.
+ */
+static void rc_shift_low(rc_encoder* rc) {
+  if ((uint32_t) rc->low < 0xFF000000u || (rc->low >> 32) != 0) {
+    unsigned char carry = (unsigned char) (rc->low >> 32);
+    unsigned char temp  = rc->cache;
+    do {
+      rc_put_byte(rc, (unsigned char) (temp + carry));
+      temp = 0xFF;
+    } while (--rc->cache_size != 0);
+    rc->cache = (unsigned char) (rc->low >> 24);
+  }
+  rc->cache_size++;
+  rc->low = (rc->low & 0x00FFFFFFu) << 8;
+}
+
+/**
+ * @brief Encodes one bit with an adaptive probability.
+ *
+ * @param[in,out] rc  Encoder.
+ * @param[in,out] p   Probability of the bit being 0, which is then updated.
+ * @param[in]     bit Bit to encode.
+ */
+static void rc_encode_bit(rc_encoder* rc, uint16_t* p, int bit) {
+  uint32_t bound = (rc->range >> RC_BITS) * *p;
+  if (!bit) {
+    rc->range = bound;
+    *p += ((1u << RC_BITS) - *p) >> RC_MOVE;
+  } else {
+    rc->low += bound;
+    rc->range -= bound;
+    *p -= *p >> RC_MOVE;
+  }
+  while (rc->range < RC_TOP) {
+    rc->range <<= 8;
+    rc_shift_low(rc);
+  }
+}
+
+/**
+ * @brief Decodes one bit with an adaptive probability.
+ *
+ * @param[in,out] rc Decoder.
+ * @param[in,out] p  Probability of the bit being 0, which is then updated.
+ *
+ * @returns Decoded bit.
+ */
+static int rc_decode_bit(rc_decoder* rc, uint16_t* p) {
+  uint32_t bound = (rc->range >> RC_BITS) * *p;
+  int      bit;
+  if (rc->code < bound) {
+    rc->range = bound;
+    *p += ((1u << RC_BITS) - *p) >> RC_MOVE;
+    bit = 0;
+  } else {
+    rc->code -= bound;
+    rc->range -= bound;
+    *p -= *p >> RC_MOVE;
+    bit = 1;
+  }
+  while (rc->range < RC_TOP) {
+    rc->range <<= 8;
+    rc->code = (rc->code << 8) |
+               ((rc->pos < rc->len) ? rc->buf[rc->pos++]
+                                    : (rc->overrun = 1, 0));
+  }
+  return bit;
+}
+
+/**
+ * @brief Compresses the interior of a grid to within an absolute error bound.
+ *
+ * @param[in]  lnx Number of interior grid points in x-axis.
+ * @param[in]  lny Number of interior grid points in y-axis.
+ * @param[in]  a   Grid array containing the data to compress.
+ * @param[in]  tol Absolute error bound; must be positive.
+ * @param[out] out Newly allocated buffer with the compressed data, which the
+ *                 caller must free.
+ *
+ * @returns Size of the compressed data in bytes.
+ */
+size_t compress_grid(int lnx, int lny, double a[][lny + 2], double tol,
+                     unsigned char** out) {
+  zgrid_model m;
+  zgrid_model_init(&m);
+  rc_encoder rc = {NULL, 0, (size_t) lnx * lny + 1024, 0, 0xFFFFFFFFu, 0, 1};
+  rc.buf        = (unsigned char*) malloc(rc.cap);
+  double* cols  = (double*) malloc(2 * (size_t) lny * sizeof(double));
+  if (!rc.buf || !cols) {
+    fprintf(stderr, "Memory allocation error\n");
+    exit(1);
+  }
+  double* prev = cols; // Reconstructed previous and current columns
+  double* cur  = cols + lny;
+
+  double step      = 2.0 * tol;
+  int    prev_zero = 1;
+  for (int i = 0; i < lnx; i++) {
+    for (int j = 0; j < lny; j++) {
+      double v    = a[i + 1][j + 1];
+      double pred = zgrid_predict(prev, cur, i, j);
+      double qd   = (v - pred) / step;
+      long   q    = 0;
+      int    ok   = fabs(qd) < ZGRID_QMAX; // Also false for NaN
+      if (ok) {
+        q      = lround(qd);
+        cur[j] = zgrid_reconstruct(pred, q, step);
+        ok     = fabs(cur[j] - v) <= tol;
+      }
+
+      // A zero flag, then the sign, the number of bits of the magnitude in
+      // unary and the bits below its leading one
+      rc_encode_bit(&rc, &m.zero[prev_zero], !ok || q != 0);
+      prev_zero = ok && q == 0;
+      if (prev_zero) {
+        continue;
+      }
+      rc_encode_bit(&rc, &m.sign, ok && q < 0);
+      unsigned long u = ok ? labs(q) : 0;
+      int           k = 0;
+      while (ok && (u >> (k + 1)) != 0) {
+        k++;
+      }
+      if (!ok) {
+        k = ZGRID_ESCAPE;
+      }
+      for (int t = 0; t < k; t++) {
+        rc_encode_bit(&rc, &m.prefix[t], 1);
+      }
+      if (ok) {
+        rc_encode_bit(&rc, &m.prefix[k], 0);
+        for (int b = k - 1; b >= 0; b--) {
+          rc_encode_bit(&rc, &m.suffix[b], (u >> b) & 1);
+        }
+      } else {
+
+        // Store the value exactly
+        uint64_t bits;
+        memcpy(&bits, &v, sizeof(bits));
+        for (int b = 63; b >= 0; b--) {
+          rc_encode_bit(&rc, &m.raw, (bits >> b) & 1);
+        }
+        cur[j] = v;
+      }
+    }
+    double* tmp = prev;
+    prev        = cur;
+    cur         = tmp;
+  }
+  for (int k = 0; k < 5; k++) {
+    rc_shift_low(&rc);
+  }
+
+  free(cols);
+  *out = rc.buf;
+  return rc.len;
+}
+
+/**
+ * @brief Decompresses data made by compress_grid.
+ *
+ * Value (i, j), counted from 0, is stored in first[i * col_stride + j].
+ *
+ * @param[in]  in         Compressed data.
+ * @param[in]  len        Size of the compressed data in bytes.
+ * @param[in]  nx         Number of columns in the block.
+ * @param[in]  ny         Number of rows in the block.
+ * @param[in]  tol        Absolute error bound used for compression.
+ * @param[out] first      Where to store the value in the first column and
+ *                        bottom row.
+ * @param[in]  col_stride Distance between consecutive columns in memory.
+ *
+ * @returns 0 on success, non-zero if the data is truncated.
+ */
+int decompress_grid(const unsigned char* in, size_t len, int nx, int ny,
+                    double tol, double* first, size_t col_stride) {
+  zgrid_model m;
+  zgrid_model_init(&m);
+  rc_decoder rc = {in, len, 0, 0xFFFFFFFFu, 0, 0};
+  for (int k = 0; k < 5; k++) {
+    rc.code = (rc.code << 8) | ((rc.pos < len) ? in[rc.pos++] : 0);
+  }
+  double* cols = (double*) malloc(2 * (size_t) ny * sizeof(double));
+  if (!cols) {
+    fprintf(stderr, "Memory allocation error\n");
+    exit(1);
+  }
+  double* prev = cols; // Reconstructed previous and current columns
+  double* cur  = cols + ny;
+
+  double step      = 2.0 * tol;
+  int    prev_zero = 1;
+  for (int i = 0; i < nx && !rc.overrun; i++) {
+    for (int j = 0; j < ny; j++) {
+      double pred = zgrid_predict(prev, cur, i, j);
+      long   q    = 0;
+      int    nz   = rc_decode_bit(&rc, &m.zero[prev_zero]);
+      prev_zero   = !nz;
+      if (nz) {
+        int neg = rc_decode_bit(&rc, &m.sign);
+        int k   = 0;
+        while (k < ZGRID_ESCAPE && rc_decode_bit(&rc, &m.prefix[k])) {
+          k++;
+        }
+        if (k == ZGRID_ESCAPE) {
+          uint64_t bits = 0;
+          for (int b = 63; b >= 0; b--) {
+            bits |= (uint64_t) rc_decode_bit(&rc, &m.raw) << b;
+          }
+          memcpy(&cur[j], &bits, sizeof(bits));
+          first[(size_t) i * col_stride + j] = cur[j];
+          continue;
+        }
+        unsigned long u = 1;
+        for (int b = k - 1; b >= 0; b--) {
+          u = (u << 1) | rc_decode_bit(&rc, &m.suffix[b]);
+        }
+        q = neg ? -(long) u : (long) u;
+      }
+      cur[j]                             = zgrid_reconstruct(pred, q, step);
+      first[(size_t) i * col_stride + j] = cur[j];
+    }
+    double* tmp = prev;
+    prev        = cur;
+    cur         = tmp;
+  }
+
+  free(cols);
+  return rc.overrun;
+}
@@ -61,3 +61,197 @@ int MPE_Decomp2d(int nrows, int ncols, int rank __attribute__((unused)),
     *col_e = ncols;
   return MPI_SUCCESS;
 }
+
+/**
+ * @brief Chooses the shape of the 2D process grid for an nx x ny domain.
+ *
+ * Considers every factorisation nprocs = dims[0] * dims[1] and picks the one
+ * that minimises the total length of the cuts between subdomains, i.e.,
+ * (dims[0] - 1) * nx + (dims[1] - 1) * ny. The long dimension is therefore
+ * split further than the short one. For square domains this gives the same
+ * grid as MPI_Dims_create.
+ *
+ * @param[in]  nprocs Total number of MPI processes.
+ * @param[in]  nx     Number of interior grid points in x-axis.
+ * @param[in]  ny     Number of interior grid points in y-axis.
+ * @param[out] dims   Number of processes splitting the rows (dims[0]) and the
+ *                    columns (dims[1]).
+ *
+ * @returns MPI_SUCCESS on successful completion, or MPI_ERR_DIMS if no
+ *          factorisation leaves every process with at least one point.
+ */
+int decomp2d_dims(int nprocs, int nx, int ny, int* dims) {
+  long best = -1;
+
+  // Walk from the tallest process grid downwards so that, on ties, we keep the
+  // ordering MPI_Dims_create would give (i.e., dims[0] >= dims[1])
+  for (int d0 = nprocs; d0 >= 1; d0--) {
+    if (nprocs % d0 != 0) {
+      continue;
+    }
+    int d1 = nprocs / d0;
+    if (d0 > ny || d1 > nx) { // Some process would own no rows or columns
+      continue;
+    }
+    long cut = (long) (d0 - 1) * nx + (long) (d1 - 1) * ny;
+    if (best < 0 || cut < best) {
+      best    = cut;
+      dims[0] = d0;
+      dims[1] = d1;
+    }
+  }
+  return (best < 0) ? MPI_ERR_DIMS : MPI_SUCCESS;
+}
+
+/**
+ * @brief Calculates a 1D decomposition with sizes proportional to weights.
+ *
+ * Every part receives one element, and the remaining n - size elements are
+ * shared out in proportion to weights[p] / sum(weights). The boundaries are
+ * rounded from the cumulative weights, so the sizes always add up to n.
+ *
+ * @param[in]  n       Total number of elements.
+ * @param[in]  size    Number of parts.
+ * @param[in]  part    Part to compute the bounds for (0 to size - 1).
+ * @param[in]  weights Relative speed of each part; all must be positive.
+ * @param[out] s       Pointer to store the starting index (1-based).
+ * @param[out] e       Pointer to store the ending index (1-based).
+ *
+ * @returns MPI_SUCCESS on successful completion.
+ */
+int MPE_Decomp1d_weighted(int n, int size, int part, double* weights, int* s,
+                          int* e) {
+  double total = 0.0;
+  double below = 0.0; // Sum of the weights of the parts before this one
+  for (int p = 0; p < size; p++) {
+    total += weights[p];
+    if (p < part) {
+      below += weights[p];
+    }
+  }
+
+  // Number of elements before this part and up to the end of it; rounding a
+  // non-decreasing sequence keeps it non-decreasing, so no part is empty
+  int lo = part + (int) ((n - size) * below / total + 0.5);
+  int hi =
+      part + 1 + (int) ((n - size) * (below + weights[part]) / total + 0.5);
+  *s = lo + 1;
+  *e = hi;
+  return MPI_SUCCESS;
+}
+
+/**
+ * @brief Calculates a weighted 2D domain decomposition for an MPI process.
+ *
+ * Same as MPE_Decomp2d, except that the height of each band of rows and the
+ * width of each band of columns is proportional to the weight of the process
+ * row or process column owning it, so that faster processes own more points.
+ *
+ * @param[in]  nrows  Total number of rows in the global grid.
+ * @param[in]  ncols  Total number of columns in the global grid.
+ * @param[in]  coords Array containing the process's coordinates in the 2D
+ *                    process grid.
+ * @param[out] row_s  Pointer to store the starting row index for this process.
+ * @param[out] row_e  Pointer to store the ending row index for this process.
+ * @param[out] col_s  Pointer to store the starting column index for this
+ *                    process.
+ * @param[out] col_e  Pointer to store the ending column index for this process.
+ * @param[in]  dims   Array containing the dimensions of the 2D process grid.
+ * @param[in]  row_w  Weight of each process row (dims[0] entries).
+ * @param[in]  col_w  Weight of each process column (dims[1] entries).
+ *
+ * @returns MPI_SUCCESS on successful completion.
+ */
+int MPE_Decomp2d_weighted(int nrows, int ncols, int* coords, int* row_s,
+                          int* row_e, int* col_s, int* col_e, int* dims,
+                          double* row_w, double* col_w) {
+  int s, e;
+
+  // Rows are numbered from the bottom while coords[0] = 0 is the top of the
+  // process grid, as in MPE_Decomp2d
+  MPE_Decomp1d_weighted(nrows, dims[0], coords[0], row_w, &s, &e);
+  *row_e = nrows - (s - 1);
+  *row_s = *row_e - (e - s);
+  MPE_Decomp1d_weighted(ncols, dims[1], coords[1], col_w, col_s, col_e);
+  return MPI_SUCCESS;
+}
+
+/**
+ * @brief Combines per-process speed weights into band weights.
+ *
+ * Gathers the weight of every process in the Cartesian communicator and
+ * averages them over each process row and each process column. Must be
+ * called by all processes in comm.
+ *
+ * @param[in]  weight Speed weight of the calling process.
+ * @param[in]  comm   2D Cartesian communicator.
+ * @param[in]  dims   Array containing the dimensions of the 2D process grid.
+ * @param[out] row_w  Average weight of each process row (dims[0] entries).
+ * @param[out] col_w  Average weight of each process column (dims[1] entries).
+ *
+ * @returns MPI_SUCCESS on successful completion.
+ */
+int decomp2d_band_weights(double weight, MPI_Comm comm, int* dims,
+                          double* row_w, double* col_w) {
+  int nprocs;
+  MPI_Comm_size(comm, &nprocs);
+  double* weights = (double*) malloc(nprocs * sizeof(double));
+  int*    counts  = (int*) calloc(dims[0] + dims[1], sizeof(int));
+  if (!weights || !counts) {
+    fprintf(stderr, "Memory allocation error\n");
+    MPI_Abort(comm, 1);
+  }
+  MPI_Allgather(&weight, 1, MPI_DOUBLE, weights, 1, MPI_DOUBLE, comm);
+
+  for (int p = 0; p < dims[0]; p++)
+    row_w[p] = 0.0;
+  for (int q = 0; q < dims[1]; q++)
+    col_w[q] = 0.0;
+  for (int r = 0; r < nprocs; r++) {
+    int c[2];
+    MPI_Cart_coords(comm, r, 2, c);
+    row_w[c[0]] += weights[r];
+    col_w[c[1]] += weights[r];
+    counts[c[0]]++;
+    counts[dims[0] + c[1]]++;
+  }
+  for (int p = 0; p < dims[0]; p++)
+    row_w[p] /= counts[p];
+  for (int q = 0; q < dims[1]; q++)
+    col_w[q] /= counts[dims[0] + q];
+
+  free(weights);
+  free(counts);
+  return MPI_SUCCESS;
+}
+
+/**
+ * @brief Reads per-process speed weights from a text file.
+ *
+ * The file holds one positive number per line; line r is the weight of the
+ * process with rank r in MPI_COMM_WORLD.
+ *
+ * @param[in]  filename Path to the weights file.
+ * @param[in]  nprocs   Number of weights to read.
+ * @param[out] weights  Array to store the weights.
+ *
+ * @returns 0 on success, non-zero if the file cannot be read or holds fewer
+ *          than nprocs positive values.
+ */
+int read_weights(const char* filename, int nprocs, double* weights) {
+  FILE* file = fopen(filename, "r");
+  if (!file) {
+    fprintf(stderr, "Error opening file %s for reading\n", filename);
+    return 1;
+  }
+  for (int r = 0; r < nprocs; r++) {
+    if (fscanf(file, "%lf", &weights[r]) != 1 || weights[r] <= 0.0) {
+      fprintf(stderr, "Expected %d positive weights in %s\n", nprocs,
+              filename);
+      fclose(file);
+      return 1;
+    }
+  }
+  fclose(file);
+  return 0;
+}
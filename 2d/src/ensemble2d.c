@@ -0,0 +1,291 @@
+/**
+ * @file  ensemble2d.c
+ * @brief Implementation of the ensembles of independent solves.
+ */
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../include/batch2d.h"
+#include "../include/decomp2d.h"
+#include "../include/ensemble2d.h"
+
+// Results kept for every task, as doubles so that they are reduced together
+enum {
+  RES_GROUP,
+  RES_NPROCS,
+  RES_ITERS,
+  RES_CONVERGED,
+  RES_TIME,
+  RES_MAX_ERROR,
+  RES_AVG_ERROR,
+  NRES
+};
+
+/**
+ * @brief Reads a task list of grid sizes from a text file.
+ *
+ * Every line holds nx and optionally ny, which defaults to nx; blank lines
+ * and lines starting with # are skipped.
+ *
+ * @param[in]  filename Path to the task list.
+ * @param[out] sizes    Newly allocated array of nx and ny of every task.
+ *
+ * @returns Number of tasks, or -1 if the file cannot be read or holds an
+ *          invalid line.
+ */
+int read_tasks2d(const char* filename, int** sizes) {
+  FILE* file = fopen(filename, "r");
+  if (!file) {
+    fprintf(stderr, "Error opening file %s for reading\n", filename);
+    return -1;
+  }
+  int  ntasks = 0, capacity = 0;
+  int* s      = NULL;
+  char line[256];
+  while (fgets(line, sizeof(line), file)) {
+    int  nx, ny, n;
+    char first;
+    if (sscanf(line, " %c", &first) != 1 || first == '#') {
+      continue;
+    }
+    n = sscanf(line, "%d %d", &nx, &ny);
+    if (n < 1 || nx < 1 || (n == 2 && ny < 1)) {
+      fprintf(stderr, "Invalid task in %s: %s", filename, line);
+      free(s);
+      fclose(file);
+      return -1;
+    }
+    if (ntasks == capacity) {
+      capacity = capacity ? 2 * capacity : 16;
+      int* grown = (int*) realloc(s, 2 * capacity * sizeof(int));
+      if (!grown) {
+        fprintf(stderr, "Memory allocation error\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+      }
+      s = grown;
+    }
+    s[2 * ntasks]     = nx;
+    s[2 * ntasks + 1] = (n == 2) ? ny : nx;
+    ntasks++;
+  }
+  fclose(file);
+  *sizes = s;
+  return ntasks;
+}
+
+/**
+ * @brief Solves one task on all processes of a group.
+ *
+ * The group is laid out as a Cartesian process grid and the grid is
+ * decomposed as in main.c.
+ *
+ * @param[in]  nx    Number of interior grid points in x-axis.
+ * @param[in]  ny    Number of interior grid points in y-axis.
+ * @param[in]  niter Maximum number of iterations.
+ * @param[in]  tol   Convergence tolerance of the global difference.
+ * @param[in]  comm  MPI communicator of the group.
+ * @param[out] res   Results of the task, filled in on every process.
+ */
+static void solve_task(int nx, int ny, int niter, double tol, MPI_Comm comm,
+                       double* res) {
+  int nprocs;
+  MPI_Comm_size(comm, &nprocs);
+  res[RES_NPROCS] = nprocs;
+
+  // A group too large for the grid leaves the task unsolved
+  int dims[2], periods[2] = {0, 0};
+  if (decomp2d_dims(nprocs, nx, ny, dims) != MPI_SUCCESS) {
+    res[RES_ITERS] = -1.0;
+    return;
+  }
+  MPI_Comm cart_comm;
+  int      cart_rank, coords[2];
+  int      nbrleft, nbrright, nbrup, nbrdown;
+  int      row_s, row_e, col_s, col_e;
+  MPI_Cart_create(comm, 2, dims, periods, 0, &cart_comm);
+  MPI_Comm_rank(cart_comm, &cart_rank);
+  MPI_Cart_coords(cart_comm, cart_rank, 2, coords);
+  MPI_Cart_shift(cart_comm, 0, 1, &nbrup, &nbrdown);
+  MPI_Cart_shift(cart_comm, 1, 1, &nbrleft, &nbrright);
+  MPE_Decomp2d(ny, nx, cart_rank, coords, &row_s, &row_e, &col_s, &col_e,
+               dims);
+
+  int    iters;
+  double diff, max_error, avg_error;
+  double t = MPI_Wtime();
+  iterate_batch2d(nx, ny, 1, row_s, row_e, col_s, col_e, nbrleft, nbrright,
+                  nbrup, nbrdown, niter, tol, cart_comm, &iters, &diff,
+                  &max_error, &avg_error);
+  res[RES_TIME]      = MPI_Wtime() - t;
+  res[RES_ITERS]     = iters;
+  res[RES_CONVERGED] = diff < tol;
+  res[RES_MAX_ERROR] = max_error;
+  res[RES_AVG_ERROR] = avg_error;
+  MPI_Comm_free(&cart_comm);
+}
+
+/**
+ * @brief Solves every task of a task list with groups of processes.
+ *
+ * The processes of comm are split into ngroups groups of consecutive ranks,
+ * so that a group tends to share a node. Every task solves the problem of
+ * the unbatched solver on its grid, using the kernels of batch2d.h. The root
+ * process prints the result of every task, with the group that solved it,
+ * and how busy each group was, and writes the results to a CSV file.
+ *
+ * @param[in] filename Path to the task list.
+ * @param[in] ngroups  Number of groups.
+ * @param[in] niter    Maximum number of iterations of every task.
+ * @param[in] tol      Convergence tolerance of every task.
+ * @param[in] comm     MPI communicator of all processes.
+ */
+void run_ensemble2d(const char* filename, int ngroups, int niter, double tol,
+                    MPI_Comm comm) {
+  int rank, nprocs;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &nprocs);
+  if (ngroups < 1 || ngroups > nprocs) {
+    ngroups = nprocs;
+  }
+
+  // Every process holds the task list
+  int  ntasks = 0;
+  int* sizes  = NULL;
+  if (rank == 0) {
+    ntasks = read_tasks2d(filename, &sizes);
+    if (ntasks < 0) {
+      MPI_Abort(comm, 1);
+    }
+  }
+  MPI_Bcast(&ntasks, 1, MPI_INT, 0, comm);
+  if (rank != 0) {
+    sizes = (int*) malloc((2 * ntasks + 1) * sizeof(int));
+    if (!sizes) {
+      fprintf(stderr, "Memory allocation error\n");
+      MPI_Abort(comm, 1);
+    }
+  }
+  MPI_Bcast(sizes, 2 * ntasks, MPI_INT, 0, comm);
+
+  // Groups of consecutive ranks, led by their lowest rank
+  MPI_Comm group_comm;
+  int      group = (int) ((long) rank * ngroups / nprocs), group_rank;
+  MPI_Comm_split(comm, group, rank, &group_comm);
+  MPI_Comm_rank(group_comm, &group_rank);
+  if (rank == 0) {
+    printf("Solving %d tasks from %s with %d groups of %d to %d "
+           "processes\n",
+           ntasks, filename, ngroups, nprocs / ngroups,
+           (nprocs + ngroups - 1) / ngroups);
+  }
+
+  // The counter of the next task lives on the root process
+  int     next = 0;
+  MPI_Win win;
+  MPI_Win_create((rank == 0) ? &next : NULL, (rank == 0) ? sizeof(int) : 0,
+                 sizeof(int), MPI_INFO_NULL, comm, &win);
+
+  double* res  = (double*) calloc((size_t) NRES * ntasks + 1, sizeof(double));
+  double* busy = (double*) calloc(2 * ngroups, sizeof(double));
+  if (!res || !busy) {
+    fprintf(stderr, "Memory allocation error\n");
+    MPI_Abort(comm, 1);
+  }
+  MPI_Barrier(comm);
+  double t1 = MPI_Wtime();
+  for (;;) {
+    int task, one = 1;
+    if (group_rank == 0) {
+      MPI_Win_lock(MPI_LOCK_SHARED, 0, 0, win);
+      MPI_Fetch_and_op(&one, &task, MPI_INT, 0, 0, MPI_SUM, win);
+      MPI_Win_unlock(0, win);
+    }
+    MPI_Bcast(&task, 1, MPI_INT, 0, group_comm);
+    if (task >= ntasks) {
+      break;
+    }
+    double* r = &res[(size_t) NRES * task];
+    solve_task(sizes[2 * task], sizes[2 * task + 1], niter, tol, group_comm,
+               r);
+    r[RES_GROUP] = group;
+    if (group_rank == 0) {
+      busy[group] += r[RES_TIME];
+      busy[ngroups + group] += 1.0;
+    } else {
+      for (int k = 0; k < NRES; k++) {
+        r[k] = 0.0; // Only the leader contributes to the reduction
+      }
+    }
+  }
+  double t2 = MPI_Wtime();
+  MPI_Win_free(&win);
+  MPI_Comm_free(&group_comm);
+
+  double* all_res  = NULL;
+  double* all_busy = NULL;
+  if (rank == 0) {
+    all_res  = (double*) malloc(((size_t) NRES * ntasks + 1) * sizeof(double));
+    all_busy = (double*) malloc(2 * ngroups * sizeof(double));
+    if (!all_res || !all_busy) {
+      fprintf(stderr, "Memory allocation error\n");
+      MPI_Abort(comm, 1);
+    }
+  }
+  MPI_Reduce(res, all_res, NRES * ntasks, MPI_DOUBLE, MPI_SUM, 0, comm);
+  MPI_Reduce(busy, all_busy, 2 * ngroups, MPI_DOUBLE, MPI_SUM, 0, comm);
+  double wall;
+  MPI_Reduce(&t2, &wall, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+
+  if (rank == 0) {
+    wall -= t1;
+    char csv_filename[256];
+    sprintf(csv_filename, "ensemble2dnprocs%d.csv", nprocs);
+    FILE* file = fopen(csv_filename, "w");
+    if (!file) {
+      fprintf(stderr, "Error opening file %s for writing\n", csv_filename);
+    } else {
+      fprintf(file, "task,nx,ny,group,nprocs,iterations,converged,time,"
+                    "max_error,avg_error\n");
+    }
+    printf("\n%6s %6s %6s %6s %6s %10s %12s %16s %16s\n", "Task", "nx", "ny",
+           "Group", "Procs", "Iterations", "Time", "Maximum error",
+           "Average error");
+    for (int t = 0; t < ntasks; t++) {
+      double* r = &all_res[(size_t) NRES * t];
+      if (r[RES_ITERS] < 0.0) {
+        printf("%6d %6d %6d %6.0f %6.0f   too small for the group\n", t,
+               sizes[2 * t], sizes[2 * t + 1], r[RES_GROUP], r[RES_NPROCS]);
+      } else {
+        printf("%6d %6d %6d %6.0f %6.0f %10.0f %12.6f %16.8e %16.8e%s\n", t,
+               sizes[2 * t], sizes[2 * t + 1], r[RES_GROUP], r[RES_NPROCS],
+               r[RES_ITERS], r[RES_TIME], r[RES_MAX_ERROR], r[RES_AVG_ERROR],
+               r[RES_CONVERGED] ? "" : " (not converged)");
+      }
+      if (file) {
+        fprintf(file, "%d,%d,%d,%.0f,%.0f,%.0f,%.0f,%.9f,%.8e,%.8e\n", t,
+                sizes[2 * t], sizes[2 * t + 1], r[RES_GROUP], r[RES_NPROCS],
+                r[RES_ITERS], r[RES_CONVERGED], r[RES_TIME],
+                r[RES_MAX_ERROR], r[RES_AVG_ERROR]);
+      }
+    }
+
+    // A group that finishes early only idles once the list has run out
+    printf("\nEnsemble completed in %.6f seconds\n", wall);
+    printf("%6s %6s %12s %8s\n", "Group", "Tasks", "Busy", "Busy %");
+    for (int g = 0; g < ngroups; g++) {
+      printf("%6d %6.0f %12.6f %7.1f%%\n", g, all_busy[ngroups + g],
+             all_busy[g], (wall > 0.0) ? 100.0 * all_busy[g] / wall : 0.0);
+    }
+    if (file) {
+      fclose(file);
+      printf("Results of every task written to %s\n", csv_filename);
+    }
+  }
+  free(sizes);
+  free(res);
+  free(busy);
+  free(all_res);
+  free(all_busy);
+}
@@ -8,134 +8,159 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "../include/aux.h"
+#include "../include/compress.h"
+#include "../include/decomp2d.h"
+#include "../include/gridfile.h"
 #include "../include/poisson2d.h"
 
+// Largest number of bytes passed to one MPI-IO call, which takes an int count
+#define WRITE_CHUNK (1 << 30)
+
 /**
  * @brief Gathers distributed 2D grid data from all processes to the root
  *        process.
  *
  * Collects 2D grid sections from all MPI processes and combines them into a
- * complete global grid on the root process.
+ * complete global grid on the root process. The root computes the bounds of
+ * every process itself from its Cartesian coordinates, and the interior of
+ * each local grid is moved in a single MPI_Alltoallw, described on both sides
+ * by subarray datatypes so that no packing is needed.
  *
- * @param[out] global_grid Array to store the complete gathered grid (only used
- *                         by root process).
- * @param[in]  a           Local grid array containing this process's portion of
- *                         the solution.
- * @param[in]  row_s       Starting row index of local domain.
- * @param[in]  row_e       Ending row index of local domain.
- * @param[in]  col_s       Starting column index of local domain.
- * @param[in]  col_e       Ending column index of local domain.
  * @param[in]  nx          Number of interior grid points in x-axis.
  * @param[in]  ny          Number of interior grid points in y-axis.
+ * @param[out] global_grid Array of size (nx + 2) x (ny + 2) to store the
+ *                         complete gathered grid (only used by root process).
+ * @param[in]  lnx         Number of local interior grid points in x-axis.
+ * @param[in]  lny         Number of local interior grid points in y-axis.
+ * @param[in]  a           Local grid array containing this process's portion of
+ *                         the solution.
  * @param[in]  myid        Rank of the current MPI process.
  * @param[in]  nprocs      Total number of MPI processes.
- * @param[in]  row_s_vals  Array containing start row indices for all processes.
- * @param[in]  row_e_vals  Array containing end row indices for all processes.
- * @param[in]  col_s_vals  Array containing start column indices for all
- *                         processes.
- * @param[in]  col_e_vals  Array containing end column indices for all
- *                         processes.
- * @param[in]  comm        MPI communicator.
+ * @param[in]  dims        Array containing the dimensions of the 2D process
+ *                         grid.
+ * @param[in]  row_w       Weight of each process row as passed to
+ *                         MPE_Decomp2d_weighted, or NULL if the domain was
+ *                         split with MPE_Decomp2d.
+ * @param[in]  col_w       Weight of each process column, or NULL.
+ * @param[in]  comm        2D Cartesian communicator.
  */
-void GatherGrid2D(double global_grid[][maxn], double a[][maxn], int row_s,
-                  int row_e, int col_s, int col_e, int nx, int ny, int myid,
-                  int nprocs, int* row_s_vals, int* row_e_vals, int* col_s_vals,
-                  int* col_e_vals, MPI_Comm comm) {
+void GatherGrid2D(int nx, int ny, double global_grid[][ny + 2], int lnx,
+                  int lny, double a[][lny + 2], int myid, int nprocs, int* dims,
+                  double* row_w, double* col_w, MPI_Comm comm) {
+
+  // MPI_Alltoallw arguments; displacements are in bytes and always zero, as
+  // the datatypes carry the offsets
+  MPI_Datatype* sendtypes =
+      (MPI_Datatype*) malloc(nprocs * sizeof(MPI_Datatype));
+  MPI_Datatype* recvtypes =
+      (MPI_Datatype*) malloc(nprocs * sizeof(MPI_Datatype));
+  int* sendcounts = (int*) calloc(nprocs, sizeof(int));
+  int* recvcounts = (int*) calloc(nprocs, sizeof(int));
+  int* displs     = (int*) calloc(nprocs, sizeof(int));
+  if (!sendtypes || !recvtypes || !sendcounts || !recvcounts || !displs) {
+    fprintf(stderr, "Memory allocation error\n");
+    MPI_Abort(comm, 1);
+  }
+  for (int p = 0; p < nprocs; p++) {
+    sendtypes[p] = MPI_DOUBLE;
+    recvtypes[p] = MPI_DOUBLE;
+  }
+
+  // Every process sends the interior of its local grid to the root only
+  int          msizes[2]  = {lnx + 2, lny + 2};
+  int          lsizes[2]  = {lnx, lny};
+  int          mstarts[2] = {1, 1};
+  MPI_Datatype interior_type;
+  MPI_Type_create_subarray(2, msizes, lsizes, mstarts, MPI_ORDER_C, MPI_DOUBLE,
+                           &interior_type);
+  MPI_Type_commit(&interior_type);
+  sendtypes[0]  = interior_type;
+  sendcounts[0] = 1;
+
   if (myid == 0) {
 
     // Initialize the global grid first
-    for (int i = 0; i < maxn; i++) {
-      for (int j = 0; j < maxn; j++) {
+    for (int i = 0; i <= nx + 1; i++) {
+      for (int j = 0; j <= ny + 1; j++) {
         global_grid[i][j] = 0.0;
       }
     }
 
-    // Copy local data from root process
-    for (int i = col_s; i <= col_e; i++) {
-      for (int j = row_s; j <= row_e; j++) {
-        global_grid[i][j] = a[i][j];
-      }
-    }
-
     double h = 1.0 / ((double) (nx + 1)); // Grid spacing
 
-    // Set the top boundary where u(x,1)=1/((1+x)^2+1)
+    // Set the top boundary where u(x,(ny+1)h)=y/((1+x)^2+y^2)
     for (int i = 0; i <= nx + 1; i++) {
-      double x               = i * h;
-      global_grid[i][ny + 1] = 1.0 / ((1.0 + x) * (1.0 + x) + 1.0);
+      global_grid[i][ny + 1] = analytical2d(i * h, (ny + 1) * h);
     }
 
     // Set the left boundary where u(0,y)=y/(1+y^2)
     for (int j = 0; j <= ny + 1; j++) {
-      double y = j * h;
-      if (j == 0 || (1.0 + y * y) == 0.0) { // Protect against division by zero
-        global_grid[0][j] = 0.0;
-      } else {
-        global_grid[0][j] = y / (1.0 + y * y);
-      }
+      global_grid[0][j] = analytical2d(0.0, j * h);
     }
 
     // Set the right boundary where u(1,y)=y/(4+y^2)
     for (int j = 0; j <= ny + 1; j++) {
-      double y = j * h;
-      if (j == 0 || (4.0 + y * y) == 0.0) { // Protect against division by zero
-        global_grid[nx + 1][j] = 0.0;
+      global_grid[nx + 1][j] = analytical2d((nx + 1) * h, j * h);
+    }
+
+    // Recompute the bounds of every process from its coordinates and describe
+    // where its block lies in the global grid
+    int gsizes[2] = {nx + 2, ny + 2};
+    for (int p = 0; p < nprocs; p++) {
+      int coords[2], row_s, row_e, col_s, col_e;
+      MPI_Cart_coords(comm, p, 2, coords);
+      if (row_w == NULL) {
+        MPE_Decomp2d(ny, nx, p, coords, &row_s, &row_e, &col_s, &col_e, dims);
       } else {
-        global_grid[nx + 1][j] = y / (4.0 + y * y);
+        MPE_Decomp2d_weighted(ny, nx, coords, &row_s, &row_e, &col_s, &col_e,
+                              dims, row_w, col_w);
       }
+      int psizes[2]  = {col_e - col_s + 1, row_e - row_s + 1};
+      int pstarts[2] = {col_s, row_s};
+      MPI_Type_create_subarray(2, gsizes, psizes, pstarts, MPI_ORDER_C,
+                               MPI_DOUBLE, &recvtypes[p]);
+      MPI_Type_commit(&recvtypes[p]);
+      recvcounts[p] = 1;
     }
   }
 
-  // Synchronize before data exchange
-  MPI_Barrier(comm);
+  MPI_Alltoallw(a, sendcounts, displs, sendtypes, global_grid, recvcounts,
+                displs, recvtypes, comm);
 
-  // Receive data into root process from other processes
-  if (myid != 0) {
-    int local_rows = row_e - row_s + 1;
-    for (int col = col_s; col <= col_e; col++) {
-      int tag = 10000 + myid * 100 + col; // Use a unique tag
-      MPI_Send(&a[col][row_s], local_rows, MPI_DOUBLE, 0, tag, comm);
-    }
-  } else { // Root process receives from all other processes
-    for (int p = 1; p < nprocs; p++) {
-      int p_row_s      = row_s_vals[p];
-      int p_row_e      = row_e_vals[p];
-      int p_col_s      = col_s_vals[p];
-      int p_col_e      = col_e_vals[p];
-      int p_local_rows = p_row_e - p_row_s + 1;
-      for (int col = p_col_s; col <= p_col_e; col++) {
-        MPI_Status status;
-        int        tag = 10000 + p * 100 + col; // Use a unique tag
-        MPI_Recv(&global_grid[col][p_row_s], p_local_rows, MPI_DOUBLE, p, tag,
-                 comm, &status);
-      }
+  if (myid == 0) {
+    for (int p = 0; p < nprocs; p++) {
+      MPI_Type_free(&recvtypes[p]);
     }
 
     // Message to state when the function has completed its task
     printf("Gathering complete\n");
   }
+
+  MPI_Type_free(&interior_type);
+  free(sendtypes);
+  free(recvtypes);
+  free(sendcounts);
+  free(recvcounts);
+  free(displs);
 }
 
 /**
  * @brief Writes 2D grid data to a file or terminal for visualization.
  *
+ * Only the interior points of the grid are written, i.e., the ghost cells (or,
+ * for a global grid, the boundary) are skipped.
+ *
  * @param[in] filename        Base name of the file to write.
+ * @param[in] lnx             Number of interior grid points in x-axis.
+ * @param[in] lny             Number of interior grid points in y-axis.
  * @param[in] a               Grid array containing the data to write.
- * @param[in] nx              Number of interior grid points in x-axis.
- * @param[in] ny              Number of interior grid points in y-axis.
  * @param[in] rank            Rank of the current MPI process.
- * @param[in] row_s           Starting row index of the grid portion to write.
- * @param[in] row_e           Ending row index of the grid portion to write.
- * @param[in] col_s           Starting column index of the grid portion to
- *                            write.
- * @param[in] col_e           Ending column index of the grid portion to write.
  * @param[in] write_to_stdout Flag to control whether to also print grid to
  *                            standard output.
  */
-void write_grid(char* filename, double a[][maxn],
-                int nx __attribute__((unused)), int ny __attribute__((unused)),
-                int rank, int row_s, int row_e, int col_s, int col_e,
-                int write_to_stdout) {
+void write_grid(char* filename, int lnx, int lny, double a[][lny + 2],
+                int rank, int write_to_stdout) {
 
   // Create filename with extension
   char full_filename[256];
@@ -150,11 +175,8 @@ void write_grid(char* filename, double a[][maxn],
 
   // Write to file in mesh/grid format; note that each row is a y-coordinate
   // whereas each column is an x-coordinate
-  for (int j = row_e; j >= row_s; j--) {
-    for (int i = col_s; i <= col_e; i++) {
-      fprintf(file, "%.6lf ", a[i][j]);
-    }
-    fprintf(file, "\n");
+  if (write_grid_text(file, lnx, lny, &a[1][1], lny + 2) != 0) {
+    fprintf(stderr, "Error writing file %s\n", full_filename);
   }
 
   fclose(file);
@@ -162,11 +184,194 @@ void write_grid(char* filename, double a[][maxn],
   // Write to terminal if requested
   if (write_to_stdout) {
     printf("Grid for process %d\n", rank);
-    for (int j = row_e; j >= row_s; j--) {
-      for (int i = col_s; i <= col_e; i++) {
-        printf("%.6lf ", a[i][j]);
-      }
-      printf("\n");
+    write_grid_text(stdout, lnx, lny, &a[1][1], lny + 2);
+  }
+}
+
+/**
+ * @brief Writes the distributed 2D grid into a single binary file using
+ *        collective MPI-IO.
+ *
+ * Every process sets a file view describing where its block lies in the
+ * global interior and writes the block straight from its local array with
+ * MPI_File_write_all, so that no process ever holds the whole grid. The file
+ * contains the nx x ny interior as native doubles, indexed as [column][row]
+ * like the in-memory grids, i.e., the row (y) index varies fastest.
+ *
+ * @param[in] filename Base name of the file to write.
+ * @param[in] nx       Number of interior grid points in x-axis.
+ * @param[in] ny       Number of interior grid points in y-axis.
+ * @param[in] lnx      Number of local interior grid points in x-axis.
+ * @param[in] lny      Number of local interior grid points in y-axis.
+ * @param[in] a        Local grid array containing this process's portion of
+ *                     the solution.
+ * @param[in] row_s    Starting row index of local domain.
+ * @param[in] col_s    Starting column index of local domain.
+ * @param[in] hdr      Header of the global grid, identical on all processes.
+ * @param[in] comm     MPI communicator.
+ *
+ * @returns MPI_SUCCESS on success, or the error code of the failing MPI-IO
+ *          call.
+ */
+int write_grid_mpiio(char* filename, int nx, int ny, int lnx, int lny,
+                     double a[][lny + 2], int row_s, int col_s,
+                     const grid_header* hdr, MPI_Comm comm) {
+
+  // Create filename with extension
+  char full_filename[256];
+  sprintf(full_filename, "%s.bin", filename);
+
+  // Position of the local interior within the global interior in the file
+  int          gsizes[2] = {nx, ny};
+  int          lsizes[2] = {lnx, lny};
+  int          starts[2] = {col_s - 1, row_s - 1};
+  MPI_Datatype filetype;
+  MPI_Type_create_subarray(2, gsizes, lsizes, starts, MPI_ORDER_C, MPI_DOUBLE,
+                           &filetype);
+  MPI_Type_commit(&filetype);
+
+  // Local interior within the local array, which skips the ghost cells
+  int          msizes[2]  = {lnx + 2, lny + 2};
+  int          mstarts[2] = {1, 1};
+  MPI_Datatype memtype;
+  MPI_Type_create_subarray(2, msizes, lsizes, mstarts, MPI_ORDER_C, MPI_DOUBLE,
+                           &memtype);
+  MPI_Type_commit(&memtype);
+
+  MPI_File fh;
+  int      err = MPI_File_open(comm, full_filename,
+                               MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL,
+                               &fh);
+  if (err == MPI_SUCCESS) {
+
+    // Truncate any older and larger file of the same name
+    MPI_File_set_size(fh, 0);
+    int rank;
+    MPI_Comm_rank(comm, &rank);
+    if (rank == 0) {
+      err = MPI_File_write_at(fh, 0, hdr, sizeof(grid_header), MPI_BYTE,
+                              MPI_STATUS_IGNORE);
+    }
+    MPI_File_set_view(fh, sizeof(grid_header), MPI_DOUBLE, filetype, "native",
+                      MPI_INFO_NULL);
+    int werr = MPI_File_write_all(fh, a, 1, memtype, MPI_STATUS_IGNORE);
+    err      = (err == MPI_SUCCESS) ? werr : err;
+    MPI_File_close(&fh);
+  }
+  if (err != MPI_SUCCESS) {
+    fprintf(stderr, "Error writing file %s\n", full_filename);
+  }
+
+  MPI_Type_free(&filetype);
+  MPI_Type_free(&memtype);
+  return err;
+}
+
+/**
+ * @brief Writes the distributed 2D grid into a single compressed file using
+ *        MPI-IO.
+ *
+ * Every process compresses its own block with compress_grid, the offsets of
+ * the compressed blocks are found with MPI_Exscan, and the blocks are written
+ * with MPI_File_write_at_all after the zgrid_header written by the root
+ * process. A block is written in chunks of WRITE_CHUNK bytes, so that it may
+ * exceed the range of an int.
+ *
+ * @param[in]  filename Base name of the file to write; ".zgrid" is appended.
+ * @param[in]  lnx      Number of local interior grid points in x-axis.
+ * @param[in]  lny      Number of local interior grid points in y-axis.
+ * @param[in]  a        Local grid array containing this process's portion of
+ *                      the solution.
+ * @param[in]  row_s    Starting row index of local domain.
+ * @param[in]  col_s    Starting column index of local domain.
+ * @param[in]  hdr      Header of the global grid, identical on all processes.
+ * @param[in]  tol      Absolute error bound; must be positive.
+ * @param[in]  comm     MPI communicator.
+ * @param[out] nbytes   Size of the file in bytes on all processes, or NULL.
+ *
+ * @returns MPI_SUCCESS on success, or the error code of the failing MPI-IO
+ *          call.
+ */
+int write_grid_compressed(char* filename, int lnx, int lny,
+                          double a[][lny + 2], int row_s, int col_s,
+                          const grid_header* hdr, double tol, MPI_Comm comm,
+                          long long* nbytes) {
+
+  // Compressed block, preceded by its header
+  unsigned char* data;
+  size_t         n   = compress_grid(lnx, lny, a, tol, &data);
+  zgrid_block    blk = {col_s, row_s, lnx, lny, n};
+  long long      len = sizeof(zgrid_block) + n;
+  unsigned char* buf = (unsigned char*) malloc(len);
+  if (!buf) {
+    fprintf(stderr, "Memory allocation error\n");
+    MPI_Abort(comm, 1);
+  }
+  memcpy(buf, &blk, sizeof(zgrid_block));
+  memcpy(buf + sizeof(zgrid_block), data, n);
+  free(data);
+
+  // Blocks are stored in rank order
+  int       rank, nprocs;
+  long long before = 0, total;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &nprocs);
+  MPI_Exscan(&len, &before, 1, MPI_LONG_LONG, MPI_SUM, comm);
+  if (rank == 0) {
+    before = 0; // MPI_Exscan leaves it undefined on the first process
+  }
+  MPI_Allreduce(&len, &total, 1, MPI_LONG_LONG, MPI_SUM, comm);
+  if (nbytes) {
+    *nbytes = sizeof(zgrid_header) + total;
+  }
+
+  // Create filename with extension
+  char full_filename[256];
+  sprintf(full_filename, "%s.zgrid", filename);
+
+  MPI_File fh;
+  int      err = MPI_File_open(comm, full_filename,
+                               MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL,
+                               &fh);
+  if (err == MPI_SUCCESS) {
+
+    // Truncate any older and larger file of the same name
+    MPI_File_set_size(fh, 0);
+    if (rank == 0) {
+      zgrid_header zhdr;
+      memset(&zhdr, 0, sizeof(zgrid_header));
+      memcpy(zhdr.magic, ZGRID_MAGIC, sizeof(ZGRID_MAGIC));
+      zhdr.order    = GRID_ORDER;
+      zhdr.version  = ZGRID_VERSION;
+      zhdr.nx       = hdr->nx;
+      zhdr.ny       = hdr->ny;
+      zhdr.it       = hdr->it;
+      zhdr.nblocks  = nprocs;
+      zhdr.h        = hdr->h;
+      zhdr.residual = hdr->residual;
+      zhdr.tol      = tol;
+      err = MPI_File_write_at(fh, 0, &zhdr, sizeof(zgrid_header), MPI_BYTE,
+                              MPI_STATUS_IGNORE);
     }
+
+    // Every process makes as many collective calls as the largest block needs
+    long long nchunks = (len + WRITE_CHUNK - 1) / WRITE_CHUNK, max_chunks;
+    MPI_Allreduce(&nchunks, &max_chunks, 1, MPI_LONG_LONG, MPI_MAX, comm);
+    for (long long c = 0; c < max_chunks; c++) {
+      long long  done   = (c < nchunks) ? c * WRITE_CHUNK : len;
+      int        count  = (int) ((len - done < WRITE_CHUNK) ? len - done
+                                                             : WRITE_CHUNK);
+      MPI_Offset offset = sizeof(zgrid_header) + before + done;
+      int werr = MPI_File_write_at_all(fh, offset, buf + done, count, MPI_BYTE,
+                                       MPI_STATUS_IGNORE);
+      err      = (err == MPI_SUCCESS) ? werr : err;
+    }
+    MPI_File_close(&fh);
   }
+  if (err != MPI_SUCCESS) {
+    fprintf(stderr, "Error writing file %s\n", full_filename);
+  }
+
+  free(buf);
+  return err;
 }
@@ -0,0 +1,272 @@
+/**
+ * @file  gridfile.c
+ * @brief Implementation of the binary grid file format.
+ */
+
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../include/gridfile.h"
+#include "../include/poisson2d.h"
+
+/**
+ * @brief Fills in a grid header.
+ *
+ * @param[out] hdr      Header to fill in.
+ * @param[in]  nx       Number of interior columns in the file.
+ * @param[in]  ny       Number of interior rows in the file.
+ * @param[in]  col_s    Global index of the first column.
+ * @param[in]  row_s    Global index of the first row.
+ * @param[in]  h        Grid spacing.
+ * @param[in]  it       Number of iterations carried out.
+ * @param[in]  residual Global difference of the last iteration.
+ */
+void grid_header_init(grid_header* hdr, int nx, int ny, int col_s, int row_s,
+                      double h, int it, double residual) {
+  memset(hdr, 0, sizeof(grid_header));
+  memcpy(hdr->magic, GRID_MAGIC, sizeof(GRID_MAGIC));
+  hdr->order    = GRID_ORDER;
+  hdr->version  = GRID_VERSION;
+  hdr->nx       = nx;
+  hdr->ny       = ny;
+  hdr->col_s    = col_s;
+  hdr->row_s    = row_s;
+  hdr->it       = it;
+  hdr->h        = h;
+  hdr->residual = residual;
+}
+
+/**
+ * @brief Writes the interior of a grid to a binary grid file.
+ *
+ * The ghost cells (or, for a global grid, the boundary) are skipped.
+ *
+ * @param[in] filename Base name of the file to write; ".bin" is appended.
+ * @param[in] lnx      Number of interior grid points in x-axis.
+ * @param[in] lny      Number of interior grid points in y-axis.
+ * @param[in] a        Grid array containing the data to write.
+ * @param[in] hdr      Header to write in front of the data; its nx and ny must
+ *                     match lnx and lny.
+ *
+ * @returns 0 on success, non-zero on error.
+ */
+int write_grid_bin(char* filename, int lnx, int lny, double a[][lny + 2],
+                   const grid_header* hdr) {
+
+  // Create filename with extension
+  char full_filename[256];
+  sprintf(full_filename, "%s.bin", filename);
+
+  // Open file for writing
+  FILE* file = fopen(full_filename, "wb");
+  if (!file) {
+    fprintf(stderr, "Error opening file %s for writing\n", full_filename);
+    return 1;
+  }
+
+  // Each column of the interior is contiguous in memory
+  int ok = fwrite(hdr, sizeof(grid_header), 1, file) == 1;
+  for (int i = 1; ok && i <= lnx; i++) {
+    ok = fwrite(&a[i][1], sizeof(double), lny, file) == (size_t) lny;
+  }
+
+  if (fclose(file) != 0 || !ok) {
+    fprintf(stderr, "Error writing file %s\n", full_filename);
+    return 1;
+  }
+  return 0;
+}
+
+/**
+ * @brief Maps a binary grid file into memory and checks its header.
+ *
+ * @param[in]  filename Full name of the file to read.
+ * @param[out] map      Mapping of the file; release it with grid_map_close.
+ *
+ * @returns 0 on success, non-zero on error.
+ */
+int grid_map_open(const char* filename, grid_map* map) {
+  memset(map, 0, sizeof(grid_map));
+
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "Error opening file %s for reading\n", filename);
+    return 1;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(grid_header)) {
+    fprintf(stderr, "%s is not a grid file\n", filename);
+    close(fd);
+    return 1;
+  }
+  void* base = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd); // The mapping stays valid after closing the descriptor
+  if (base == MAP_FAILED) {
+    fprintf(stderr, "Error mapping file %s\n", filename);
+    return 1;
+  }
+
+  // Check the header before trusting the sizes in it
+  const grid_header* hdr = (const grid_header*) base;
+  const char*        err = NULL;
+  if (memcmp(hdr->magic, GRID_MAGIC, sizeof(GRID_MAGIC)) != 0) {
+    err = "is not a grid file";
+  } else if (hdr->order != GRID_ORDER) {
+    err = "was written on a host with a different byte order";
+  } else if (hdr->version != GRID_VERSION) {
+    err = "has an unsupported version";
+  } else if (hdr->nx < 0 || hdr->ny < 0 ||
+             (size_t) st.st_size != sizeof(grid_header) +
+                                        (size_t) hdr->nx * hdr->ny *
+                                            sizeof(double)) {
+    err = "has the wrong size for its header";
+  }
+  if (err) {
+    fprintf(stderr, "%s %s\n", filename, err);
+    munmap(base, st.st_size);
+    return 1;
+  }
+
+  map->hdr  = hdr;
+  map->data = (const double*) ((const char*) base + sizeof(grid_header));
+  map->base = base;
+  map->len  = st.st_size;
+  return 0;
+}
+
+/**
+ * @brief Releases a mapping made by grid_map_open.
+ *
+ * @param[in,out] map Mapping to release.
+ */
+void grid_map_close(grid_map* map) {
+  if (map->base) {
+    munmap(map->base, map->len);
+  }
+  memset(map, 0, sizeof(grid_map));
+}
+
+/**
+ * @brief Formats a value exactly as printf("%.6lf ", x) would.
+ *
+ * Values below 2^52 / 10^6 in magnitude are rounded to six decimals with
+ * integer arithmetic; the error of x * 10^6 is recovered with fma so that
+ * ties are broken on the exact binary value, like printf does. Larger values,
+ * infinities and NaNs are handed to snprintf.
+ *
+ * @param[in]  x   Value to format.
+ * @param[out] out Buffer with room for at least GRID_TEXT_MAX characters; the
+ *                 result is not terminated.
+ *
+ * @returns Number of characters written.
+ */
+size_t format_grid_value(double x, char* out) {
+  double ax = fabs(x);
+  if (!(ax < 4503599627.0)) { // 2^52 / 10^6, and false for NaN
+    int n = snprintf(out, GRID_TEXT_MAX, "%.6lf ", x);
+    return (n < 0) ? 0 : (size_t) n;
+  }
+
+  // ax * 10^6 is exactly p + err; round it to the nearest integer r, with ties
+  // going to even
+  double p   = ax * 1e6;
+  double err = fma(ax, 1e6, -p);
+  double r   = nearbyint(p);
+  double d   = p - r; // Exact, as |p - r| <= 0.5
+  if (d - 0.5 > -err || (d - 0.5 == -err && fmod(r, 2.0) != 0.0)) {
+    r += 1.0;
+  } else if (d + 0.5 < -err ||
+             (d + 0.5 == -err && fmod(r, 2.0) != 0.0)) {
+    r -= 1.0;
+  }
+  uint64_t v = (uint64_t) r;
+
+  // Digits are produced backwards into a small scratch buffer
+  char   tmp[32];
+  size_t n = 0;
+  tmp[n++] = ' ';
+  for (int k = 0; k < 6; k++) {
+    tmp[n++] = (char) ('0' + v % 10);
+    v /= 10;
+  }
+  tmp[n++] = '.';
+  do {
+    tmp[n++] = (char) ('0' + v % 10);
+    v /= 10;
+  } while (v > 0);
+  if (signbit(x)) {
+    tmp[n++] = '-';
+  }
+  for (size_t k = 0; k < n; k++) {
+    out[k] = tmp[n - 1 - k];
+  }
+  return n;
+}
+
+/**
+ * @brief Writes a block of values in the text layout of write_grid.
+ *
+ * Rows are formatted with format_grid_value into a large buffer, which is
+ * only written to the stream when full, so that large grids take few system
+ * calls. Value (i, j), counted from 0, is first[i * col_stride + j].
+ *
+ * @param[in] file       Stream to write to.
+ * @param[in] nx         Number of columns.
+ * @param[in] ny         Number of rows.
+ * @param[in] first      Value in the first column and bottom row.
+ * @param[in] col_stride Distance between consecutive columns in memory.
+ *
+ * @returns 0 on success, non-zero on error.
+ */
+int write_grid_text(FILE* file, int nx, int ny, const double* first,
+                    size_t col_stride) {
+
+  // Rows are formatted into a large buffer which is written out when full
+  size_t cap = (size_t) 1 << 20;
+  char*  buf = (char*) malloc(cap);
+  if (!buf) {
+    fprintf(stderr, "Memory allocation error\n");
+    return 1;
+  }
+  size_t len = 0;
+
+  // Each row is a y-coordinate whereas each column is an x-coordinate
+  int bad = 0;
+  for (int j = ny - 1; j >= 0 && !bad; j--) {
+    for (int i = 0; i < nx; i++) {
+      if (cap - len < GRID_TEXT_MAX + 1) {
+        bad = fwrite(buf, 1, len, file) != len;
+        len = 0;
+      }
+      len += format_grid_value(first[(size_t) i * col_stride + j], buf + len);
+    }
+    buf[len++] = '\n';
+  }
+  if (!bad && len > 0) {
+    bad = fwrite(buf, 1, len, file) != len;
+  }
+  free(buf);
+  return (bad || ferror(file)) ? 1 : 0;
+}
+
+/**
+ * @brief Writes a mapped grid in the text layout of write_grid.
+ *
+ * Rows are written from the top (largest y) down, with "%.6lf " per point, so
+ * that the output can be plotted with scripts/heatmap.gp.
+ *
+ * @param[in] map  Mapping of the grid file.
+ * @param[in] file Stream to write to.
+ *
+ * @returns 0 on success, non-zero on error.
+ */
+int grid_map_write_text(const grid_map* map, FILE* file) {
+  return write_grid_text(file, map->hdr->nx, map->hdr->ny, map->data,
+                         map->hdr->ny);
+}
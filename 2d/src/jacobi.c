@@ -18,12 +18,9 @@
  * MPI_Sendrecv calls in both horizontal and vertical directions. Uses a custom
  * MPI datatype for exchanging non-contiguous vertical data.
  *
+ * @param[in]     lnx      Number of local interior grid points in x-axis.
+ * @param[in]     lny      Number of local interior grid points in y-axis.
  * @param[in,out] x        Grid array to exchange ghost cells for.
- * @param[in]     nx       Number of interior grid points in x-axis.
- * @param[in]     row_s    Starting row index of local domain.
- * @param[in]     row_e    Ending row index of local domain.
- * @param[in]     col_s    Starting column index of local domain.
- * @param[in]     col_e    Ending column index of local domain.
  * @param[in]     comm     MPI communicator.
  * @param[in]     nbrleft  Rank of the left neighboring process.
  * @param[in]     nbrright Rank of the right neighboring process.
@@ -31,35 +28,32 @@
  * @param[in]     nbrdown  Rank of the lower neighboring process.
  * @param[in]     row_type MPI datatype for exchanging non-contiguous row data.
  */
-void exchang2d_1(double x[][maxn], int nx __attribute__((unused)), int row_s,
-                 int row_e, int col_s, int col_e, MPI_Comm comm, int nbrleft,
-                 int nbrright, int nbrup, int nbrdown, MPI_Datatype row_type) {
-  int lny =
-      row_e - row_s +
-      1; // Calculates the number of rows in the local domain for this process
+void exchang2d_1(int lnx, int lny, double x[][lny + 2], MPI_Comm comm,
+                 int nbrleft, int nbrright, int nbrup, int nbrdown,
+                 MPI_Datatype row_type) {
 
   // Exchange in horizontal direction (i.e., left to right); these are
   // contiguous in memory
-  MPI_Sendrecv(&x[col_e][row_s], lny, MPI_DOUBLE, nbrright, 0,
-               &x[col_s - 1][row_s], lny, MPI_DOUBLE, nbrleft, 0, comm,
+  MPI_Sendrecv(&x[lnx][1], lny, MPI_DOUBLE, nbrright, 0, &x[0][1], lny,
+               MPI_DOUBLE, nbrleft, 0, comm,
                MPI_STATUS_IGNORE); // Sends the rightmost column to the right
                                    // neighbor and simultaneously receives the
                                    // left ghost column from the left neighbor
-  MPI_Sendrecv(&x[col_s][row_s], lny, MPI_DOUBLE, nbrleft, 1,
-               &x[col_e + 1][row_s], lny, MPI_DOUBLE, nbrright, 1, comm,
+  MPI_Sendrecv(&x[1][1], lny, MPI_DOUBLE, nbrleft, 1, &x[lnx + 1][1], lny,
+               MPI_DOUBLE, nbrright, 1, comm,
                MPI_STATUS_IGNORE); // Sends the leftmost column to the left
                                    // neighbor and simultaneously receives the
                                    // right ghost column from the right neighbor
 
   // Exchange in vertical direction (i.e., up to down); these are
   // non-contiguous in memory
-  MPI_Sendrecv(&x[col_s][row_e], 1, row_type, nbrup, 2, &x[col_s][row_s - 1], 1,
-               row_type, nbrdown, 2, comm,
+  MPI_Sendrecv(&x[1][lny], 1, row_type, nbrup, 2, &x[1][0], 1, row_type,
+               nbrdown, 2, comm,
                MPI_STATUS_IGNORE); // Sends the topmost row to the top neighbor
                                    // and simultaneously receives the bottom
                                    // ghost row from the bottom neighbor
-  MPI_Sendrecv(&x[col_s][row_s], 1, row_type, nbrdown, 3, &x[col_s][row_e + 1],
-               1, row_type, nbrup, 3, comm,
+  MPI_Sendrecv(&x[1][1], 1, row_type, nbrdown, 3, &x[1][lny + 1], 1, row_type,
+               nbrup, 3, comm,
                MPI_STATUS_IGNORE); // Sends the bottommost row to the bottom
                                    // neighbor and simultaneously receives the
                                    // top ghost row from the top neighbor
@@ -75,12 +69,9 @@ void exchang2d_1(double x[][maxn], int nx __attribute__((unused)), int row_s,
  * allows for potential overlap of communication and computation, improving
  * performance.
  *
+ * @param[in]     lnx      Number of local interior grid points in x-axis.
+ * @param[in]     lny      Number of local interior grid points in y-axis.
  * @param[in,out] x        Grid array to exchange ghost cells for.
- * @param[in]     nx       Number of interior grid points in x-axis.
- * @param[in]     row_s    Starting row index of local domain.
- * @param[in]     row_e    Ending row index of local domain.
- * @param[in]     col_s    Starting column index of local domain.
- * @param[in]     col_e    Ending column index of local domain.
  * @param[in]     comm     MPI communicator.
  * @param[in]     nbrleft  Rank of the left neighboring process.
  * @param[in]     nbrright Rank of the right neighboring process.
@@ -88,74 +79,254 @@ void exchang2d_1(double x[][maxn], int nx __attribute__((unused)), int row_s,
  * @param[in]     nbrdown  Rank of the lower neighboring process.
  * @param[in]     row_type MPI datatype for exchanging non-contiguous row data.
  */
-void exchang2d_nb(double x[][maxn], int nx __attribute__((unused)), int row_s,
-                  int row_e, int col_s, int col_e, MPI_Comm comm, int nbrleft,
-                  int nbrright, int nbrup, int nbrdown, MPI_Datatype row_type) {
-  int lny =
-      row_e - row_s +
-      1; // Calculates the number of rows in the local domain for this process
+void exchang2d_nb(int lnx, int lny, double x[][lny + 2], MPI_Comm comm,
+                  int nbrleft, int nbrright, int nbrup, int nbrdown,
+                  MPI_Datatype row_type) {
   MPI_Request reqs[8]; // Array to hold eight MPI request handles
 
   // Left boundary column, which is contiguous
-  MPI_Irecv(&x[col_s - 1][row_s], lny, MPI_DOUBLE, nbrleft, 0, comm,
+  MPI_Irecv(&x[0][1], lny, MPI_DOUBLE, nbrleft, 0, comm,
             &reqs[0]); // Receives the ghost column from the left neighbor into
-                       // the column at index col_s - 1
+                       // the column at index 0
 
   // Right boundary column, which is contiguous
-  MPI_Irecv(&x[col_e + 1][row_s], lny, MPI_DOUBLE, nbrright, 1, comm,
+  MPI_Irecv(&x[lnx + 1][1], lny, MPI_DOUBLE, nbrright, 1, comm,
             &reqs[1]); // Receives the ghost column from the right neighbor
-                       // into the column at index col_e + 1
+                       // into the column at index lnx + 1
 
   // Bottom boundary row, which is non-contiguous and thus, is using row_type
-  MPI_Irecv(&x[col_s][row_s - 1], 1, row_type, nbrdown, 2, comm,
+  MPI_Irecv(&x[1][0], 1, row_type, nbrdown, 2, comm,
             &reqs[2]); // Receives the ghost row from the bottom neighbor into
-                       // the row at index row_s - 1
+                       // the row at index 0
 
   // Top boundary row, which is non-contiguous and thus, is using row_type
-  MPI_Irecv(&x[col_s][row_e + 1], 1, row_type, nbrup, 3, comm,
+  MPI_Irecv(&x[1][lny + 1], 1, row_type, nbrup, 3, comm,
             &reqs[3]); // Receives the ghost row from the top neighbor into the
-                       // row at index row_e + 1
+                       // row at index lny + 1
 
   // Send rightmost column to right neighbor
-  MPI_Isend(&x[col_e][row_s], lny, MPI_DOUBLE, nbrright, 0, comm, &reqs[4]);
+  MPI_Isend(&x[lnx][1], lny, MPI_DOUBLE, nbrright, 0, comm, &reqs[4]);
 
   // Send leftmost column to left neighbor
-  MPI_Isend(&x[col_s][row_s], lny, MPI_DOUBLE, nbrleft, 1, comm, &reqs[5]);
+  MPI_Isend(&x[1][1], lny, MPI_DOUBLE, nbrleft, 1, comm, &reqs[5]);
 
   // Send topmost row to top neighbor, which is non-contiguous
-  MPI_Isend(&x[col_s][row_e], 1, row_type, nbrup, 2, comm, &reqs[6]);
+  MPI_Isend(&x[1][lny], 1, row_type, nbrup, 2, comm, &reqs[6]);
 
   // Send bottommost row to bottom neighbor, which is non-contiguous
-  MPI_Isend(&x[col_s][row_s], 1, row_type, nbrdown, 3, comm, &reqs[7]);
+  MPI_Isend(&x[1][1], 1, row_type, nbrdown, 3, comm, &reqs[7]);
 
   // Wait for all communications to complete
   MPI_Waitall(8, reqs, MPI_STATUSES_IGNORE);
 }
 
+/**
+ * @brief Exchanges ghost cells, including the four corners, with neighboring
+ *        processes using blocking communication.
+ *
+ * Performs a two-phase exchange: the columns are exchanged with the left and
+ * right neighbors first, and the rows are then exchanged with the upper and
+ * lower neighbors. As the rows include the ghost columns filled in the first
+ * phase, the corner values of the diagonal neighbors are forwarded without
+ * any diagonal messages.
+ *
+ * @param[in]     lnx           Number of local interior grid points in x-axis.
+ * @param[in]     lny           Number of local interior grid points in y-axis.
+ * @param[in,out] x             Grid array to exchange ghost cells for.
+ * @param[in]     comm          MPI communicator.
+ * @param[in]     nbrleft       Rank of the left neighboring process.
+ * @param[in]     nbrright      Rank of the right neighboring process.
+ * @param[in]     nbrup         Rank of the upper neighboring process.
+ * @param[in]     nbrdown       Rank of the lower neighboring process.
+ * @param[in]     full_row_type MPI datatype for a row of lnx + 2 elements,
+ *                              i.e., including both ghost columns.
+ */
+void exchang2d_corner(int lnx, int lny, double x[][lny + 2], MPI_Comm comm,
+                      int nbrleft, int nbrright, int nbrup, int nbrdown,
+                      MPI_Datatype full_row_type) {
+
+  // First phase: exchange the interior of the columns with the left and right
+  // neighbors; these are contiguous in memory
+  MPI_Sendrecv(&x[lnx][1], lny, MPI_DOUBLE, nbrright, 0, &x[0][1], lny,
+               MPI_DOUBLE, nbrleft, 0, comm, MPI_STATUS_IGNORE);
+  MPI_Sendrecv(&x[1][1], lny, MPI_DOUBLE, nbrleft, 1, &x[lnx + 1][1], lny,
+               MPI_DOUBLE, nbrright, 1, comm, MPI_STATUS_IGNORE);
+
+  // Second phase: exchange whole rows, starting at the left ghost column, with
+  // the upper and lower neighbors; the ends of these rows are the neighbors'
+  // ghost columns and so carry the diagonal neighbors' corner values
+  MPI_Sendrecv(&x[0][lny], 1, full_row_type, nbrup, 2, &x[0][0], 1,
+               full_row_type, nbrdown, 2, comm, MPI_STATUS_IGNORE);
+  MPI_Sendrecv(&x[0][1], 1, full_row_type, nbrdown, 3, &x[0][lny + 1], 1,
+               full_row_type, nbrup, 3, comm, MPI_STATUS_IGNORE);
+}
+
+/**
+ * @brief Creates the MPI datatypes used by the RMA ghost cell exchanges.
+ *
+ * The four sides are ordered as (left, right, down, up), i.e., (x-, x+, y-,
+ * y+). Both sets of datatypes are described with MPI_Type_create_subarray
+ * relative to the start of a local array, so that MPI_Get needs no
+ * displacement.
+ *
+ * @param[in]  lnx        Number of local interior grid points in x-axis.
+ * @param[in]  lny        Number of local interior grid points in y-axis.
+ * @param[in]  nbr_lsize  Extent of the neighbor on each side along the axis
+ *                        of the exchange, i.e., its lnx for the left and right
+ *                        sides and its lny for the lower and upper sides.
+ * @param[out] recv_types Ghost cells on each side, to be read into.
+ * @param[out] get_types  Interior cells of the neighbor on each side next to
+ *                        our block, in the neighbor's memory layout.
+ */
+void create_rma_types2d(int lnx, int lny, int* nbr_lsize,
+                        MPI_Datatype* recv_types, MPI_Datatype* get_types) {
+  int sizes[2]    = {lnx + 2, lny + 2};
+  int lsize[2]    = {lnx, lny};
+  int subsizes[2] = {0, 0};
+  int starts[2]   = {0, 0};
+
+  for (int d = 0; d < 4; d++) {
+    int axis  = d / 2;
+    int other = 1 - axis;
+    int side  = d % 2;
+
+    // One line of interior points along the side
+    subsizes[axis]  = 1;
+    subsizes[other] = lsize[other];
+    starts[other]   = 1;
+
+    // Ghost cells on the side
+    starts[axis] = side ? lsize[axis] + 1 : 0;
+    MPI_Type_create_subarray(2, sizes, subsizes, starts, MPI_ORDER_C,
+                             MPI_DOUBLE, &recv_types[d]);
+    MPI_Type_commit(&recv_types[d]);
+
+    // The neighbor's interior line on the opposite side of its block; its
+    // array only differs from ours in the extent along the exchange axis
+    int nbr_sizes[2] = {sizes[0], sizes[1]};
+    nbr_sizes[axis]  = nbr_lsize[d] + 2;
+    starts[axis]     = side ? 1 : nbr_lsize[d];
+    MPI_Type_create_subarray(2, nbr_sizes, subsizes, starts, MPI_ORDER_C,
+                             MPI_DOUBLE, &get_types[d]);
+    MPI_Type_commit(&get_types[d]);
+  }
+}
+
+/**
+ * @brief Frees the datatypes created by create_rma_types2d.
+ *
+ * @param[in,out] recv_types Ghost cells on each side.
+ * @param[in,out] get_types  Interior cells of the neighbor on each side.
+ */
+void free_rma_types2d(MPI_Datatype* recv_types, MPI_Datatype* get_types) {
+  for (int d = 0; d < 4; d++) {
+    MPI_Type_free(&recv_types[d]);
+    MPI_Type_free(&get_types[d]);
+  }
+}
+
+/**
+ * @brief Exchanges ghost cells with neighboring processes using RMA with
+ *        MPI_Win_fence synchronization.
+ *
+ * @param[in,out] x          Grid array exposed by win.
+ * @param[in]     nbrs       Ranks of the left, right, lower and upper
+ *                           neighboring processes.
+ * @param[in]     recv_types Ghost cells on each side.
+ * @param[in]     get_types  Interior cells of the neighbor on each side.
+ * @param[in]     win        MPI window object exposing the grid array.
+ */
+void exchang2d_rma_fence(double* x, int* nbrs, MPI_Datatype* recv_types,
+                         MPI_Datatype* get_types, MPI_Win win) {
+
+  // Start the RMA access epoch
+  MPI_Win_fence(0, win);
+
+  // Get the neighbor's interior line into our ghost cells on each side; both
+  // datatypes already carry their offsets, so the displacement is zero
+  for (int d = 0; d < 4; d++) {
+    if (nbrs[d] != MPI_PROC_NULL) {
+      MPI_Get(x, 1, recv_types[d], nbrs[d], 0, 1, get_types[d], win);
+    }
+  }
+
+  // End the RMA access epoch
+  MPI_Win_fence(0, win);
+}
+
+/**
+ * @brief Exchanges ghost cells with neighboring processes using RMA with
+ *        general active target (post-start-complete-wait) synchronization.
+ *
+ * Only the neighbors take part in each epoch, so that, unlike with
+ * MPI_Win_fence, no process waits for the whole communicator.
+ *
+ * @param[in,out] x          Grid array exposed by win.
+ * @param[in]     nbrs       Ranks of the left, right, lower and upper
+ *                           neighboring processes.
+ * @param[in]     recv_types Ghost cells on each side.
+ * @param[in]     get_types  Interior cells of the neighbor on each side.
+ * @param[in]     win        MPI window object exposing the grid array.
+ * @param[in]     group      MPI group of the communicator used for win.
+ */
+void exchang2d_rma_pscw(double* x, int* nbrs, MPI_Datatype* recv_types,
+                        MPI_Datatype* get_types, MPI_Win win, MPI_Group group) {
+  int neighbors[4];      // Processes we read from, which also read from us
+  int num_neighbors = 0; // Counter for neighbors
+
+  // Build the list of neighbors; with non-periodic boundaries no rank appears
+  // twice
+  for (int d = 0; d < 4; d++) {
+    if (nbrs[d] != MPI_PROC_NULL) {
+      neighbors[num_neighbors++] = nbrs[d];
+    }
+  }
+  if (num_neighbors == 0) {
+    return;
+  }
+
+  // The access and exposure groups are the same
+  MPI_Group nbr_group;
+  MPI_Group_incl(group, num_neighbors, neighbors, &nbr_group);
+
+  // Post our window for exposure and start our access epoch
+  MPI_Win_post(nbr_group, 0, win);
+  MPI_Win_start(nbr_group, 0, win);
+
+  // Get the neighbor's interior line into our ghost cells on each side
+  for (int d = 0; d < 4; d++) {
+    if (nbrs[d] != MPI_PROC_NULL) {
+      MPI_Get(x, 1, recv_types[d], nbrs[d], 0, 1, get_types[d], win);
+    }
+  }
+
+  // Complete our access epoch and wait for our exposure to complete
+  MPI_Win_complete(win);
+  MPI_Win_wait(win);
+
+  MPI_Group_free(&nbr_group);
+}
+
 /**
  * @brief Calculates the squared difference between two grid arrays.
  *
  * Computes the sum of squared differences between two grid arrays, which is
  * used to check for convergence between iterations of the Jacobi method.
  *
- * @param[in] a     First grid array.
- * @param[in] b     Second grid array.
- * @param[in] nx    Number of interior grid points in x-axis.
- * @param[in] row_s Starting row index of local domain.
- * @param[in] row_e Ending row index of local domain.
- * @param[in] col_s Starting column index of local domain.
- * @param[in] col_e Ending column index of local domain.
+ * @param[in] lnx Number of local interior grid points in x-axis.
+ * @param[in] lny Number of local interior grid points in y-axis.
+ * @param[in] a   First grid array.
+ * @param[in] b   Second grid array.
  *
  * @returns Sum of squared differences between the two grid arrays.
  */
-double griddiff2d(double a[][maxn], double b[][maxn],
-                  int nx __attribute__((unused)), int row_s, int row_e,
-                  int col_s, int col_e) {
+double griddiff2d(int lnx, int lny, double a[][lny + 2],
+                  double b[][lny + 2]) {
   double sum = 0.0;
   double tmp;
-  for (int i = col_s; i <= col_e; i++) {
-    for (int j = row_s; j <= row_e; j++) {
-      tmp = (a[i][j] - b[i][j]);
+  for (int i = 1; i <= lnx; i++) {
+    for (int j = 1; j <= lny; j++) {
+      tmp = (a[i][j] - b[i][j]); // GRIDDIFF2D_FLOPS counts these two lines
       sum = sum + tmp * tmp;
     }
   }
@@ -169,22 +340,89 @@ double griddiff2d(double a[][maxn], double b[][maxn],
  * point, computes the average of its four neighbors, adjusted by the right-hand
  * side function values, to solve the Poisson equation.
  *
- * @param[in]  a     Current iteration grid array.
- * @param[in]  f     Right-hand side function values.
- * @param[in]  nx    Number of interior grid points in x-axis.
- * @param[in]  row_s Starting row index of local domain.
- * @param[in]  row_e Ending row index of local domain.
- * @param[in]  col_s Starting column index of local domain.
- * @param[in]  col_e Ending column index of local domain.
- * @param[out] b     Next iteration grid array to store the updated values.
+ * @param[in]  lnx Number of local interior grid points in x-axis.
+ * @param[in]  lny Number of local interior grid points in y-axis.
+ * @param[in]  a   Current iteration grid array.
+ * @param[in]  f   Right-hand side function values.
+ * @param[in]  h   Grid spacing.
+ * @param[out] b   Next iteration grid array to store the updated values.
  */
-void sweep2d(double a[][maxn], double f[][maxn], int nx, int row_s, int row_e,
-             int col_s, int col_e, double b[][maxn]) {
-  double h = 1.0 / ((double) (nx + 1)); // Grid spacing
-  for (int i = col_s; i <= col_e; i++) {
-    for (int j = row_s; j <= row_e; j++) {
+void sweep2d(int lnx, int lny, double a[][lny + 2], double f[][lny + 2],
+             double h, double b[][lny + 2]) {
+  for (int i = 1; i <= lnx; i++) {
+    for (int j = 1; j <= lny; j++) {
+      // SWEEP2D_FLOPS counts the operations of this update
       b[i][j] = 0.25 * (a[i - 1][j] + a[i + 1][j] + a[i][j + 1] + a[i][j - 1] -
                         h * h * f[i][j]);
     }
   }
 }
+
+/**
+ * @brief Performs one Jacobi iteration step using the fourth-order compact
+ *        (Mehrstellen) 9-point stencil.
+ *
+ * Discretises the Poisson equation as
+ * 4(N+S+E+W) + (NE+NW+SE+SW) - 20u = h^2 (8f + f_N + f_S + f_E + f_W) / 2,
+ * which is fourth-order accurate. Requires the corner ghost cells of a and the
+ * edge ghost cells of f to be filled.
+ *
+ * @param[in]  lnx Number of local interior grid points in x-axis.
+ * @param[in]  lny Number of local interior grid points in y-axis.
+ * @param[in]  a   Current iteration grid array.
+ * @param[in]  f   Right-hand side function values.
+ * @param[in]  h   Grid spacing.
+ * @param[out] b   Next iteration grid array to store the updated values.
+ */
+void sweep2d_9pt(int lnx, int lny, double a[][lny + 2], double f[][lny + 2],
+                 double h, double b[][lny + 2]) {
+  for (int i = 1; i <= lnx; i++) {
+    for (int j = 1; j <= lny; j++) {
+      // SWEEP2D_9PT_FLOPS counts the operations of this update
+      double edges   = a[i - 1][j] + a[i + 1][j] + a[i][j + 1] + a[i][j - 1];
+      double corners = a[i - 1][j - 1] + a[i + 1][j - 1] + a[i - 1][j + 1] +
+                       a[i + 1][j + 1];
+      double rhs     = 8.0 * f[i][j] + f[i - 1][j] + f[i + 1][j] + f[i][j + 1] +
+                   f[i][j - 1];
+      b[i][j] = (4.0 * edges + corners - 0.5 * h * h * rhs) / 20.0;
+    }
+  }
+}
+
+/**
+ * @brief Measures the speed of sweep2d on the calling process.
+ *
+ * Times a few sweeps over a private n x n grid, so that the result reflects
+ * the speed of the core (and any other load on the node) rather than the
+ * problem being solved. Used to derive weights for the weighted
+ * decomposition.
+ *
+ * @param[in] n    Size of the calibration grid; interior points only.
+ * @param[in] reps Number of sweeps to time.
+ *
+ * @returns Grid points updated per second.
+ */
+double calibrate_sweep2d(int n, int reps) {
+  double(*a)[n + 2] = calloc((size_t) (n + 2) * (n + 2), sizeof(double));
+  double(*b)[n + 2] = calloc((size_t) (n + 2) * (n + 2), sizeof(double));
+  double(*f)[n + 2] = calloc((size_t) (n + 2) * (n + 2), sizeof(double));
+  if (!a || !b || !f) {
+    fprintf(stderr, "Memory allocation error\n");
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+
+  // One untimed sweep to fault in the pages, then the timed ones; a and b
+  // are swapped so that every sweep reads the previous result
+  double h = 1.0 / ((double) (n + 1));
+  sweep2d(n, n, a, f, h, b);
+  double t = MPI_Wtime();
+  for (int r = 0; r < reps; r++) {
+    sweep2d(n, n, (r % 2) ? b : a, f, h, (r % 2) ? a : b);
+  }
+  t = MPI_Wtime() - t;
+
+  free(a);
+  free(b);
+  free(f);
+  return (double) n * n * reps / t;
+}
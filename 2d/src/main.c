@@ -2,20 +2,71 @@
  * @file main.c
  */
 
+#include <getopt.h>
 #include <math.h>
 #include <mpi.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #include "../include/aux.h"
+#include "../include/batch2d.h"
+#include "../include/checkpoint.h"
 #include "../include/decomp2d.h"
+#include "../include/ensemble2d.h"
 #include "../include/gatherwrite.h"
+#include "../include/gridfile.h"
 #include "../include/jacobi.h"
+#include "../include/perfctr.h"
 #include "../include/poisson2d.h"
+#include "../include/roofline.h"
+#include "../include/snapshot.h"
+#include "../include/timers.h"
+#include "../include/topo2d.h"
+#include "../include/trace.h"
+#include "../include/warmstart2d.h"
 
 #define maxit 2000
 
+/**
+ * @brief Ghost cell exchange strategies which can be selected with -e; the
+ *        default alternates between blocking and non-blocking exchanges.
+ */
+enum exchange { EXCH_ALTERNATE, EXCH_BLOCKING, EXCH_NB, EXCH_FENCE, EXCH_PSCW };
+
+/**
+ * @brief Reports the time spent in each phase of the solver, along with the
+ *        load imbalance, the hardware counters and the trace if enabled.
+ *
+ * @param[in] comm          Cartesian MPI communicator.
+ * @param[in] size_suffix   Suffix of the output files.
+ * @param[in] perf_counters Whether hardware counters were read.
+ * @param[in] trace_events  Size of the trace buffers, 0 if not tracing.
+ */
+static void report_phases(MPI_Comm comm, const char* size_suffix,
+                          int perf_counters, int trace_events) {
+  int nprocs;
+  MPI_Comm_size(comm, &nprocs);
+  char timings_filename[256];
+  sprintf(timings_filename, "timings2dnprocs%d%s.csv", nprocs, size_suffix);
+  timers_report(comm, timings_filename);
+  char imbalance_filename[256];
+  sprintf(imbalance_filename, "imbalance2dnprocs%d%s.csv", nprocs,
+          size_suffix);
+  imbalance_report(comm, imbalance_filename);
+  if (perf_counters) {
+    char perf_filename[256];
+    sprintf(perf_filename, "perf2dnprocs%d%s.csv", nprocs, size_suffix);
+    perf_report(comm, perf_filename);
+  }
+  if (trace_events > 0) {
+    char trace_filename[256];
+    sprintf(trace_filename, "trace2dnprocs%d%s.json", nprocs, size_suffix);
+    trace_report(comm, trace_filename);
+  }
+}
+
 /**
  * @brief Main function.
  *
@@ -26,14 +77,7 @@
  */
 int main(int argc, char** argv) {
 
-  // Solution storage arrays
-  double a[maxn][maxn];           // Current solution grid
-  double b[maxn][maxn];           // Next iteration solution grid
-  double f[maxn][maxn];           // Right-hand side function values
-  double global_grid[maxn][maxn]; // Global solution after gathering from all
-                                  // processes using GatherGrid2D
-
-  // Problem size; note that for this assignment, they are equal
+  // Problem size
   int nx; // Size of the x-axis; interior points only
   int ny; // Size of the y-axis; interior points only
 
@@ -45,17 +89,99 @@ int main(int argc, char** argv) {
   // Domain decomposition
   int nbrup, nbrright, nbrdown, nbrleft;
   int row_s, row_e, col_s, col_e;
+  int lnx, lny; // Size of the local domain; interior points only
 
   // Iteration and convergence
   int    it;            // Iteration counter
   double glob_diff;     // Global differences between iterations
   double ldiff;         // Local difference on the respective process
-  double tol = 1.0E-11; // Convergence tolerance
+  double tol   = 1.0E-11; // Convergence tolerance
+  int    niter = maxit;   // Maximum number of iterations
+
+  // Ghost cell exchange strategy of the 5-point stencil; the 9-point stencil
+  // always uses exchang2d_corner
+  enum exchange exch        = EXCH_ALTERNATE;
+  const char*   exch_name[] = {"alternate", "blocking", "nb", "fence", "pscw"};
+
+  // Discretisation; 5 for the standard second-order stencil, or 9 for the
+  // fourth-order compact (Mehrstellen) stencil
+  int stencil = 5;
+
+  // Weighted decomposition; 0 splits the domain evenly, 1 uses the speed
+  // weights read from weights_file and 2 measures them with a short sweep2d
+  // calibration on every process
+  int     weighting    = 0;
+  char*   weights_file = NULL;
+  double* weights      = NULL; // Speed weight of every process (world rank)
+
+  // Node-aware placement; -1 leaves it to MPI_Cart_create, 0 tiles the process
+  // grid by the real nodes and a positive value simulates nodes of that many
+  // consecutive ranks
+  int placement = -1;
+  double* row_w = NULL; // Weight of each process row and column; these stay
+  double* col_w = NULL; // NULL for the even decomposition
+
+  // Output of the global solution; 0 gathers it onto the root process and
+  // writes text, 1 writes one binary file collectively with MPI-IO, and 2
+  // writes no files at all, e.g., for verifying large benchmarking runs
+  int output = 0;
+
+  // Format of the solution files; 0 is the binary grid format of gridfile.h
+  // and 1 the text layout that scripts/heatmap.gp reads
+  int text = 0;
+
+  // Checkpointing; the state is saved every checkpoint_every iterations (0
+  // disables it), and the run resumes from restart_file if one is given
+  int  checkpoint_every = 0;
+  char restart_file[256] = "";
+
+  // Snapshots of the solution are written every snapshot_every iterations (0
+  // disables them) without holding up the solver
+  int snapshot_every = 0;
+
+  // Absolute error bound of the lossy compression of the solution written
+  // with MPI-IO and of the snapshots; 0 writes them in full precision
+  double compress_tol = 0.0;
+
+  // Whether to measure the bandwidth and FLOP rate of the kernels against a
+  // STREAM-style triad after solving
+  int roofline = 0;
+
+  // Whether to read hardware performance counters in every timed phase
+  int perf_counters = 0;
+
+  // Whether to split the time of synchronising calls into waiting for the
+  // slowest process and the call itself, by a barrier before each of them
+  int wait_time = 0;
+
+  // Number of right-hand sides solved together in one batch (0 solves the
+  // single problem as usual)
+  int batch = 0;
+
+  // Task list of an ensemble of independent solves (empty solves the single
+  // problem as usual), and the number of process groups that share it out (0
+  // gives every process a group of its own)
+  char ensemble_file[256] = "";
+  int  groups             = 0;
+
+  // Coarsening factor, 2 or 4, of the grid solved first to give the initial
+  // guess (0 starts from zero as usual)
+  int warm_start = 0;
+
+  // Whether to print the part of the grid and the neighbours of every process
+  int layout = 0;
+
+  // Number of events kept per process when tracing the timed phases (0
+  // disables tracing), and how often an iteration is traced
+  int trace_events = 0;
+  int trace_every  = 1;
 
   double t1, t2; // Timing
 
-  // Initialise the MPI environment
-  MPI_Init(&argc, &argv);
+  // Initialise the MPI environment; the snapshot threads write with MPI-IO
+  // while the solver keeps calling MPI
+  int provided;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
   MPI_Comm_rank(MPI_COMM_WORLD, &myid);
   MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
   MPI_Get_processor_name(name, &namelen);
@@ -70,41 +196,244 @@ int main(int argc, char** argv) {
     // Process the command-line arguments which in turn, sets the size of our
     // problem (i.e., the grid size to use)
     if (myid == 0) {
-      if (argc > 2) {
-        fprintf(stderr, "Usage is as follows: mpirun -np nprocs %s nx\n",
+      int opt;
+      int bad = 0;
+      struct option long_opts[] = {
+          {"batch", required_argument, NULL, 'B'},
+          {"ensemble", required_argument, NULL, 'E'},
+          {"groups", required_argument, NULL, 'G'},
+          {"warm-start", required_argument, NULL, 'A'},
+          {"layout", no_argument, NULL, 'L'},
+          {"checkpoint", required_argument, NULL, 'c'},
+          {"restart", required_argument, NULL, 'r'},
+          {"snapshot", required_argument, NULL, 'n'},
+          {"compress", required_argument, NULL, 'z'},
+          {"roofline", no_argument, NULL, 'R'},
+          {"perf", no_argument, NULL, 'P'},
+          {"wait-time", no_argument, NULL, 'W'},
+          {"trace", required_argument, NULL, 'T'},
+          {"trace-every", required_argument, NULL, 'S'},
+          {NULL, 0, NULL, 0}};
+      while ((opt = getopt_long(argc, argv, "c:e:f:i:n:o:p:r:s:t:w:z:",
+                                long_opts, NULL)) != -1) {
+        switch (opt) {
+          case 'A':
+            warm_start = atoi(optarg);
+            bad        = bad || (warm_start != 2 && warm_start != 4);
+            break;
+          case 'B':
+            batch = atoi(optarg);
+            bad   = bad || batch < 1;
+            break;
+          case 'E':
+            snprintf(ensemble_file, sizeof(ensemble_file), "%s", optarg);
+            break;
+          case 'G':
+            groups = atoi(optarg);
+            bad    = bad || groups < 1;
+            break;
+          case 'c':
+            checkpoint_every = atoi(optarg);
+            bad              = bad || checkpoint_every < 0;
+            break;
+          case 'e':
+            bad = 1;
+            for (int k = 0; k < 5; k++) {
+              if (strcmp(optarg, exch_name[k]) == 0) {
+                exch = (enum exchange) k;
+                bad  = 0;
+              }
+            }
+            break;
+          case 'f':
+            text = (strcmp(optarg, "text") == 0) ? 1 : 0;
+            bad  = bad || (text == 0 && strcmp(optarg, "bin") != 0);
+            break;
+          case 'i':
+            niter = atoi(optarg);
+            bad   = bad || niter < 1;
+            break;
+          case 'n':
+            snapshot_every = atoi(optarg);
+            bad            = bad || snapshot_every < 0;
+            break;
+          case 'o':
+            output = (strcmp(optarg, "mpiio") == 0)  ? 1
+                     : (strcmp(optarg, "none") == 0) ? 2
+                                                     : 0;
+            bad    = bad || (output == 0 && strcmp(optarg, "text") != 0);
+            break;
+          case 'p':
+            placement = (strcmp(optarg, "node") == 0) ? 0 : atoi(optarg);
+            bad       = bad || placement < 0;
+            break;
+          case 'r':
+            snprintf(restart_file, sizeof(restart_file), "%s", optarg);
+            break;
+          case 'L': layout = 1; break;
+          case 'P': perf_counters = 1; break;
+          case 'W': wait_time = 1; break;
+          case 'R': roofline = 1; break;
+          case 'S':
+            trace_every = atoi(optarg);
+            bad         = bad || trace_every < 1;
+            break;
+          case 'T':
+            trace_events = atoi(optarg);
+            bad          = bad || trace_events < 1;
+            break;
+          case 's': stencil = atoi(optarg); break;
+          case 't': tol = atof(optarg); break;
+          case 'w':
+            weighting    = (strcmp(optarg, "calibrate") == 0) ? 2 : 1;
+            weights_file = optarg;
+            break;
+          case 'z':
+            compress_tol = atof(optarg);
+            bad          = bad || !(compress_tol > 0.0);
+            break;
+          default: bad = 1;
+        }
+      }
+      if (bad || argc - optind > 2 || (stencil != 5 && stencil != 9) ||
+          (stencil == 9 && exch != EXCH_ALTERNATE) ||
+          (batch > 0 && (stencil == 9 || exch != EXCH_ALTERNATE ||
+                         checkpoint_every > 0 || snapshot_every > 0 ||
+                         restart_file[0] != '\0')) ||
+          (ensemble_file[0] != '\0' &&
+           (batch > 0 || stencil == 9 || exch != EXCH_ALTERNATE ||
+            checkpoint_every > 0 || snapshot_every > 0 ||
+            restart_file[0] != '\0' || weighting != 0)) ||
+          (warm_start > 0 && (batch > 0 || ensemble_file[0] != '\0' ||
+                              restart_file[0] != '\0'))) {
+        fprintf(stderr,
+                "Usage is as follows: mpirun -np nprocs %s [--batch K] "
+                "[--ensemble file] [--groups G] [--warm-start 2|4] "
+                "[--checkpoint N] [--restart file] [--snapshot N] [--layout] "
+                "[--compress tol] [--roofline] [--perf] [--trace N] "
+                "[--trace-every K] [--wait-time] "
+                "[-e alternate|blocking|nb|fence|pscw] [-f bin|text] "
+                "[-i maxit] [-o text|mpiio|none] [-p node|N] [-s 5|9] [-t tol] "
+                "[-w weights_file|calibrate] [nx [ny]]\n",
                 argv[0]);
-        fprintf(stderr, "Note that nx = ny, so specifying nx is enough\n");
+        fprintf(stderr, "Note that -e only applies to the 5-point stencil\n");
+        fprintf(stderr, "Note that --batch only applies to the 5-point "
+                        "stencil without -e, checkpoints or snapshots\n");
+        fprintf(stderr, "Note that --ensemble also excludes --batch and -w, "
+                        "and takes its grid sizes from the file\n");
+        fprintf(stderr, "Note that --warm-start cannot be combined with "
+                        "--batch, --ensemble or --restart\n");
+        fprintf(stderr, "Note that ny defaults to nx if it is not specified\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+      }
+      nx = (optind < argc) ? atoi(argv[optind])
+                           : default_nx; // We default to a 31 x 31 grid as
+                                         // per the third question
+      ny = (optind + 1 < argc) ? atoi(argv[optind + 1]) : nx;
+      if (nx < 1 || ny < 1) {
+        fprintf(stderr, "Grid size must be positive\n");
         MPI_Abort(MPI_COMM_WORLD, 1);
       }
-      if (argc == 2) {
-        nx = atoi(argv[1]);
+      if (ensemble_file[0] == '\0') { // An ensemble reports its own tasks
+        printf("Solving the Poisson equation on a %d x %d grid with %d "
+               "processors\n",
+               nx, ny, nprocs);
       }
-      if (argc == 1) { // We default to a 31 x 31 grid as per the third question
-        nx = 31;
+      if (stencil == 9) {
+        printf("Using the fourth-order 9-point compact stencil\n");
+      } else if (exch != EXCH_ALTERNATE) {
+        printf("Ghost cells are exchanged using %s\n", exch_name[exch]);
+      }
+      if (weighting == 1) {
+        weights = (double*) malloc(nprocs * sizeof(double));
+        if (!weights || read_weights(weights_file, nprocs, weights) != 0) {
+          MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        printf("Using the speed weights in %s\n", weights_file);
       }
-      if (nx > maxn - 2) {
-        fprintf(stderr, "Grid size is too large\n");
-        exit(1);
+      if (weighting == 2) {
+        printf("Using speed weights from a sweep2d calibration\n");
       }
-      printf("Solving the Poisson equation on a %d x %d grid with %d "
-             "processors\n",
-             nx, nx, nprocs);
     }
   }
 
   // Use MPI_Bcast to broadcast the grid size to all processes
   MPI_Bcast(&nx, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast(&ny, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast(&stencil, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast(&exch, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast(&niter, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast(&tol, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+  MPI_Bcast(&weighting, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast(&placement, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast(&output, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast(&text, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast(&checkpoint_every, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast(&snapshot_every, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast(&compress_tol, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+  MPI_Bcast(&roofline, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast(&perf_counters, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast(&wait_time, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast(&batch, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast(&trace_events, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast(&trace_every, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast(&groups, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast(&warm_start, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast(&layout, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Bcast(restart_file, sizeof(restart_file), MPI_CHAR, 0, MPI_COMM_WORLD);
+  MPI_Bcast(ensemble_file, sizeof(ensemble_file), MPI_CHAR, 0,
+            MPI_COMM_WORLD);
+  if (weighting == 1) {
+    if (myid != 0) {
+      weights = (double*) malloc(nprocs * sizeof(double));
+      if (!weights) {
+        fprintf(stderr, "Memory allocation error\n");
+        MPI_Abort(MPI_COMM_WORLD, 1);
+      }
+    }
+    MPI_Bcast(weights, nprocs, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+  }
   // printf("Process %d has nx = %d\n", myid, nx); // Debugging
-  ny = nx; // Square grid
 
-  // Initialise arrays
-  init_full_grids(a, b, f);
+  // An ensemble lays out a Cartesian communicator per group and task, so
+  // none of the set-up of the single problem below applies to it
+  if (ensemble_file[0] != '\0') {
+    if (perf_counters) {
+      perf_init(MPI_COMM_WORLD);
+    }
+    if (trace_events > 0) {
+      trace_init(trace_events, trace_every, MPI_COMM_WORLD);
+    }
+    timer_wait_split = wait_time;
+    run_ensemble2d(ensemble_file, (groups > 0) ? groups : nprocs, niter, tol,
+                   MPI_COMM_WORLD);
+
+    // The load balance of an ensemble is that of its groups, reported above
+    char report_filename[256];
+    sprintf(report_filename, "timings2dnprocs%densemble.csv", nprocs);
+    timers_report(MPI_COMM_WORLD, report_filename);
+    if (perf_counters) {
+      sprintf(report_filename, "perf2dnprocs%densemble.csv", nprocs);
+      perf_report(MPI_COMM_WORLD, report_filename);
+    }
+    if (trace_events > 0) {
+      sprintf(report_filename, "trace2dnprocs%densemble.json", nprocs);
+      trace_report(MPI_COMM_WORLD, report_filename);
+    }
+    if (myid == 0) {
+      printf("\n=======================================================\n");
+      printf("                        SUCCESS                        \n");
+      printf("=======================================================\n\n");
+    }
+    MPI_Finalize();
+    return 0;
+  }
 
   // MPI_Cart_create as per the assignment instructions
   int ndims =
       2; // Number of dimensions in the Cartesian topology; it is 2 for 2D
-  int dims[2] = {0, 0}; // Number of processes in each dimension; initialised to
-                        // 0 to let MPI_Dims_create compute optimal values
+  int dims[2];  // Number of processes in each dimension; dims[0] splits the
+                // rows (y-axis) and dims[1] splits the columns (x-axis)
   int periods[2] = {
       0, 0}; // This is set to 0 to ensure non-periodic boundaries meaning that
              // processes at the edge have no neighbour in that directions
@@ -114,10 +443,77 @@ int main(int argc, char** argv) {
   MPI_Comm cart_comm; // Our communicator
   int coords[2]; // Will store the coordinates in the Cartesian grid for the
                  // process in question
-  MPI_Dims_create(nprocs, ndims,
-                  dims); // Create a balanced distribution across our dimensions
+  if (decomp2d_dims(nprocs, nx, ny, dims) !=
+      MPI_SUCCESS) { // Split the longer dimension further
+    if (myid == 0) {
+      fprintf(stderr, "Cannot decompose a %d x %d grid over %d processes\n",
+              nx, ny, nprocs);
+    }
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
   MPI_Cart_create(MPI_COMM_WORLD, ndims, dims, periods, reorder,
                   &cart_comm); // Create the Cartesian communicator
+
+  // Replace the Cartesian communicator with one whose ranks are permuted so
+  // that every node owns a contiguous tile of the process grid
+  if (placement >= 0) {
+    int* leaders       = (int*) malloc(nprocs * sizeof(int));
+    int* cart_to_world = (int*) malloc(nprocs * sizeof(int));
+    int* cart_ranks    = (int*) malloc(nprocs * sizeof(int));
+    if (!leaders || !cart_to_world || !cart_ranks) {
+      fprintf(stderr, "Memory allocation error\n");
+      MPI_Abort(MPI_COMM_WORLD, 1);
+    }
+    topo2d_node_leaders(MPI_COMM_WORLD, placement, leaders);
+
+    // Placement chosen by MPI_Cart_create
+    MPI_Group world_group, cart_group;
+    MPI_Comm_group(MPI_COMM_WORLD, &world_group);
+    MPI_Comm_group(cart_comm, &cart_group);
+    for (int r = 0; r < nprocs; r++) {
+      cart_ranks[r] = r;
+    }
+    MPI_Group_translate_ranks(cart_group, nprocs, cart_ranks, world_group,
+                              cart_to_world);
+    MPI_Group_free(&world_group);
+    MPI_Group_free(&cart_group);
+    int intra_before, inter_before;
+    topo2d_count_edges(dims, cart_to_world, leaders, &intra_before,
+                       &inter_before);
+
+    // Node-aware placement; the new communicator orders the ranks by their
+    // position in the process grid, so MPI_Cart_create must not reorder them
+    int intra_after, inter_after, key = 0;
+    topo2d_map_tiles(nprocs, dims, leaders, cart_to_world);
+    topo2d_count_edges(dims, cart_to_world, leaders, &intra_after,
+                       &inter_after);
+    if (inter_after < inter_before) {
+      for (int r = 0; r < nprocs; r++) {
+        if (cart_to_world[r] == myid) {
+          key = r;
+        }
+      }
+      MPI_Comm perm_comm;
+      MPI_Comm_split(MPI_COMM_WORLD, 0, key, &perm_comm);
+      MPI_Comm_free(&cart_comm);
+      MPI_Cart_create(perm_comm, ndims, dims, periods, 0, &cart_comm);
+      MPI_Comm_free(&perm_comm);
+    }
+
+    if (myid == 0) {
+      printf("\nHalo edges (intra-node / inter-node): %d / %d before "
+             "remapping, %d / %d after\n",
+             intra_before, inter_before, intra_after, inter_after);
+      if (inter_after >= inter_before) {
+        printf("Keeping the placement of MPI_Cart_create as remapping does "
+               "not reduce inter-node edges\n");
+      }
+    }
+    free(leaders);
+    free(cart_to_world);
+    free(cart_ranks);
+  }
+
   MPI_Comm_rank(
       cart_comm,
       &cart_rank); // Get this process's rank in the Cartesian communicator
@@ -148,57 +544,289 @@ int main(int argc, char** argv) {
                               // rightward neighbour
   }
 
-  // Compute local domain bounds using a 2D decomposition
-  MPE_Decomp2d(nx, ny, cart_rank, coords, &row_s, &row_e, &col_s, &col_e, dims);
+  // Compute local domain bounds using a 2D decomposition; rows run along the
+  // y-axis and columns along the x-axis
+  if (weighting == 0) {
+    MPE_Decomp2d(ny, nx, cart_rank, coords, &row_s, &row_e, &col_s, &col_e,
+                 dims);
+  } else {
 
-  // Print process layout
-  MPI_Barrier(cart_comm);
-  if (cart_rank == 0) {
-    printf("\nLayout of our grid\n");
+    // Size each band of rows and columns in proportion to the average speed
+    // of the processes sharing it
+    double weight =
+        (weighting == 1) ? weights[myid] : calibrate_sweep2d(256, 20);
+    row_w = (double*) malloc(dims[0] * sizeof(double));
+    col_w = (double*) malloc(dims[1] * sizeof(double));
+    if (!row_w || !col_w) {
+      fprintf(stderr, "Memory allocation error\n");
+      MPI_Abort(cart_comm, 1);
+    }
+    decomp2d_band_weights(weight, cart_comm, dims, row_w, col_w);
+    if (cart_rank == 0) {
+      printf("\nWeights of the process rows (top to bottom):");
+      for (int p = 0; p < dims[0]; p++) {
+        printf(" %.3g", row_w[p]);
+      }
+      printf("\nWeights of the process columns (left to right):");
+      for (int q = 0; q < dims[1]; q++) {
+        printf(" %.3g", col_w[q]);
+      }
+      printf("\n");
+    }
+    MPE_Decomp2d_weighted(ny, nx, coords, &row_s, &row_e, &col_s, &col_e, dims,
+                          row_w, col_w);
   }
-  for (int p = 0; p < nprocs; p++) {
-    if (p == cart_rank) {
-      printf("Process %2d: Coords = (%d, %d) | Domain = (rows %2d to %2d, cols "
-             "%2d to %2d) | Neighbours = (U: %2d, D: %2d, L: %2d, R: %2d)\n",
-             cart_rank, coords[0], coords[1], row_s, row_e, col_s, col_e, nbrup,
-             nbrdown, nbrleft, nbrright);
-      fflush(stdout);
+  lnx = col_e - col_s + 1;
+  lny = row_e - row_s + 1;
+
+  // Solution storage arrays; these only cover the local domain plus ghost
+  // cells, and are indexed as [column][row]
+  double(*a)[lny + 2] = malloc(sizeof(double[lnx + 2][lny + 2])); // Current
+  double(*b)[lny + 2] = malloc(sizeof(double[lnx + 2][lny + 2])); // Next
+  double(*f)[lny + 2] = malloc(sizeof(double[lnx + 2][lny + 2])); // RHS
+  if (!a || !b || !f) {
+    fprintf(stderr, "Memory allocation error\n");
+    MPI_Abort(cart_comm, 1);
+  }
+
+  // Print process layout; the root gathers the part of every process and
+  // prints it in one go, and only when asked, as it grows with nprocs
+  if (layout) {
+    int  mine[10] = {coords[0], coords[1], row_s,   row_e,   col_s,
+                     col_e,     nbrup,     nbrdown, nbrleft, nbrright};
+    int* all      = NULL;
+    if (cart_rank == 0) {
+      all = (int*) malloc(10 * nprocs * sizeof(int));
+      if (!all) {
+        fprintf(stderr, "Memory allocation error\n");
+        MPI_Abort(cart_comm, 1);
+      }
+    }
+    MPI_Gather(mine, 10, MPI_INT, all, 10, MPI_INT, 0, cart_comm);
+    if (cart_rank == 0) {
+      printf("\nLayout of our grid\n");
+      for (int p = 0; p < nprocs; p++) {
+        int* l = &all[10 * p];
+        printf("Process %2d: Coords = (%d, %d) | Domain = (rows %2d to %2d, "
+               "cols %2d to %2d) | Neighbours = (U: %2d, D: %2d, L: %2d, "
+               "R: %2d)\n",
+               p, l[0], l[1], l[2], l[3], l[4], l[5], l[6], l[7], l[8], l[9]);
+      }
+      free(all);
     }
-    usleep(1000); // Small delay
-    MPI_Barrier(cart_comm);
   }
 
-  // Initialise grid with boundary conditions
-  init_twod(a, b, f, nx, ny, row_s, row_e, col_s, col_e);
+  // Initialise the local arrays, ghost cells included, with the boundary
+  // conditions
+  init_twod(lnx, lny, a, b, f, nx, ny, row_s, row_e, col_s, col_e);
 
   // Create an MPI_Datatype for row exchanges (i.e., non-contiguous data)
-  int          lnx = col_e - col_s + 1;
   MPI_Datatype row_type;
-  MPI_Type_vector(lnx, 1, maxn, MPI_DOUBLE, &row_type);
+  MPI_Type_vector(lnx, 1, lny + 2, MPI_DOUBLE, &row_type);
   MPI_Type_commit(&row_type);
 
+  // The 9-point stencil also reads the corner ghost cells; these are forwarded
+  // by exchanging rows that include the ghost columns
+  MPI_Datatype full_row_type;
+  MPI_Type_vector(lnx + 2, 1, lny + 2, MPI_DOUBLE, &full_row_type);
+  MPI_Type_commit(&full_row_type);
+
+  // The RMA exchanges read the neighbors' interior straight out of their
+  // arrays, so they need to know how large those arrays are
+  int          nbrs[4] = {nbrleft, nbrright, nbrdown, nbrup};
+  int          nbr_lsize[4] = {lnx, lnx, lny, lny};
+  MPI_Datatype recv_types[4], get_types[4];
+  MPI_Win      win_a = MPI_WIN_NULL, win_b = MPI_WIN_NULL;
+  MPI_Group    cart_group;
+  if (exch == EXCH_FENCE || exch == EXCH_PSCW) {
+    MPI_Sendrecv(&lnx, 1, MPI_INT, nbrright, 0, &nbr_lsize[0], 1, MPI_INT,
+                 nbrleft, 0, cart_comm, MPI_STATUS_IGNORE);
+    MPI_Sendrecv(&lnx, 1, MPI_INT, nbrleft, 1, &nbr_lsize[1], 1, MPI_INT,
+                 nbrright, 1, cart_comm, MPI_STATUS_IGNORE);
+    MPI_Sendrecv(&lny, 1, MPI_INT, nbrup, 2, &nbr_lsize[2], 1, MPI_INT,
+                 nbrdown, 2, cart_comm, MPI_STATUS_IGNORE);
+    MPI_Sendrecv(&lny, 1, MPI_INT, nbrdown, 3, &nbr_lsize[3], 1, MPI_INT,
+                 nbrup, 3, cart_comm, MPI_STATUS_IGNORE);
+    create_rma_types2d(lnx, lny, nbr_lsize, recv_types, get_types);
+    MPI_Comm_group(cart_comm, &cart_group);
+    MPI_Win_create(a, sizeof(double[lnx + 2][lny + 2]), sizeof(double),
+                   MPI_INFO_NULL, cart_comm, &win_a);
+    MPI_Win_create(b, sizeof(double[lnx + 2][lny + 2]), sizeof(double),
+                   MPI_INFO_NULL, cart_comm, &win_b);
+  }
+
+  // The right-hand side correction of the 9-point stencil reads f in the ghost
+  // cells, so these are filled once before iterating
+  if (stencil == 9) {
+    exchang2d_1(lnx, lny, f, cart_comm, nbrleft, nbrright, nbrup, nbrdown,
+                row_type);
+  }
+
+  // Suffix used by all output files; ny is only spelled out for rectangular
+  // grids so that square runs keep their original file names
+  char size_suffix[64];
+  if (ny == nx) {
+    sprintf(size_suffix, "nx%d", nx);
+  } else {
+    sprintf(size_suffix, "nx%dny%d", nx, ny);
+  }
+
+  // Resume from a checkpoint, which may have been written with a different
+  // number of processes
+  int it_start = 0;
+  glob_diff    = 1000;
+  if (restart_file[0] != '\0') {
+    if (checkpoint_read(restart_file, nx, ny, lnx, lny, a, row_s, col_s,
+                        &it_start, &glob_diff, cart_comm) != 0) {
+      MPI_Abort(cart_comm, 1);
+    }
+    if (cart_rank == 0) {
+      printf("\nRestarting from %s after %d iterations (global difference = "
+             "%.6e)\n",
+             restart_file, it_start, glob_diff);
+    }
+  }
+
+  // Checkpoints are written under the same name whatever the number of
+  // processes, so that any run can pick them up
+  checkpoint ck;
+  char       checkpoint_filename[256];
+  int        ck_failed = 0; // Whether writing a checkpoint failed
+  sprintf(checkpoint_filename, "checkpoint2d%s", size_suffix);
+  if (checkpoint_every > 0) {
+    checkpoint_init(&ck, checkpoint_filename, nx, ny, lnx, lny, row_s, col_s);
+  }
+
+  // Snapshots go to one file per iteration, e.g., snapshot2dnx31it500.bin
+  snapshot snap;
+  char     snapshot_filename[256];
+  int      snap_failed = 0; // Whether writing a compressed snapshot failed
+  if (snapshot_every > 0) {
+    snapshot_init(&snap, nx, ny, lnx, lny, row_s, col_s,
+                  provided == MPI_THREAD_MULTIPLE, cart_comm);
+  }
+
+  // Hardware counters are read in the timed phases from here on
+  if (perf_counters) {
+    perf_init(cart_comm);
+  }
+  if (trace_events > 0) {
+    trace_init(trace_events, trace_every, cart_comm);
+  }
+  timer_wait_split = wait_time;
+
+  // A batch of right-hand sides is solved on arrays of its own and writes no
+  // grid files, so only the reports are left to do afterwards
+  if (batch > 0) {
+    solve_batch2d(nx, ny, batch, row_s, row_e, col_s, col_e, nbrleft,
+                  nbrright, nbrup, nbrdown, niter, tol, cart_comm);
+    sprintf(size_suffix + strlen(size_suffix), "batch%d", batch);
+    report_phases(cart_comm, size_suffix, perf_counters, trace_events);
+    if (cart_rank == 0) {
+      printf("\n=======================================================\n");
+      printf("                        SUCCESS                        \n");
+      printf("=======================================================\n\n");
+    }
+    MPI_Type_free(&row_type);
+    MPI_Type_free(&full_row_type);
+    free(a);
+    free(b);
+    free(f);
+    free(weights);
+    free(row_w);
+    free(col_w);
+    MPI_Comm_free(&cart_comm);
+    MPI_Finalize();
+    return 0;
+  }
+
   // Start timing
   if (cart_rank == 0) {
     printf("\nStarting iterative solver\n");
   }
   t1 = MPI_Wtime();
 
+  // The initial guess comes from a coarser solve, whose time is part of the
+  // solver's
+  if (warm_start > 0) {
+    warm_start2d(warm_start, nx, ny, lnx, lny, a, row_s, row_e, col_s, col_e,
+                 nbrleft, nbrright, nbrup, nbrdown, niter, tol, cart_comm);
+  }
+
   // Main iteration loop
-  glob_diff = 1000;
-  for (it = 0; it < maxit; it++) {
-    exchang2d_1(a, nx, row_s, row_e, col_s, col_e, cart_comm, nbrleft, nbrright,
-                nbrup, nbrdown,
-                row_type); // Exchange ghost cells using blocking MPI_Sendrecv
-    sweep2d(a, f, nx, row_s, row_e, col_s, col_e, b);
-    exchang2d_nb(b, nx, row_s, row_e, col_s, col_e, cart_comm, nbrleft,
-                 nbrright, nbrup, nbrdown,
-                 row_type); // Exchange ghost cells again, this time using
-                            // non-blocking MPI_Isend and MPI_Irecv
-    sweep2d(b, f, nx, row_s, row_e, col_s, col_e, a);
+  double h = 1.0 / ((double) (nx + 1)); // Grid spacing
+  for (it = it_start; it < niter; it++) {
+    if (trace_events > 0) {
+      trace_iteration(it);
+    }
+    if (stencil == 9) {
+      TIMER_WAIT(cart_comm);
+      TIMER_START(PHASE_EXCHANGE);
+      exchang2d_corner(lnx, lny, a, cart_comm, nbrleft, nbrright, nbrup,
+                       nbrdown, full_row_type);
+      TIMER_STOP(PHASE_EXCHANGE);
+      TIMER_START(PHASE_SWEEP);
+      sweep2d_9pt(lnx, lny, a, f, h, b);
+      TIMER_STOP(PHASE_SWEEP);
+      TIMER_WAIT(cart_comm);
+      TIMER_START(PHASE_EXCHANGE);
+      exchang2d_corner(lnx, lny, b, cart_comm, nbrleft, nbrright, nbrup,
+                       nbrdown, full_row_type);
+      TIMER_STOP(PHASE_EXCHANGE);
+      TIMER_START(PHASE_SWEEP);
+      sweep2d_9pt(lnx, lny, b, f, h, a);
+      TIMER_STOP(PHASE_SWEEP);
+    } else {
+      for (int half = 0; half < 2; half++) {
+        double(*x)[lny + 2] = half ? b : a; // Grid to exchange
+        double(*y)[lny + 2] = half ? a : b; // Grid to update
+        TIMER_WAIT(cart_comm);
+        TIMER_START(PHASE_EXCHANGE);
+        switch (exch) {
+          case EXCH_ALTERNATE:
+            if (half == 0) {
+              exchang2d_1(lnx, lny, x, cart_comm, nbrleft, nbrright, nbrup,
+                          nbrdown, row_type); // Exchange ghost cells using
+                                              // blocking MPI_Sendrecv
+            } else {
+              exchang2d_nb(lnx, lny, x, cart_comm, nbrleft, nbrright, nbrup,
+                           nbrdown, row_type); // Exchange ghost cells again,
+                                               // this time using non-blocking
+                                               // MPI_Isend and MPI_Irecv
+            }
+            break;
+          case EXCH_BLOCKING:
+            exchang2d_1(lnx, lny, x, cart_comm, nbrleft, nbrright, nbrup,
+                        nbrdown, row_type);
+            break;
+          case EXCH_NB:
+            exchang2d_nb(lnx, lny, x, cart_comm, nbrleft, nbrright, nbrup,
+                         nbrdown, row_type);
+            break;
+          case EXCH_FENCE:
+            exchang2d_rma_fence(&x[0][0], nbrs, recv_types, get_types,
+                                half ? win_b : win_a);
+            break;
+          case EXCH_PSCW:
+            exchang2d_rma_pscw(&x[0][0], nbrs, recv_types, get_types,
+                               half ? win_b : win_a, cart_group);
+            break;
+        }
+        TIMER_STOP(PHASE_EXCHANGE);
+        TIMER_START(PHASE_SWEEP);
+        sweep2d(lnx, lny, x, f, h, y);
+        TIMER_STOP(PHASE_SWEEP);
+      }
+    }
 
     // Check for convergence
-    ldiff = griddiff2d(a, b, nx, row_s, row_e, col_s, col_e);
+    TIMER_START(PHASE_RESIDUAL);
+    ldiff = griddiff2d(lnx, lny, a, b);
+    TIMER_STOP(PHASE_RESIDUAL);
+    TIMER_WAIT(cart_comm);
+    TIMER_START(PHASE_ALLREDUCE);
     MPI_Allreduce(&ldiff, &glob_diff, 1, MPI_DOUBLE, MPI_SUM, cart_comm);
+    TIMER_STOP(PHASE_ALLREDUCE);
 
     // Print progress every 100 iterations
     if (cart_rank == 0 && (it % 100 == 0 || glob_diff < tol)) {
@@ -212,122 +840,272 @@ int main(int argc, char** argv) {
       }
       break;
     }
+
+    // Save the state in the background while iterating
+    if (checkpoint_every > 0 && (it + 1) % checkpoint_every == 0) {
+      TIMER_START(PHASE_CHECKPOINT);
+      ck_failed |= checkpoint_start(&ck, lnx, lny, a, h, it + 1, glob_diff,
+                                    cart_comm) != MPI_SUCCESS;
+      TIMER_STOP(PHASE_CHECKPOINT);
+    }
+    if (snapshot_every > 0 && (it + 1) % snapshot_every == 0) {
+      sprintf(snapshot_filename, "snapshot2d%sit%d", size_suffix, it + 1);
+      TIMER_START(PHASE_CHECKPOINT);
+      if (compress_tol > 0.0) {
+
+        // Compressed blocks vary in size, so their offsets in the file are
+        // agreed on collectively and the snapshot is written straight away
+        grid_header snap_hdr;
+        grid_header_init(&snap_hdr, nx, ny, 1, 1, h, it + 1, glob_diff);
+        snap_failed |= write_grid_compressed(snapshot_filename, lnx, lny, a,
+                                             row_s, col_s, &snap_hdr,
+                                             compress_tol, cart_comm,
+                                             NULL) != MPI_SUCCESS;
+      } else {
+        snapshot_start(&snap, snapshot_filename, lnx, lny, a, h, it + 1,
+                       glob_diff);
+      }
+      TIMER_STOP(PHASE_CHECKPOINT);
+    }
+  }
+  if (checkpoint_every > 0) {
+    ck_failed |= checkpoint_finish(&ck, cart_comm) != MPI_SUCCESS;
+  }
+  if (snapshot_every > 0) {
+    snap_failed |= snapshot_finish(&snap) != 0;
   }
 
   // Stop timing and report performance
   t2 = MPI_Wtime();
+  if (trace_events > 0) {
+    trace_iteration(-1);
+  }
   if (cart_rank == 0) {
-    if (it == maxit) {
+    if (it == niter) {
       printf("Maximum iterations reached without convergence\n");
     }
-    printf("Solver completed in %.6f seconds\n\n", t2 - t1);
+    int done = ((it < niter) ? it + 1 : niter) - it_start; // In this run
+    printf("Solver completed in %.6f seconds\n", t2 - t1);
+    printf("Time per iteration: %.6e seconds\n\n",
+           (done > 0) ? (t2 - t1) / done : 0.0);
   }
+  if (checkpoint_every > 0) {
 
-  // Calculate the analytical solution for comparison
-  double g[maxn][maxn]; // Array to store analytical solution values
-  double h = 1.0 / ((double) (nx + 1)); // Grid spacing
-  double x, y; // These are our x- and y-coordinates, respectively
-  for (int i = 0; i <= nx + 1; i++) {
-    for (int j = 0; j <= ny + 1; j++) {
-      x = i * h; // Convert grid index to a physical x-coordinate
-      y = j * h; // Convert grid index to a physical y-coordinate
-      if (y == 0.0 || ((1.0 + x) * (1.0 + x) + y * y) == 0.0) {
-        g[i][j] = 0.0;
-      } else { // Analytical solution where u(x,y)=y/((1+x)^2+y^2)
-        g[i][j] = y / ((1.0 + x) * (1.0 + x) + y * y);
-      }
+    // A checkpoint may fail to start on some processes only
+    int ck_any;
+    MPI_Allreduce(&ck_failed, &ck_any, 1, MPI_INT, MPI_LOR, cart_comm);
+    ck_failed = ck_any;
+    double ck_time;
+    MPI_Reduce(&ck.time, &ck_time, 1, MPI_DOUBLE, MPI_MAX, 0, cart_comm);
+    if (cart_rank == 0 && ck_failed) {
+      fprintf(stderr, "Writing the checkpoints to %s.bin failed\n",
+              checkpoint_filename);
+    } else if (cart_rank == 0) {
+      printf("Checkpointing to %s.bin took %.6f seconds (%.2f%% of the "
+             "solve)\n\n",
+             checkpoint_filename, ck_time, 100.0 * ck_time / (t2 - t1));
+    }
+    checkpoint_free(&ck);
+  }
+  if (snapshot_every > 0) {
+
+    // The helper threads only report their own failures, so the run as a
+    // whole fails if any process could not write its part of a snapshot
+    int nfailed;
+    MPI_Allreduce(&snap_failed, &nfailed, 1, MPI_INT, MPI_SUM, cart_comm);
+    snap_failed = (nfailed > 0);
+    if (cart_rank == 0 && snap_failed) {
+      fprintf(stderr, "Writing the snapshots failed on %d processes\n",
+              nfailed);
     }
+    double snap_time[2] = {snap.time, snap.copy_time}, max_time[2];
+    MPI_Reduce(snap_time, max_time, 2, MPI_DOUBLE, MPI_MAX, 0, cart_comm);
+    if (cart_rank == 0 && snap.count > 0) {
+      printf("Writing %d snapshots cost the solver %.3e seconds each, of which "
+             "copying took %.3e seconds\n\n",
+             snap.count, max_time[0] / snap.count, max_time[1] / snap.count);
+    }
+    snapshot_free(&snap);
+  }
+
+  // Compare the kernels with the attainable memory bandwidth; b is no longer
+  // needed, so the sweeps may overwrite it
+  if (roofline) {
+    roofline_report(lnx, lny, a, b, f, h, stencil, cart_comm);
   }
 
+  // Headers of the binary files record where the block lies and how far the
+  // solver got
+  int         iters = (it < niter) ? it + 1 : niter;
+  grid_header local_hdr, global_hdr;
+  grid_header_init(&local_hdr, lnx, lny, col_s, row_s, h, iters, glob_diff);
+  grid_header_init(&global_hdr, nx, ny, 1, 1, h, iters, glob_diff);
+
   // Write local grid to a file
-  char local_filename[256];
-  sprintf(local_filename, "local2dnprocs%dproc%dnx%d", nprocs, cart_rank, nx);
-  write_grid(local_filename, a, nx, ny, cart_rank, row_s, row_e, col_s, col_e,
-             0);
+  if (output != 2) {
+    char local_filename[256];
+    sprintf(local_filename, "local2dnprocs%dproc%d%s", nprocs, cart_rank,
+            size_suffix);
+    TIMER_START(PHASE_WRITE);
+    if (text) {
+      write_grid(local_filename, lnx, lny, a, cart_rank, 0);
+    } else {
+      write_grid_bin(local_filename, lnx, lny, a, &local_hdr);
+    }
+    TIMER_STOP(PHASE_WRITE);
 
-  MPI_Barrier(
-      cart_comm); // Barrier to ensure all processes have written their files
+    MPI_Barrier(
+        cart_comm); // Barrier to ensure all processes have written their files
 
-  // Have only the root process report the file writing
-  if (cart_rank == 0) {
-    printf("All processes have written their local grids to files\n");
+    // Have only the root process report the file writing
+    if (cart_rank == 0) {
+      printf("All processes have written their local grids to files\n");
+    }
   }
 
-  // Allocate memory for domain decomposition information
-  int* row_s_vals = NULL;
-  int* row_e_vals = NULL;
-  int* col_s_vals = NULL;
-  int* col_e_vals = NULL;
+  // Write the global solution collectively; there is then no global grid on
+  // the root process
+  if (output == 1) {
+    char global_filename[256];
+    sprintf(global_filename, "global2dnprocs%d%s", nprocs, size_suffix);
+    if (cart_rank == 0) {
+      printf("\nWriting final solution to %s.%s with MPI-IO\n",
+             global_filename, (compress_tol > 0.0) ? "zgrid" : "bin");
+    }
+    double    tw = MPI_Wtime();
+    long long nbytes;
+    TIMER_START(PHASE_WRITE);
+    if (compress_tol > 0.0) {
+      write_grid_compressed(global_filename, lnx, lny, a, row_s, col_s,
+                            &global_hdr, compress_tol, cart_comm, &nbytes);
+    } else {
+      write_grid_mpiio(global_filename, nx, ny, lnx, lny, a, row_s, col_s,
+                       &global_hdr, cart_comm);
+    }
+    TIMER_STOP(PHASE_WRITE);
+    tw = MPI_Wtime() - tw;
+    if (cart_rank == 0) {
+      printf("Collective write completed in %.6f seconds\n", tw);
+      if (compress_tol > 0.0) {
+        printf("Compressed to %lld bytes within %.3e, %.1f times smaller "
+               "than in full precision\n",
+               nbytes, compress_tol,
+               (double) nx * ny * sizeof(double) / (double) nbytes);
+      }
+    }
+  }
 
-  if (cart_rank == 0) {
-    row_s_vals = (int*) malloc(nprocs * sizeof(int));
-    row_e_vals = (int*) malloc(nprocs * sizeof(int));
-    col_s_vals = (int*) malloc(nprocs * sizeof(int));
-    col_e_vals = (int*) malloc(nprocs * sizeof(int));
-    if (!row_s_vals || !row_e_vals || !col_s_vals || !col_e_vals) {
+  // Global solution after gathering from all processes using GatherGrid2D, and
+  // the analytical solution written alongside it; these only live on the root
+  double(*global_grid)[ny + 2] = NULL;
+  double(*g)[ny + 2]           = NULL;
+
+  if (cart_rank == 0 && output == 0) {
+    global_grid = malloc(sizeof(double[nx + 2][ny + 2]));
+    g           = malloc(sizeof(double[nx + 2][ny + 2]));
+    if (!global_grid || !g) {
       fprintf(stderr, "Memory allocation error\n");
       MPI_Abort(cart_comm, 1);
     }
     printf("\nGathering solution from all processes\n");
   }
 
-  // Gather domain decomposition information to the root process
-  MPI_Gather(&row_s, 1, MPI_INT, row_s_vals, 1, MPI_INT, 0, cart_comm);
-  MPI_Gather(&row_e, 1, MPI_INT, row_e_vals, 1, MPI_INT, 0, cart_comm);
-  MPI_Gather(&col_s, 1, MPI_INT, col_s_vals, 1, MPI_INT, 0, cart_comm);
-  MPI_Gather(&col_e, 1, MPI_INT, col_e_vals, 1, MPI_INT, 0, cart_comm);
-
   // Use GatherGrid2D to collect the solution from all the processes
-  GatherGrid2D(global_grid, a, row_s, row_e, col_s, col_e, nx, ny, cart_rank,
-               nprocs, row_s_vals, row_e_vals, col_s_vals, col_e_vals,
-               cart_comm);
+  if (output == 0) {
+    double tg = MPI_Wtime();
+    TIMER_START(PHASE_GATHER);
+    GatherGrid2D(nx, ny, global_grid, lnx, lny, a, cart_rank, nprocs, dims,
+                 row_w, col_w, cart_comm);
+    TIMER_STOP(PHASE_GATHER);
+    tg = MPI_Wtime() - tg;
+    if (cart_rank == 0) {
+      printf("Gathering took %.6f seconds\n", tg);
+    }
+  }
 
   // Write the global grid and analytical solution to files
-  if (cart_rank == 0) {
+  if (cart_rank == 0 && output == 0) {
+
+    // Calculate the analytical solution where u(x,y)=y/((1+x)^2+y^2)
+    for (int i = 0; i <= nx + 1; i++) {
+      for (int j = 0; j <= ny + 1; j++) {
+        g[i][j] = analytical2d(i * h, j * h); // Convert grid indices to
+                                              // physical coordinates
+      }
+    }
+
     char global_filename[256];
     char analytical[256];
-    sprintf(global_filename, "global2dnprocs%dnx%d", nprocs, nx);
-    sprintf(analytical, "analyticalnprocs%dnx%d", nprocs, nx);
+    sprintf(global_filename, "global2dnprocs%d%s", nprocs, size_suffix);
+    sprintf(analytical, "analyticalnprocs%d%s", nprocs, size_suffix);
     printf("\nWriting final solution to files\n");
-    write_grid(global_filename, global_grid, nx, ny, cart_rank, 1, nx, 1, nx,
-               0); // Write numerical solution
-    write_grid(analytical, g, nx, ny, cart_rank, 1, nx, 1, nx,
-               0); // Write analytical solution
-
-    // Calculate error statistics
-    double max_error = 0.0;
-    double avg_error = 0.0;
-    int    count     = 0;
-    for (int i = 1; i <= nx; i++) {
-      for (int j = 1; j <= ny; j++) {
-        double error = fabs(global_grid[i][j] - g[i][j]);
-        avg_error += error;
-        count++;
-        if (error > max_error) {
-          max_error = error;
-        }
-      }
+    TIMER_START(PHASE_WRITE);
+    if (text) {
+      write_grid(global_filename, nx, ny, global_grid, cart_rank,
+                 0); // Write numerical solution
+      write_grid(analytical, nx, ny, g, cart_rank,
+                 0); // Write analytical solution
+    } else {
+      write_grid_bin(global_filename, nx, ny, global_grid, &global_hdr);
+      grid_header analytical_hdr;
+      grid_header_init(&analytical_hdr, nx, ny, 1, 1, h, 0, 0.0);
+      write_grid_bin(analytical, nx, ny, g, &analytical_hdr);
     }
-    avg_error /= count;
+    TIMER_STOP(PHASE_WRITE);
+  }
 
-    // Print error statistics
+  // Every process compares its block with the analytical solution, so that
+  // the error needs neither the gathered grid nor any output; the average
+  // error is the discrete L1 norm and the RMS error the discrete L2 norm
+  double lerr[3] = {0.0, 0.0, 0.0}; // Maximum, sum and sum of squares
+  for (int i = 1; i <= lnx; i++) {
+    for (int j = 1; j <= lny; j++) {
+      double error = fabs(a[i][j] - analytical2d((col_s - 1 + i) * h,
+                                                 (row_s - 1 + j) * h));
+      lerr[1] += error;
+      lerr[2] += error * error;
+      if (error > lerr[0]) {
+        lerr[0] = error;
+      }
+    }
+  }
+  double max_error, sum_error[2];
+  MPI_Allreduce(&lerr[0], &max_error, 1, MPI_DOUBLE, MPI_MAX, cart_comm);
+  MPI_Allreduce(&lerr[1], sum_error, 2, MPI_DOUBLE, MPI_SUM, cart_comm);
+  if (cart_rank == 0) {
     printf("\nError analysis\n");
     printf("Maximum error: %.8e\n", max_error);
-    printf("Average error: %.8e\n", avg_error);
+    printf("Average error: %.8e\n", sum_error[0] / ((double) nx * ny));
+    printf("RMS error:     %.8e\n", sqrt(sum_error[1] / ((double) nx * ny)));
   }
 
+  // Report the time spent in each phase of the solver
+  report_phases(cart_comm, size_suffix, perf_counters, trace_events);
+
   // Clean up and finalise
   MPI_Type_free(&row_type);
+  MPI_Type_free(&full_row_type);
+  if (exch == EXCH_FENCE || exch == EXCH_PSCW) {
+    MPI_Win_free(&win_a);
+    MPI_Win_free(&win_b);
+    MPI_Group_free(&cart_group);
+    free_rma_types2d(recv_types, get_types);
+  }
   if (cart_rank == 0) {
-    free(row_s_vals);
-    free(row_e_vals);
-    free(col_s_vals);
-    free(col_e_vals);
+    free(global_grid);
+    free(g);
     printf("\n=======================================================\n");
-    printf("                        SUCCESS                        \n");
+    printf("                        %s                        \n",
+           (snap_failed || ck_failed) ? "FAILURE" : "SUCCESS");
     printf("=======================================================\n\n");
   }
+  free(a);
+  free(b);
+  free(f);
+  free(weights);
+  free(row_w);
+  free(col_w);
   MPI_Comm_free(&cart_comm);
   MPI_Finalize();
-  return 0;
+  return snap_failed || ck_failed;
 }
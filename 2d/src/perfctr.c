@@ -0,0 +1,339 @@
+/**
+ * @file  perfctr.c
+ * @brief Implementation of the hardware performance counters.
+ */
+
+#include <errno.h>
+#include <mpi.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/perfctr.h"
+#include "../include/timers.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#define PERF_NEVENTS 5
+
+// Events counted, in the order of the report
+enum { EV_CYCLES, EV_INSTRUCTIONS, EV_LLC_REFS, EV_LLC_MISSES, EV_BR_MISSES };
+
+static const char* event_names[PERF_NEVENTS] = {
+    "cycles", "instructions", "llc_refs", "llc_misses", "branch_misses"};
+
+int perf_enabled = 0;
+
+// Event group of the calling thread; slot[e] is the position of event e in a
+// read of the group, or -1 if it is not counted
+static int group_fd = -1;
+static int fds[PERF_NEVENTS];
+static int nopen = 0;
+static int slot[PERF_NEVENTS];
+
+// Counts and group times at the start of each phase, and the counts
+// accumulated over all calls of each phase
+static uint64_t start_count[NPHASES][PERF_NEVENTS];
+static uint64_t start_enabled[NPHASES];
+static uint64_t start_running[NPHASES];
+static double   total[NPHASES][PERF_NEVENTS];
+
+#ifdef __linux__
+
+/**
+ * @brief Reads all counters of the group.
+ *
+ * @param[out] count   Count of every event in the group.
+ * @param[out] enabled Time the group has been enabled.
+ * @param[out] running Time the group has actually been counting.
+ *
+ * @returns 0 on success, non-zero on error.
+ */
+static int read_group(uint64_t* count, uint64_t* enabled, uint64_t* running) {
+  uint64_t buf[3 + PERF_NEVENTS];
+  ssize_t  len = (ssize_t) ((3 + nopen) * sizeof(uint64_t));
+  if (read(group_fd, buf, len) != len) {
+    return 1;
+  }
+  *enabled = buf[1];
+  *running = buf[2];
+  for (int k = 0; k < nopen; k++) {
+    count[k] = buf[3 + k];
+  }
+  return 0;
+}
+
+#endif
+
+/**
+ * @brief Opens the hardware counters of the calling thread.
+ *
+ * Events the processor does not support are left out of the group rather
+ * than disabling the others. The root process reports which events are
+ * counted and on how many processes.
+ *
+ * @param[in] comm MPI communicator.
+ *
+ * @returns Number of events being counted on this process, 0 if none.
+ */
+int perf_init(MPI_Comm comm) {
+  int rank, nprocs;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &nprocs);
+
+  for (int e = 0; e < PERF_NEVENTS; e++) {
+    slot[e] = -1;
+  }
+
+#if defined(__linux__) && defined(POISSON_TIMERS)
+  int            err = 0; // errno of the first event that could not be opened
+  const uint64_t config[PERF_NEVENTS] = {
+      PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_CACHE_REFERENCES, PERF_COUNT_HW_CACHE_MISSES,
+      PERF_COUNT_HW_BRANCH_MISSES};
+
+  // The first event that opens leads the group, so that all counters are
+  // read with one system call and are scheduled onto the PMU together; only
+  // user space is counted, which unprivileged processes may do with the
+  // default perf_event_paranoid setting
+  for (int e = 0; e < PERF_NEVENTS; e++) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size           = sizeof(attr);
+    attr.type           = PERF_TYPE_HARDWARE;
+    attr.config         = config[e];
+    attr.disabled       = (group_fd < 0);
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    attr.read_format    = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+    int fd = (int) syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0);
+    if (fd < 0) {
+      if (!err) {
+        err = errno;
+      }
+      continue;
+    }
+    if (group_fd < 0) {
+      group_fd = fd;
+    }
+    fds[nopen] = fd;
+    slot[e]    = nopen++;
+  }
+  if (group_fd >= 0) {
+    ioctl(group_fd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(group_fd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    perf_enabled = 1;
+  }
+#endif
+
+  // Report how many processes count each event
+  int opened[PERF_NEVENTS], nopened[PERF_NEVENTS];
+  for (int e = 0; e < PERF_NEVENTS; e++) {
+    opened[e] = slot[e] >= 0;
+  }
+  MPI_Reduce(opened, nopened, PERF_NEVENTS, MPI_INT, MPI_SUM, 0, comm);
+  if (rank == 0) {
+#ifndef POISSON_TIMERS
+    printf("Hardware counters are read with the phase timers, which this "
+           "build leaves out (TIMERS=0)\n");
+#elif !defined(__linux__)
+    printf("Hardware counters need perf_event_open, which is only available "
+           "on Linux\n");
+#else
+    int total_opened = 0;
+    for (int e = 0; e < PERF_NEVENTS; e++) {
+      total_opened += nopened[e];
+    }
+    if (total_opened == 0) {
+      printf("Hardware counters are not available (%s); see "
+             "/proc/sys/kernel/perf_event_paranoid\n",
+             strerror(err));
+    } else {
+      printf("Hardware counters:");
+      for (int e = 0; e < PERF_NEVENTS; e++) {
+        printf(" %s (%d/%d)", event_names[e], nopened[e], nprocs);
+      }
+      printf("\n");
+    }
+    if (err && total_opened > 0) {
+      printf("Some counters could not be opened: %s; see "
+             "/proc/sys/kernel/perf_event_paranoid\n",
+             strerror(err));
+    }
+#endif
+  }
+  return nopen;
+}
+
+/**
+ * @brief Reads the counters at the start of a phase.
+ *
+ * @param[in] phase Phase being started, as in timers.h.
+ */
+void perf_phase_start(int phase) {
+#ifdef __linux__
+  uint64_t count[PERF_NEVENTS];
+  if (read_group(count, &start_enabled[phase], &start_running[phase]) == 0) {
+    for (int k = 0; k < nopen; k++) {
+      start_count[phase][k] = count[k];
+    }
+  }
+#else
+  (void) phase;
+#endif
+}
+
+/**
+ * @brief Reads the counters at the end of a phase and accumulates the counts
+ *        since perf_phase_start.
+ *
+ * @param[in] phase Phase being stopped, as in timers.h.
+ */
+void perf_phase_stop(int phase) {
+#ifdef __linux__
+  uint64_t count[PERF_NEVENTS] = {0}, enabled, running;
+  if (read_group(count, &enabled, &running) != 0) {
+    return;
+  }
+
+  // Scale up if the group had to share the PMU with other events
+  double scale = 1.0;
+  if (running > start_running[phase] &&
+      running - start_running[phase] < enabled - start_enabled[phase]) {
+    scale = (double) (enabled - start_enabled[phase]) /
+            (double) (running - start_running[phase]);
+  }
+  for (int e = 0; e < PERF_NEVENTS; e++) {
+    if (slot[e] >= 0) {
+      total[phase][e] +=
+          scale * (double) (count[slot[e]] - start_count[phase][slot[e]]);
+    }
+  }
+#else
+  (void) phase;
+#endif
+}
+
+/**
+ * @brief Reports the counts of every phase and closes the counters.
+ *
+ * The root process prints the average count per process for every phase,
+ * along with instructions per cycle and the last-level cache miss ratio, and
+ * writes the counts of every process to a CSV file.
+ *
+ * @param[in] comm     MPI communicator.
+ * @param[in] filename Name of the CSV file to write.
+ */
+void perf_report(MPI_Comm comm, const char* filename) {
+  int rank, nprocs;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &nprocs);
+
+#ifdef __linux__
+  if (group_fd >= 0) {
+    ioctl(group_fd, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    for (int k = nopen - 1; k >= 0; k--) {
+      close(fds[k]);
+    }
+    group_fd = -1;
+  }
+#endif
+  perf_enabled = 0;
+
+  // Nothing to report if no process could count anything
+  int counting = nopen > 0, any;
+  MPI_Allreduce(&counting, &any, 1, MPI_INT, MPI_MAX, comm);
+  if (!any) {
+    return;
+  }
+
+  // Counts of every process, and which events each of them counted
+  int n = NPHASES * PERF_NEVENTS;
+  double sum[NPHASES][PERF_NEVENTS];
+  int    opened[PERF_NEVENTS], nopened[PERF_NEVENTS];
+  for (int e = 0; e < PERF_NEVENTS; e++) {
+    opened[e] = slot[e] >= 0;
+  }
+  MPI_Reduce(total, sum, n, MPI_DOUBLE, MPI_SUM, 0, comm);
+  MPI_Reduce(opened, nopened, PERF_NEVENTS, MPI_INT, MPI_SUM, 0, comm);
+  double* all = NULL;
+  if (rank == 0) {
+    all = (double*) malloc((size_t) nprocs * n * sizeof(double));
+    if (!all) {
+      fprintf(stderr, "Memory allocation error\n");
+      MPI_Abort(comm, 1);
+    }
+  }
+  MPI_Gather(total, n, MPI_DOUBLE, all, n, MPI_DOUBLE, 0, comm);
+  if (rank != 0) {
+    return;
+  }
+
+  // Average per process over the processes that counted each event
+  printf("\nHardware counters per phase (average per process)\n");
+  printf("%-10s", "Phase");
+  for (int e = 0; e < PERF_NEVENTS; e++) {
+    printf(" %14s", event_names[e]);
+  }
+  printf(" %6s %9s\n", "IPC", "LLC miss");
+  for (int p = 0; p < NPHASES; p++) {
+    double avg[PERF_NEVENTS];
+    int    nonzero = 0;
+    for (int e = 0; e < PERF_NEVENTS; e++) {
+      avg[e] = nopened[e] ? sum[p][e] / nopened[e] : 0.0;
+      nonzero |= avg[e] > 0.0;
+    }
+    if (!nonzero) {
+      continue;
+    }
+    printf("%-10s", timer_phase_name(p));
+    for (int e = 0; e < PERF_NEVENTS; e++) {
+      if (nopened[e]) {
+        printf(" %14.4e", avg[e]);
+      } else {
+        printf(" %14s", "n/a");
+      }
+    }
+    if (avg[EV_CYCLES] > 0.0 && nopened[EV_INSTRUCTIONS]) {
+      printf(" %6.2f", avg[EV_INSTRUCTIONS] / avg[EV_CYCLES]);
+    } else {
+      printf(" %6s", "n/a");
+    }
+    if (avg[EV_LLC_REFS] > 0.0 && nopened[EV_LLC_MISSES]) {
+      printf(" %8.1f%%", 100.0 * avg[EV_LLC_MISSES] / avg[EV_LLC_REFS]);
+    } else {
+      printf(" %9s", "n/a");
+    }
+    printf("\n");
+  }
+
+  FILE* file = fopen(filename, "w");
+  if (!file) {
+    fprintf(stderr, "Error opening file %s for writing\n", filename);
+  } else {
+    fprintf(file, "rank,phase");
+    for (int e = 0; e < PERF_NEVENTS; e++) {
+      fprintf(file, ",%s", event_names[e]);
+    }
+    fprintf(file, "\n");
+    for (int r = 0; r < nprocs; r++) {
+      for (int p = 0; p < NPHASES; p++) {
+        fprintf(file, "%d,%s", r, timer_phase_name(p));
+        for (int e = 0; e < PERF_NEVENTS; e++) {
+          fprintf(file, ",%.0f", all[(size_t) r * n + p * PERF_NEVENTS + e]);
+        }
+        fprintf(file, "\n");
+      }
+    }
+    fclose(file);
+    printf("Counts of every process written to %s\n", filename);
+  }
+  free(all);
+}
@@ -0,0 +1,192 @@
+/**
+ * @file  roofline.c
+ * @brief Implementation of the bandwidth and FLOP rate reporting.
+ */
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../include/jacobi.h"
+#include "../include/roofline.h"
+
+// Elements per triad array shared out among the processes of a node; three
+// arrays of this many doubles take 384 MiB, several times any last-level
+// cache, so the triad runs from memory
+#define TRIAD_NODE_ELEMENTS (1 << 24)
+#define TRIAD_MIN_ELEMENTS (1 << 20)
+
+// Each kernel is called until it has touched about this many points, so that
+// the timings are well above the resolution of MPI_Wtime
+#define KERNEL_POINTS 5.0e7
+
+/**
+ * @brief Measures the memory bandwidth of the calling process with a
+ *        STREAM-style triad, a[k] = b[k] + s * c[k].
+ *
+ * @param[in] n    Length of each of the three arrays.
+ * @param[in] reps Number of timed triads; the fastest is used.
+ *
+ * @returns Bandwidth in bytes per second, counting 24 bytes per element.
+ */
+double stream_triad(size_t n, int reps) {
+  double* a = (double*) malloc(n * sizeof(double));
+  double* b = (double*) malloc(n * sizeof(double));
+  double* c = (double*) malloc(n * sizeof(double));
+  if (!a || !b || !c) {
+    fprintf(stderr, "Memory allocation error\n");
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+
+  // Touch every page before timing
+  for (size_t k = 0; k < n; k++) {
+    a[k] = 0.0;
+    b[k] = 1.0;
+    c[k] = 2.0;
+  }
+
+  double best = 0.0;
+  double s    = 3.0;
+  for (int r = 0; r < reps; r++) {
+    double t = MPI_Wtime();
+    for (size_t k = 0; k < n; k++) {
+      a[k] = b[k] + s * c[k];
+    }
+    t = MPI_Wtime() - t;
+
+    // Read the result so that the loop cannot be optimised away
+    if (a[r % n] != 7.0) {
+      fprintf(stderr, "Triad produced a wrong result\n");
+    }
+    if (t > 0.0 && (best == 0.0 || t < best)) {
+      best = t;
+    }
+  }
+
+  free(a);
+  free(b);
+  free(c);
+  return (best > 0.0) ? 3.0 * sizeof(double) * n / best : 0.0;
+}
+
+/**
+ * @brief Measures and reports the bandwidth and FLOP rate of the sweep and of
+ *        griddiff2d on the solver's own arrays.
+ *
+ * All processes run the triad and then each kernel at the same time, so that
+ * they compete for memory bandwidth as they do while solving. The root
+ * process prints the minimum, average and maximum over all processes of the
+ * GB/s and GFLOP/s per process, and of the percentage of the triad bandwidth
+ * of each process. b is overwritten.
+ *
+ * @param[in]     lnx     Number of local interior grid points in x-axis.
+ * @param[in]     lny     Number of local interior grid points in y-axis.
+ * @param[in]     a       Current iteration grid array.
+ * @param[in,out] b       Next iteration grid array, used as scratch.
+ * @param[in]     f       Right-hand side function values.
+ * @param[in]     h       Grid spacing.
+ * @param[in]     stencil 5 or 9, selecting sweep2d or sweep2d_9pt.
+ * @param[in]     comm    MPI communicator.
+ */
+void roofline_report(int lnx, int lny, double a[][lny + 2],
+                     double b[][lny + 2], double f[][lny + 2], double h,
+                     int stencil, MPI_Comm comm) {
+  int rank, nprocs;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &nprocs);
+
+  // Share the triad arrays out among the processes of the node
+  MPI_Comm node_comm;
+  int      node_size;
+  MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL,
+                      &node_comm);
+  MPI_Comm_size(node_comm, &node_size);
+  MPI_Comm_free(&node_comm);
+  size_t n = TRIAD_NODE_ELEMENTS / node_size;
+  if (n < TRIAD_MIN_ELEMENTS) {
+    n = TRIAD_MIN_ELEMENTS;
+  }
+  MPI_Barrier(comm);
+  double triad = stream_triad(n, 10);
+
+  // Flops and bytes per interior point of each kernel; the flops are counted
+  // next to the kernels in jacobi.h
+  const char* name[2]  = {(stencil == 9) ? "sweep2d_9pt" : "sweep2d",
+                          "griddiff2d"};
+  double      flops[2] = {(stencil == 9) ? SWEEP2D_9PT_FLOPS : SWEEP2D_FLOPS,
+                          GRIDDIFF2D_FLOPS};
+  double      bytes[2] = {3.0 * sizeof(double), 2.0 * sizeof(double)};
+
+  // Every process makes the same number of calls so that they run together
+  long points = (long) lnx * lny;
+  long max_points;
+  MPI_Allreduce(&points, &max_points, 1, MPI_LONG, MPI_MAX, comm);
+  int reps = (int) (KERNEL_POINTS / max_points);
+  if (reps < 10) {
+    reps = 10;
+  }
+
+  // Rates of this process; GB/s, GFLOP/s and percentage of the triad for
+  // each kernel
+  double rate[2][3];
+  double sink = 0.0;
+  for (int k = 0; k < 2; k++) {
+    if (k == 0 && stencil == 9) {
+      sweep2d_9pt(lnx, lny, a, f, h, b);
+    } else if (k == 0) {
+      sweep2d(lnx, lny, a, f, h, b);
+    } else {
+      sink += griddiff2d(lnx, lny, a, b);
+    }
+    MPI_Barrier(comm);
+    double t = MPI_Wtime();
+    for (int r = 0; r < reps; r++) {
+      if (k == 0 && stencil == 9) {
+        sweep2d_9pt(lnx, lny, a, f, h, b);
+      } else if (k == 0) {
+        sweep2d(lnx, lny, a, f, h, b);
+      } else {
+        sink += griddiff2d(lnx, lny, a, b);
+      }
+    }
+    t = MPI_Wtime() - t;
+    rate[k][0] = bytes[k] * points * reps / t / 1.0e9;
+    rate[k][1] = flops[k] * points * reps / t / 1.0e9;
+    rate[k][2] = (triad > 0.0) ? 100.0 * rate[k][0] * 1.0e9 / triad : 0.0;
+  }
+  if (sink < 0.0) { // Never true; keeps griddiff2d from being optimised away
+    printf("%g\n", sink);
+  }
+
+  double r_min[2][3], r_max[2][3], r_sum[2][3];
+  double t_min, t_max, t_sum;
+  MPI_Reduce(rate, r_min, 6, MPI_DOUBLE, MPI_MIN, 0, comm);
+  MPI_Reduce(rate, r_max, 6, MPI_DOUBLE, MPI_MAX, 0, comm);
+  MPI_Reduce(rate, r_sum, 6, MPI_DOUBLE, MPI_SUM, 0, comm);
+  MPI_Reduce(&triad, &t_min, 1, MPI_DOUBLE, MPI_MIN, 0, comm);
+  MPI_Reduce(&triad, &t_max, 1, MPI_DOUBLE, MPI_MAX, 0, comm);
+  MPI_Reduce(&triad, &t_sum, 1, MPI_DOUBLE, MPI_SUM, 0, comm);
+  if (rank != 0) {
+    return;
+  }
+
+  printf("\nRoofline of the solver kernels per process (min / avg / max over "
+         "%d processes)\n",
+         nprocs);
+  printf("Triad bandwidth: %.2f / %.2f / %.2f GB/s (%d processes per node, "
+         "%.2f GB/s in total)\n",
+         t_min / 1.0e9, t_sum / nprocs / 1.0e9, t_max / 1.0e9, node_size,
+         t_sum / 1.0e9);
+  printf("Working set of the kernels: %.1f MiB per process; above 100%% of "
+         "the triad, it is served from cache\n",
+         3.0 * sizeof(double) * max_points / 1048576.0);
+  printf("%-12s %6s %6s %24s %24s %24s\n", "Kernel", "B/pt", "F/pt",
+         "GB/s", "GFLOP/s", "% of triad");
+  for (int k = 0; k < 2; k++) {
+    printf("%-12s %6.0f %6.0f %7.2f / %6.2f / %6.2f %7.2f / %6.2f / %6.2f "
+           "%7.1f / %6.1f / %6.1f\n",
+           name[k], bytes[k], flops[k], r_min[k][0], r_sum[k][0] / nprocs,
+           r_max[k][0], r_min[k][1], r_sum[k][1] / nprocs, r_max[k][1],
+           r_min[k][2], r_sum[k][2] / nprocs, r_max[k][2]);
+  }
+}
@@ -0,0 +1,169 @@
+/**
+ * @file  snapshot.c
+ * @brief Implementation of snapshots written in the background.
+ */
+
+#include <mpi.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/gridfile.h"
+#include "../include/poisson2d.h"
+#include "../include/snapshot.h"
+
+/**
+ * @brief Writes the staged copy of a snapshot into its place in the file.
+ *
+ * This runs on the helper thread, whose collective MPI-IO calls on the
+ * communicator of the snapshots only meet those of the other helper threads.
+ * The root process writes the header and every process its block.
+ *
+ * @param[in,out] arg Snapshot state.
+ *
+ * @returns NULL.
+ */
+static void* snapshot_write(void* arg) {
+  snapshot* sn = (snapshot*) arg;
+  MPI_File  fh;
+
+  int err = MPI_File_open(sn->comm, sn->filename,
+                          MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL,
+                          &fh);
+  if (err == MPI_SUCCESS) {
+
+    // Every process takes part in every collective call, even after an error
+    err = MPI_File_set_size(fh, 0);
+    if (sn->rank == 0 && err == MPI_SUCCESS) {
+      err = MPI_File_write_at(fh, 0, &sn->hdr, sizeof(grid_header), MPI_BYTE,
+                              MPI_STATUS_IGNORE);
+    }
+    int verr = MPI_File_set_view(fh, sizeof(grid_header), MPI_DOUBLE,
+                                 sn->filetype, "native", MPI_INFO_NULL);
+    int werr = MPI_File_write_all(fh, sn->buf, sn->lnx * sn->lny, MPI_DOUBLE,
+                                  MPI_STATUS_IGNORE);
+    int cerr = MPI_File_close(&fh);
+    err      = (err == MPI_SUCCESS) ? verr : err;
+    err      = (err == MPI_SUCCESS) ? werr : err;
+    err      = (err == MPI_SUCCESS) ? cerr : err;
+  }
+  if (err != MPI_SUCCESS) {
+    fprintf(stderr, "Error writing file %s\n", sn->filename);
+  }
+  sn->err |= (err != MPI_SUCCESS);
+  return NULL;
+}
+
+/**
+ * @brief Prepares the snapshot state of a process.
+ *
+ * The snapshots are written on a duplicate of comm, so this is collective.
+ *
+ * @param[out] sn       Snapshot state.
+ * @param[in]  nx       Number of interior grid points in x-axis.
+ * @param[in]  ny       Number of interior grid points in y-axis.
+ * @param[in]  lnx      Number of local interior grid points in x-axis.
+ * @param[in]  lny      Number of local interior grid points in y-axis.
+ * @param[in]  row_s    Starting row index of local domain.
+ * @param[in]  col_s    Starting column index of local domain.
+ * @param[in]  threaded Whether a helper thread may be used, i.e., whether MPI
+ *                      provides MPI_THREAD_MULTIPLE; if not, the snapshots
+ *                      are written before snapshot_start returns.
+ * @param[in]  comm     MPI communicator.
+ */
+void snapshot_init(snapshot* sn, int nx, int ny, int lnx, int lny, int row_s,
+                   int col_s, int threaded, MPI_Comm comm) {
+  memset(sn, 0, sizeof(snapshot));
+  grid_header_init(&sn->hdr, nx, ny, 1, 1, 0.0, 0, 0.0);
+  sn->lnx      = lnx;
+  sn->lny      = lny;
+  sn->threaded = threaded;
+  MPI_Comm_dup(comm, &sn->comm);
+  MPI_Comm_rank(sn->comm, &sn->rank);
+
+  // Position of the local interior within the global interior in the file
+  int gsizes[2] = {nx, ny};
+  int lsizes[2] = {lnx, lny};
+  int starts[2] = {col_s - 1, row_s - 1};
+  MPI_Type_create_subarray(2, gsizes, lsizes, starts, MPI_ORDER_C, MPI_DOUBLE,
+                           &sn->filetype);
+  MPI_Type_commit(&sn->filetype);
+
+  sn->buf = (double*) malloc((size_t) lnx * lny * sizeof(double));
+  if (!sn->buf) {
+    fprintf(stderr, "Memory allocation error\n");
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+}
+
+/**
+ * @brief Starts writing a snapshot of the local grid.
+ *
+ * Waits for the previous snapshot of this process, if any, copies the
+ * interior of a and hands the copy to the helper thread. As the write is
+ * collective, every process must start the same snapshots in the same order.
+ *
+ * @param[in,out] sn       Snapshot state.
+ * @param[in]     filename Base name of the file; ".bin" is appended.
+ * @param[in]     lnx      Number of local interior grid points in x-axis.
+ * @param[in]     lny      Number of local interior grid points in y-axis.
+ * @param[in]     a        Local grid array to save.
+ * @param[in]     h        Grid spacing.
+ * @param[in]     it       Number of completed iterations.
+ * @param[in]     residual Global difference of the last iteration.
+ */
+void snapshot_start(snapshot* sn, const char* filename, int lnx, int lny,
+                    double a[][lny + 2], double h, int it, double residual) {
+  snapshot_finish(sn);
+  double t = MPI_Wtime();
+  snprintf(sn->filename, sizeof(sn->filename), "%s.bin", filename);
+  sn->hdr.h        = h;
+  sn->hdr.it       = it;
+  sn->hdr.residual = residual;
+
+  // Take a copy so that the solver may overwrite a straight away
+  for (int i = 1; i <= lnx; i++) {
+    memcpy(&sn->buf[(size_t) (i - 1) * lny], &a[i][1], lny * sizeof(double));
+  }
+  sn->copy_time += MPI_Wtime() - t;
+  sn->count++;
+
+  sn->active = 1;
+  if (!sn->threaded || pthread_create(&sn->thread, NULL, snapshot_write, sn)) {
+    snapshot_write(sn);
+    sn->active = 0;
+  }
+  sn->time += MPI_Wtime() - t;
+}
+
+/**
+ * @brief Waits for the snapshot being written, if any, to complete.
+ *
+ * @param[in,out] sn Snapshot state.
+ *
+ * @returns 0 on success, non-zero if writing any snapshot failed.
+ */
+int snapshot_finish(snapshot* sn) {
+  if (sn->active) {
+    double t = MPI_Wtime();
+    pthread_join(sn->thread, NULL);
+    sn->active = 0;
+    sn->time += MPI_Wtime() - t;
+  }
+  return sn->err;
+}
+
+/**
+ * @brief Releases the snapshot state; snapshot_finish must be called first.
+ *
+ * This frees the communicator of the snapshots, so it is collective.
+ *
+ * @param[in,out] sn Snapshot state.
+ */
+void snapshot_free(snapshot* sn) {
+  MPI_Type_free(&sn->filetype);
+  MPI_Comm_free(&sn->comm);
+  free(sn->buf);
+  sn->buf = NULL;
+}
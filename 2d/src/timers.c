@@ -0,0 +1,207 @@
+/**
+ * @file  timers.c
+ * @brief Implementation of the per-phase timers of the 2D solver.
+ */
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../include/timers.h"
+
+// Names of the phases as used in the table and the CSV file
+static const char* phase_names[NPHASES] = {
+    "exchange", "sweep",  "residual", "allreduce", "wait", "checkpoint",
+    "gather",   "write"};
+
+int timer_wait_split = 0;
+
+/**
+ * @brief Name of a phase as used in reports.
+ *
+ * @param[in] phase Phase to name.
+ *
+ * @returns Name of the phase.
+ */
+const char* timer_phase_name(int phase) {
+  return phase_names[phase];
+}
+
+#ifdef POISSON_TIMERS
+
+double timer_start[NPHASES];
+double timer_total[NPHASES];
+long   timer_calls[NPHASES];
+
+/**
+ * @brief Reports the time spent in each phase.
+ *
+ * The root process prints a table of the minimum, average and maximum time
+ * over all processes for every phase, along with max / avg as a measure of
+ * load imbalance, and writes the same to a CSV file.
+ *
+ * @param[in] comm     MPI communicator.
+ * @param[in] filename Name of the CSV file to write.
+ */
+void timers_report(MPI_Comm comm, const char* filename) {
+  int rank, nprocs;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &nprocs);
+
+  double t_min[NPHASES], t_max[NPHASES], t_sum[NPHASES];
+  long   calls[NPHASES];
+  MPI_Reduce(timer_total, t_min, NPHASES, MPI_DOUBLE, MPI_MIN, 0, comm);
+  MPI_Reduce(timer_total, t_max, NPHASES, MPI_DOUBLE, MPI_MAX, 0, comm);
+  MPI_Reduce(timer_total, t_sum, NPHASES, MPI_DOUBLE, MPI_SUM, 0, comm);
+  MPI_Reduce(timer_calls, calls, NPHASES, MPI_LONG, MPI_MAX, 0, comm);
+  if (rank != 0) {
+    return;
+  }
+
+  FILE* file = fopen(filename, "w");
+  if (!file) {
+    fprintf(stderr, "Error opening file %s for writing\n", filename);
+  } else {
+    fprintf(file, "phase,calls,min,avg,max,imbalance\n");
+  }
+  printf("\nTime per phase over %d processes (seconds)\n", nprocs);
+  printf("%-10s %8s %12s %12s %12s %9s\n", "Phase", "Calls", "Min", "Avg",
+         "Max", "Max/avg");
+  for (int p = 0; p < NPHASES; p++) {
+    if (calls[p] == 0) {
+      continue;
+    }
+    double avg       = t_sum[p] / nprocs;
+    double imbalance = (avg > 0.0) ? t_max[p] / avg : 1.0;
+    printf("%-10s %8ld %12.6f %12.6f %12.6f %9.3f\n", phase_names[p],
+           calls[p], t_min[p], avg, t_max[p], imbalance);
+    if (file) {
+      fprintf(file, "%s,%ld,%.9f,%.9f,%.9f,%.6f\n", phase_names[p], calls[p],
+              t_min[p], avg, t_max[p], imbalance);
+    }
+  }
+  if (file) {
+    fclose(file);
+    printf("Phase timings written to %s\n", filename);
+  }
+}
+
+// Number of the slowest processes named in the imbalance report
+#define NSLOWEST 3
+
+// Times of one process in the imbalance report
+typedef struct {
+  int    rank;
+  int    coords[2];
+  double compute; // Sweeps and residuals
+  double sync;    // Exchanges and reductions
+  double wait;    // Barriers before them, with --wait-time
+} rank_times;
+
+/**
+ * @brief Orders processes by decreasing compute time.
+ *
+ * @param[in] p First process.
+ * @param[in] q Second process.
+ *
+ * @returns Negative, zero or positive as p comes before, with or after q.
+ */
+static int compare_compute(const void* p, const void* q) {
+  double a = ((const rank_times*) p)->compute;
+  double b = ((const rank_times*) q)->compute;
+  return (a < b) - (a > b);
+}
+
+/**
+ * @brief Reports the load imbalance between processes and the slowest of
+ *        them.
+ *
+ * The compute time of a process is the time of its sweeps and residuals. The
+ * root process prints max / avg of the compute time as the imbalance of the
+ * solve, and the slowest processes with their coordinates in comm, which
+ * must have a Cartesian topology, along with their time in synchronising
+ * calls and, with timer_wait_split set, in waiting. The same is written to a
+ * CSV file for every process.
+ *
+ * @param[in] comm     Cartesian MPI communicator.
+ * @param[in] filename Name of the CSV file to write.
+ */
+void imbalance_report(MPI_Comm comm, const char* filename) {
+  int rank, nprocs;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &nprocs);
+
+  rank_times mine;
+  mine.rank    = rank;
+  mine.compute = timer_total[PHASE_SWEEP] + timer_total[PHASE_RESIDUAL];
+  mine.sync    = timer_total[PHASE_EXCHANGE] + timer_total[PHASE_ALLREDUCE];
+  mine.wait    = timer_total[PHASE_WAIT];
+  MPI_Cart_coords(comm, rank, 2, mine.coords);
+
+  rank_times* all = NULL;
+  if (rank == 0) {
+    all = (rank_times*) malloc(nprocs * sizeof(rank_times));
+    if (!all) {
+      fprintf(stderr, "Memory allocation error\n");
+      MPI_Abort(comm, 1);
+    }
+  }
+  MPI_Gather(&mine, sizeof(rank_times), MPI_BYTE, all, sizeof(rank_times),
+             MPI_BYTE, 0, comm);
+  if (rank != 0) {
+    return;
+  }
+
+  double sum = 0.0, wait_sum = 0.0;
+  for (int r = 0; r < nprocs; r++) {
+    sum += all[r].compute;
+    wait_sum += all[r].wait;
+  }
+
+  FILE* file = fopen(filename, "w");
+  if (!file) {
+    fprintf(stderr, "Error opening file %s for writing\n", filename);
+  } else {
+    fprintf(file, "rank,coord0,coord1,compute,sync,wait\n");
+    for (int r = 0; r < nprocs; r++) {
+      fprintf(file, "%d,%d,%d,%.9f,%.9f,%.9f\n", all[r].rank,
+              all[r].coords[0], all[r].coords[1], all[r].compute,
+              all[r].sync, all[r].wait);
+    }
+  }
+
+  qsort(all, nprocs, sizeof(rank_times), compare_compute);
+  double avg       = sum / nprocs;
+  double imbalance = (avg > 0.0) ? all[0].compute / avg : 1.0;
+  printf("\nLoad imbalance (max / avg compute time): %.3f\n", imbalance);
+  if (timer_wait_split) {
+    printf("Waiting for the slowest process: %.6f seconds per process on "
+           "average\n",
+           wait_sum / nprocs);
+  }
+  printf("%-6s %10s %12s %12s %12s\n", "Rank", "Coords", "Compute", "Sync",
+         "Wait");
+  for (int k = 0; k < NSLOWEST && k < nprocs; k++) {
+    char coords[32];
+    snprintf(coords, sizeof(coords), "(%d,%d)", all[k].coords[0],
+             all[k].coords[1]);
+    printf("%-6d %10s %12.6f %12.6f ", all[k].rank, coords, all[k].compute,
+           all[k].sync);
+    if (timer_wait_split) {
+      printf("%12.6f\n", all[k].wait);
+    } else {
+      printf("%12s\n", "n/a");
+    }
+  }
+  if (imbalance > 1.1) {
+    printf("The slowest processes hold the others up; consider -w calibrate "
+           "or -p to rebalance\n");
+  }
+  if (file) {
+    fclose(file);
+    printf("Times of every process written to %s\n", filename);
+  }
+  free(all);
+}
+
+#endif
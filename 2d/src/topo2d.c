@@ -0,0 +1,141 @@
+/**
+ * @file  topo2d.c
+ * @brief Implementation of node-aware placement on the 2D process grid.
+ */
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../include/topo2d.h"
+
+/**
+ * @brief Identifies the node of every process.
+ *
+ * Processes on the same node are found with MPI_Comm_split_type, and each
+ * node is identified by the lowest rank in comm running on it. For testing on
+ * a single machine, nodes of ranks_per_node consecutive ranks can be
+ * simulated instead.
+ *
+ * @param[in]  comm           Communicator whose processes are to be placed.
+ * @param[in]  ranks_per_node Number of ranks per simulated node, or 0 to use
+ *                            the real nodes.
+ * @param[out] leaders        Node identifier of every rank in comm.
+ *
+ * @returns MPI_SUCCESS on successful completion.
+ */
+int topo2d_node_leaders(MPI_Comm comm, int ranks_per_node, int* leaders) {
+  int      rank, leader;
+  MPI_Comm node_comm;
+  MPI_Comm_rank(comm, &rank);
+  if (ranks_per_node > 0) {
+    MPI_Comm_split(comm, rank / ranks_per_node, rank, &node_comm);
+  } else {
+    MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL,
+                        &node_comm);
+  }
+  MPI_Allreduce(&rank, &leader, 1, MPI_INT, MPI_MIN, node_comm);
+  MPI_Allgather(&leader, 1, MPI_INT, leaders, 1, MPI_INT, comm);
+  MPI_Comm_free(&node_comm);
+  return MPI_SUCCESS;
+}
+
+/**
+ * @brief Assigns processes to the 2D process grid in node-sized tiles.
+ *
+ * Ranks are ordered node by node and then laid out over the process grid in
+ * bands of th rows, column by column within a band. A node with th * tw
+ * processes therefore receives a th x tw tile; th is the divisor of dims[0]
+ * that gives the most compact tile for the largest node.
+ *
+ * @param[in]  nprocs        Number of processes.
+ * @param[in]  dims          Dimensions of the 2D process grid.
+ * @param[in]  leaders       Node identifier of every rank.
+ * @param[out] cart_to_world Rank placed at each position of the process grid,
+ *                           indexed by row-major Cartesian rank.
+ */
+void topo2d_map_tiles(int nprocs, int* dims, int* leaders, int* cart_to_world) {
+  int* order = (int*) malloc(nprocs * sizeof(int)); // Ranks, node by node
+  int* size  = (int*) calloc(nprocs, sizeof(int));  // Ranks on each node
+  int* start = (int*) malloc(nprocs * sizeof(int)); // First slot of a node
+  if (!order || !size || !start) {
+    fprintf(stderr, "Memory allocation error\n");
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+
+  // Order the ranks by node, keeping their order within a node; leaders are
+  // ranks themselves, so a counting sort does this in O(nprocs)
+  for (int r = 0; r < nprocs; r++) {
+    size[leaders[r]]++;
+  }
+  int n = 0;
+  for (int l = 0; l < nprocs; l++) {
+    start[l] = n;
+    n += size[l];
+  }
+  for (int r = 0; r < nprocs; r++) {
+    order[start[leaders[r]]++] = r;
+  }
+  int node_size = 1;
+  for (int l = 0; l < nprocs; l++) {
+    if (size[l] > node_size) {
+      node_size = size[l];
+    }
+  }
+
+  // Choose the band height; a tile of th rows holds node_size / th columns,
+  // so its perimeter is smallest when th is close to sqrt(node_size)
+  int th = 1;
+  for (int d = 1; d <= dims[0]; d++) {
+    if (dims[0] % d == 0 &&
+        abs(d * d - node_size) < abs(th * th - node_size)) {
+      th = d;
+    }
+  }
+
+  // Walk the bands top to bottom and, within a band, column by column
+  n = 0;
+  for (int r0 = 0; r0 < dims[0]; r0 += th) {
+    for (int c = 0; c < dims[1]; c++) {
+      for (int r = r0; r < r0 + th; r++) {
+        cart_to_world[r * dims[1] + c] = order[n++];
+      }
+    }
+  }
+
+  free(order);
+  free(size);
+  free(start);
+}
+
+/**
+ * @brief Counts the halo edges of the process grid within and between nodes.
+ *
+ * @param[in]  dims          Dimensions of the 2D process grid.
+ * @param[in]  cart_to_world Rank placed at each position of the process grid.
+ * @param[in]  leaders       Node identifier of every rank.
+ * @param[out] intra         Number of neighbor pairs on the same node.
+ * @param[out] inter         Number of neighbor pairs on different nodes.
+ */
+void topo2d_count_edges(int* dims, int* cart_to_world, int* leaders,
+                        int* intra, int* inter) {
+  *intra = 0;
+  *inter = 0;
+  for (int r = 0; r < dims[0]; r++) {
+    for (int c = 0; c < dims[1]; c++) {
+      int self = leaders[cart_to_world[r * dims[1] + c]];
+      if (c + 1 < dims[1]) { // Right neighbor
+        if (self == leaders[cart_to_world[r * dims[1] + c + 1]])
+          (*intra)++;
+        else
+          (*inter)++;
+      }
+      if (r + 1 < dims[0]) { // Lower neighbor
+        if (self == leaders[cart_to_world[(r + 1) * dims[1] + c]])
+          (*intra)++;
+        else
+          (*inter)++;
+      }
+    }
+  }
+}
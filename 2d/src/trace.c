@@ -0,0 +1,202 @@
+/**
+ * @file  trace.c
+ * @brief Implementation of the event tracing of the solver phases.
+ */
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../include/timers.h"
+#include "../include/trace.h"
+
+// One phase of one process; times are in seconds from the origin
+typedef struct {
+  double start;
+  double end;
+  int    phase;
+  int    it; // Iteration, or -1 outside the iteration loop
+} trace_record;
+
+int trace_active = 0;
+
+static trace_record* events       = NULL; // Ring buffer of this process
+static long          ring_size    = 0;    // Capacity of the ring buffer
+static long          recorded     = 0;    // Events recorded, overwritten too
+static int           sample_every = 1;    // Record every this many iterations
+static int           current      = -1;   // Iteration being recorded
+static double        origin       = 0.0;  // MPI_Wtime at the trace's start
+
+/**
+ * @brief Allocates the ring buffer of the calling process and sets the time
+ *        origin of its events.
+ *
+ * The origin is taken straight after a barrier on every process, so that the
+ * tracks line up even if the clocks of the nodes do not agree.
+ *
+ * @param[in] capacity Number of events kept per process.
+ * @param[in] every    Record only the iterations that are a multiple of this.
+ * @param[in] comm     MPI communicator.
+ */
+void trace_init(int capacity, int every, MPI_Comm comm) {
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+
+  events = (trace_record*) malloc((size_t) capacity * sizeof(trace_record));
+  if (!events) {
+    fprintf(stderr, "Memory allocation error\n");
+    MPI_Abort(comm, 1);
+  }
+  ring_size    = capacity;
+  recorded     = 0;
+  sample_every = (every > 0) ? every : 1;
+  if (rank == 0) {
+#ifdef POISSON_TIMERS
+    printf("Tracing every %d iteration%s into %d events per process\n",
+           sample_every, (sample_every == 1) ? "" : "s", capacity);
+#else
+    printf("Events are recorded by the phase timers, which this build leaves "
+           "out (TIMERS=0)\n");
+#endif
+  }
+
+  MPI_Barrier(comm);
+  origin = MPI_Wtime();
+}
+
+/**
+ * @brief Selects whether the phases of an iteration are recorded.
+ *
+ * @param[in] it Iteration about to start, or -1 for the phases after the
+ *               iteration loop, which are always recorded.
+ */
+void trace_iteration(int it) {
+  current      = it;
+  trace_active = (events != NULL) && (it < 0 || it % sample_every == 0);
+}
+
+/**
+ * @brief Records a phase that started at start and ends now.
+ *
+ * @param[in] phase Phase being stopped, as in timers.h.
+ * @param[in] start Value of MPI_Wtime when the phase started.
+ */
+void trace_event(int phase, double start) {
+  trace_record* e = &events[recorded % ring_size];
+  e->end          = MPI_Wtime() - origin;
+  e->start        = start - origin;
+  e->phase        = phase;
+  e->it           = current;
+  recorded++;
+}
+
+/**
+ * @brief Writes the events of one process, oldest first.
+ *
+ * Once the buffer has wrapped around, the oldest event is the one after the
+ * most recent.
+ *
+ * @param[in,out] file  File to write to.
+ * @param[in]     rank  Rank of the process, used as its track.
+ * @param[in]     buf   Ring buffer of the process.
+ * @param[in]     n     Number of events recorded, including overwritten ones.
+ */
+static void write_events(FILE* file, int rank, const trace_record* buf,
+                         long n) {
+  long kept = (n < ring_size) ? n : ring_size;
+  for (long k = n - kept; k < n; k++) {
+    const trace_record* e = &buf[k % ring_size];
+    fprintf(file,
+            ",\n{\"name\":\"%s\",\"cat\":\"solver\",\"ph\":\"X\",\"pid\":0,"
+            "\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+            timer_phase_name(e->phase), rank,
+            1.0e6 * e->start, 1.0e6 * (e->end - e->start));
+    if (e->it >= 0) {
+      fprintf(file, ",\"args\":{\"iteration\":%d}", e->it);
+    }
+    fprintf(file, "}");
+  }
+}
+
+/**
+ * @brief Merges the events of all processes into a trace file and frees the
+ *        ring buffers.
+ *
+ * The root process receives the events of one process at a time, so its
+ * memory use does not grow with the number of processes, and reports how
+ * many events were overwritten because the buffers were full.
+ *
+ * @param[in] comm     MPI communicator.
+ * @param[in] filename Name of the JSON file to write.
+ */
+void trace_report(MPI_Comm comm, const char* filename) {
+  int rank, nprocs;
+  MPI_Comm_rank(comm, &rank);
+  MPI_Comm_size(comm, &nprocs);
+  trace_active = 0;
+
+  // Number of events each process holds in its buffer; the buffers all have
+  // the same capacity, so the root's is large enough for any of them
+  long* counts = NULL;
+  if (rank == 0) {
+    counts = (long*) malloc(nprocs * sizeof(long));
+    if (!counts) {
+      fprintf(stderr, "Memory allocation error\n");
+      MPI_Abort(comm, 1);
+    }
+  }
+  MPI_Gather(&recorded, 1, MPI_LONG, counts, 1, MPI_LONG, 0, comm);
+
+  if (rank != 0) {
+    long kept = (recorded < ring_size) ? recorded : ring_size;
+    MPI_Send(events, (int) (kept * sizeof(trace_record)), MPI_BYTE, 0, 0,
+             comm);
+    free(events);
+    events = NULL;
+    return;
+  }
+
+  // Write the root's events first, then reuse its buffer for the others
+  FILE* file = fopen(filename, "w");
+  if (!file) {
+    fprintf(stderr, "Error opening file %s for writing\n", filename);
+  } else {
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    fprintf(file,
+            "\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":0,"
+            "\"args\":{\"name\":\"poisson2d (%d processes)\"}}",
+            nprocs);
+    for (int r = 0; r < nprocs; r++) {
+      fprintf(file,
+              ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,"
+              "\"tid\":%d,\"args\":{\"name\":\"rank %d\"}}",
+              r, r);
+    }
+  }
+  long dropped = 0;
+  for (int r = 0; r < nprocs; r++) {
+    long kept = (counts[r] < ring_size) ? counts[r] : ring_size;
+    dropped += counts[r] - kept;
+    if (r > 0) {
+      MPI_Recv(events, (int) (kept * sizeof(trace_record)), MPI_BYTE, r, 0,
+               comm, MPI_STATUS_IGNORE);
+    }
+    if (file) {
+      write_events(file, r, events, counts[r]);
+    }
+  }
+  if (file) {
+    fprintf(file, "\n]}\n");
+    fclose(file);
+    printf("Trace of %d processes written to %s", nprocs, filename);
+    if (dropped > 0) {
+      printf(" (%ld older events overwritten; increase --trace to keep "
+             "them)",
+             dropped);
+    }
+    printf("\n");
+  }
+  free(counts);
+  free(events);
+  events = NULL;
+}
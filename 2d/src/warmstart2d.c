@@ -0,0 +1,161 @@
+/**
+ * @file  warmstart2d.c
+ * @brief Implementation of the initial guesses from a coarser grid.
+ */
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../include/aux.h"
+#include "../include/jacobi.h"
+#include "../include/timers.h"
+#include "../include/warmstart2d.h"
+
+/**
+ * @brief Replaces the interior of the local grid with the interpolated
+ *        solution of the problem on a coarser grid.
+ *
+ * The root process prints the size of the coarse grid and how long solving
+ * it took. If the grid is too small to be coarsened by factor, or a process
+ * would own no coarse points, a is left unchanged.
+ *
+ * @param[in]     factor   Coarsening factor in both directions.
+ * @param[in]     nx       Number of interior grid points in x-axis.
+ * @param[in]     ny       Number of interior grid points in y-axis.
+ * @param[in]     lnx      Number of local interior grid points in x-axis.
+ * @param[in]     lny      Number of local interior grid points in y-axis.
+ * @param[in,out] a        Grid array for current solution iteration.
+ * @param[in]     row_s    Starting row index of local domain.
+ * @param[in]     row_e    Ending row index of local domain.
+ * @param[in]     col_s    Starting column index of local domain.
+ * @param[in]     col_e    Ending column index of local domain.
+ * @param[in]     nbrleft  Rank of the left neighboring process.
+ * @param[in]     nbrright Rank of the right neighboring process.
+ * @param[in]     nbrup    Rank of the upper neighboring process.
+ * @param[in]     nbrdown  Rank of the lower neighboring process.
+ * @param[in]     niter    Maximum number of iterations of the coarse solve.
+ * @param[in]     tol      Convergence tolerance of the coarse solve.
+ * @param[in]     comm     Cartesian MPI communicator.
+ *
+ * @returns Number of iterations of the coarse solve, or -1 if a was left
+ *          unchanged.
+ */
+int warm_start2d(int factor, int nx, int ny, int lnx, int lny,
+                 double a[][lny + 2], int row_s, int row_e, int col_s,
+                 int col_e, int nbrleft, int nbrright, int nbrup, int nbrdown,
+                 int niter, double tol, MPI_Comm comm) {
+  int rank;
+  MPI_Comm_rank(comm, &rank);
+
+  // Coarse grid; a fine index maps to the coarse index scale times as large
+  long   nxc   = (nx + 1) / factor - 1;
+  long   nyc   = ((long) (ny + 1) * (nxc + 1) + nx) / (nx + 1) - 1;
+  double scale = (double) (nxc + 1) / (nx + 1);
+
+  // The coarse points lying after fine index s - 1 and up to fine index e
+  // are local, and the last process in each direction takes the rest
+  int rowc_s = (int) ((row_s - 1) * (nxc + 1) / (nx + 1)) + 1;
+  int rowc_e = (row_e == ny) ? (int) nyc
+                             : (int) (row_e * (nxc + 1) / (nx + 1));
+  int colc_s = (int) ((col_s - 1) * (nxc + 1) / (nx + 1)) + 1;
+  int colc_e = (col_e == nx) ? (int) nxc
+                             : (int) (col_e * (nxc + 1) / (nx + 1));
+  int lnxc   = colc_e - colc_s + 1;
+  int lnyc   = rowc_e - rowc_s + 1;
+  int local  = (nxc >= 1 && lnxc >= 1 && lnyc >= 1), usable;
+  MPI_Allreduce(&local, &usable, 1, MPI_INT, MPI_MIN, comm);
+  if (!usable) {
+    if (rank == 0) {
+      printf("\nThe grid is too small to be coarsened by %d on every "
+             "process; starting from zero\n",
+             factor);
+    }
+    return -1;
+  }
+
+  double(*ac)[lnyc + 2] = malloc(sizeof(double[lnxc + 2][lnyc + 2]));
+  double(*bc)[lnyc + 2] = malloc(sizeof(double[lnxc + 2][lnyc + 2]));
+  double(*fc)[lnyc + 2] = malloc(sizeof(double[lnxc + 2][lnyc + 2]));
+  if (!ac || !bc || !fc) {
+    fprintf(stderr, "Memory allocation error\n");
+    MPI_Abort(comm, 1);
+  }
+  init_twod(lnxc, lnyc, ac, bc, fc, (int) nxc, (int) nyc, rowc_s, rowc_e,
+            colc_s, colc_e);
+  MPI_Datatype row_type, full_row_type;
+  MPI_Type_vector(lnxc, 1, lnyc + 2, MPI_DOUBLE, &row_type);
+  MPI_Type_commit(&row_type);
+  MPI_Type_vector(lnxc + 2, 1, lnyc + 2, MPI_DOUBLE, &full_row_type);
+  MPI_Type_commit(&full_row_type);
+
+  // Same iteration as the solver with non-blocking exchanges
+  double hc = 1.0 / ((double) (nxc + 1));
+  double ldiff, glob_diff = 1000;
+  double t1 = MPI_Wtime();
+  int    it;
+  for (it = 0; it < niter && glob_diff >= tol; it++) {
+    for (int half = 0; half < 2; half++) {
+      double(*x)[lnyc + 2] = half ? bc : ac; // Grid to exchange
+      double(*y)[lnyc + 2] = half ? ac : bc; // Grid to update
+      TIMER_WAIT(comm);
+      TIMER_START(PHASE_EXCHANGE);
+      exchang2d_nb(lnxc, lnyc, x, comm, nbrleft, nbrright, nbrup, nbrdown,
+                   row_type);
+      TIMER_STOP(PHASE_EXCHANGE);
+      TIMER_START(PHASE_SWEEP);
+      sweep2d(lnxc, lnyc, x, fc, hc, y);
+      TIMER_STOP(PHASE_SWEEP);
+    }
+    TIMER_START(PHASE_RESIDUAL);
+    ldiff = griddiff2d(lnxc, lnyc, ac, bc);
+    TIMER_STOP(PHASE_RESIDUAL);
+    TIMER_WAIT(comm);
+    TIMER_START(PHASE_ALLREDUCE);
+    MPI_Allreduce(&ldiff, &glob_diff, 1, MPI_DOUBLE, MPI_SUM, comm);
+    TIMER_STOP(PHASE_ALLREDUCE);
+  }
+
+  // The interpolation reads the coarse ghost cells around the local block,
+  // corners included
+  TIMER_WAIT(comm);
+  TIMER_START(PHASE_EXCHANGE);
+  exchang2d_corner(lnxc, lnyc, ac, comm, nbrleft, nbrright, nbrup, nbrdown,
+                   full_row_type);
+  TIMER_STOP(PHASE_EXCHANGE);
+  for (int i = 1; i <= lnx; i++) {
+    double t  = (col_s - 1 + i) * scale;
+    int    ic = (int) t;
+    double wx = t - ic;
+    ic -= colc_s - 1;
+    if (ic > lnxc) { // Only where a fine point lies on the last ghost cell
+      ic = lnxc;
+      wx = 1.0;
+    }
+    for (int j = 1; j <= lny; j++) {
+      double s  = (row_s - 1 + j) * scale;
+      int    jc = (int) s;
+      double wy = s - jc;
+      jc -= rowc_s - 1;
+      if (jc > lnyc) {
+        jc = lnyc;
+        wy = 1.0;
+      }
+      a[i][j] = (1.0 - wx) * ((1.0 - wy) * ac[ic][jc] + wy * ac[ic][jc + 1]) +
+                wx * ((1.0 - wy) * ac[ic + 1][jc] + wy * ac[ic + 1][jc + 1]);
+    }
+  }
+  double t2 = MPI_Wtime();
+  if (rank == 0) {
+    printf("\nWarm start from a %ld x %ld grid: %d iterations in %.6f "
+           "seconds (global difference = %.6e)\n",
+           nxc, nyc, it, t2 - t1, glob_diff);
+  }
+
+  MPI_Type_free(&row_type);
+  MPI_Type_free(&full_row_type);
+  free(ac);
+  free(bc);
+  free(fc);
+  return it;
+}
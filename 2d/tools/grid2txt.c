@@ -0,0 +1,66 @@
+/**
+ * @file  grid2txt.c
+ * @brief Converts binary grid files to the text layout used by heatmap.gp.
+ *
+ * Usage: grid2txt file.bin [file.txt]. Without a second argument the output
+ * replaces the .bin extension of the input with .txt, and "-" writes to
+ * standard output.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "../include/gridfile.h"
+
+/**
+ * @brief Main function.
+ *
+ * @param[in] argc Number of command-line arguments.
+ * @param[in] argv Command-line arguments.
+ *
+ * @returns 0 on success, non-zero on error.
+ */
+int main(int argc, char** argv) {
+  if (argc < 2 || argc > 3) {
+    fprintf(stderr, "Usage is as follows: %s file.bin [file.txt|-]\n",
+            argv[0]);
+    return 1;
+  }
+
+  // Default output name; file.bin becomes file.txt
+  char out_filename[256];
+  if (argc == 3) {
+    snprintf(out_filename, sizeof(out_filename), "%s", argv[2]);
+  } else {
+    snprintf(out_filename, sizeof(out_filename), "%s", argv[1]);
+    char* ext = strrchr(out_filename, '.');
+    if (ext && strcmp(ext, ".bin") == 0) {
+      *ext = '\0';
+    }
+    strncat(out_filename, ".txt",
+            sizeof(out_filename) - strlen(out_filename) - 1);
+  }
+
+  grid_map map;
+  if (grid_map_open(argv[1], &map) != 0) {
+    return 1;
+  }
+
+  FILE* file = strcmp(out_filename, "-") == 0 ? stdout
+                                              : fopen(out_filename, "w");
+  if (!file) {
+    fprintf(stderr, "Error opening file %s for writing\n", out_filename);
+    grid_map_close(&map);
+    return 1;
+  }
+  int err = grid_map_write_text(&map, file);
+  if (file != stdout && fclose(file) != 0) {
+    err = 1;
+  }
+  if (err) {
+    fprintf(stderr, "Error writing file %s\n", out_filename);
+  }
+
+  grid_map_close(&map);
+  return err;
+}
@@ -0,0 +1,331 @@
+/**
+ * @file  halobench.c
+ * @brief Microbenchmark of the ghost cell exchanges of the 2D solver.
+ *
+ * Usage: mpirun -np nprocs halobench [-m min] [-M max] [-r reps] [-w warmup].
+ * The Cartesian communicator and the subdomains are set up as in main.c for a
+ * square grid; the global grid is then sized so that every process owns an
+ * L x L block, for L doubling from min to max. Only the exchange routines are
+ * timed. Every repetition starts after a barrier and takes as long as the
+ * slowest process, so that all MPI libraries are measured the same way. The
+ * results are printed and written to halo2dnprocs<nprocs>.csv, which starts
+ * every line with the MPI library so that files from different libraries can
+ * simply be concatenated.
+ */
+
+#include <math.h>
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../include/decomp2d.h"
+#include "../include/jacobi.h"
+#include "../include/poisson2d.h"
+
+#define NEXCH 5
+
+// Exchanges being compared; corner is the exchange of the 9-point stencil
+static const char* exch_name[NEXCH] = {"blocking", "nb", "fence", "pscw",
+                                       "corner"};
+
+/**
+ * @brief Value stored at a global grid point, so that ghost cells can be
+ *        checked after an exchange.
+ *
+ * @param[in] gi Global column index.
+ * @param[in] gj Global row index.
+ *
+ * @returns Value of the point.
+ */
+static double pattern(int gi, int gj) {
+  return gi * 65536.0 + gj;
+}
+
+/**
+ * @brief Compares the ghost cells of a block with the pattern.
+ *
+ * @param[in] lnx     Number of local interior grid points in x-axis.
+ * @param[in] lny     Number of local interior grid points in y-axis.
+ * @param[in] x       Grid array after an exchange.
+ * @param[in] row_s   Starting row index of local domain.
+ * @param[in] col_s   Starting column index of local domain.
+ * @param[in] nbrs    Ranks of the left, right, lower and upper neighbors.
+ * @param[in] corners Whether the corner ghost cells must be filled too.
+ *
+ * @returns Number of wrong ghost cells.
+ */
+static int check_ghosts(int lnx, int lny, double x[][lny + 2], int row_s,
+                        int col_s, int* nbrs, int corners) {
+  int wrong = 0;
+  int lo    = corners ? 0 : 1;
+  for (int j = lo; j <= lny + 1 - lo; j++) {
+
+    // A corner is only filled if there is a neighbor below or above as well
+    int side = (j == 0) ? 2 : ((j == lny + 1) ? 3 : -1);
+    if (side >= 0 && nbrs[side] == MPI_PROC_NULL) {
+      continue;
+    }
+    if (nbrs[0] != MPI_PROC_NULL) {
+      wrong += x[0][j] != pattern(col_s - 1, row_s - 1 + j);
+    }
+    if (nbrs[1] != MPI_PROC_NULL) {
+      wrong += x[lnx + 1][j] != pattern(col_s + lnx, row_s - 1 + j);
+    }
+  }
+  for (int i = 1; i <= lnx; i++) {
+    if (nbrs[2] != MPI_PROC_NULL) {
+      wrong += x[i][0] != pattern(col_s - 1 + i, row_s - 1);
+    }
+    if (nbrs[3] != MPI_PROC_NULL) {
+      wrong += x[i][lny + 1] != pattern(col_s - 1 + i, row_s + lny);
+    }
+  }
+  return wrong;
+}
+
+/**
+ * @brief Compares doubles for qsort.
+ *
+ * @param[in] p First value.
+ * @param[in] q Second value.
+ *
+ * @returns Negative, zero or positive as *p is below, equal to or above *q.
+ */
+static int compare_doubles(const void* p, const void* q) {
+  double x = *(const double*) p;
+  double y = *(const double*) q;
+  return (x > y) - (x < y);
+}
+
+/**
+ * @brief Main function.
+ *
+ * @param[in] argc Number of command-line arguments.
+ * @param[in] argv Command-line arguments.
+ *
+ * @returns 0 on success, non-zero on error.
+ */
+int main(int argc, char** argv) {
+  int myid, nprocs;
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &myid);
+  MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+
+  // Process the command-line arguments; every process parses them so that no
+  // broadcast is needed
+  int min_size = 8, max_size = 1024, reps = 100, warmup = 10;
+  int opt, bad = 0;
+  while ((opt = getopt(argc, argv, "m:M:r:w:")) != -1) {
+    switch (opt) {
+      case 'm': min_size = atoi(optarg); break;
+      case 'M': max_size = atoi(optarg); break;
+      case 'r': reps = atoi(optarg); break;
+      case 'w': warmup = atoi(optarg); break;
+      default: bad = 1;
+    }
+  }
+  if (bad || optind < argc || min_size < 1 || max_size < min_size ||
+      reps < 1 || warmup < 0) {
+    if (myid == 0) {
+      fprintf(stderr,
+              "Usage is as follows: mpirun -np nprocs %s [-m min] [-M max] "
+              "[-r reps] [-w warmup]\n",
+              argv[0]);
+    }
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+
+  // Name of the MPI library; only its first line is kept, without commas, so
+  // that it fits in a CSV field
+  char library[MPI_MAX_LIBRARY_VERSION_STRING];
+  int  len;
+  MPI_Get_library_version(library, &len);
+  library[strcspn(library, "\n")] = '\0';
+  for (char* c = library; *c; c++) {
+    if (*c == ',') {
+      *c = ' ';
+    }
+  }
+
+  // Cartesian communicator as created by main.c
+  int      dims[2];
+  int      periods[2] = {0, 0};
+  int      coords[2];
+  int      cart_rank;
+  MPI_Comm cart_comm;
+  if (decomp2d_dims(nprocs, max_size * nprocs, max_size * nprocs, dims) !=
+      MPI_SUCCESS) {
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+  MPI_Cart_create(MPI_COMM_WORLD, 2, dims, periods, 1, &cart_comm);
+  MPI_Comm_rank(cart_comm, &cart_rank);
+  MPI_Cart_coords(cart_comm, cart_rank, 2, coords);
+  int nbrup, nbrdown, nbrleft, nbrright;
+  MPI_Cart_shift(cart_comm, 0, 1, &nbrup, &nbrdown);
+  MPI_Cart_shift(cart_comm, 1, 1, &nbrleft, &nbrright);
+  int       nbrs[4] = {nbrleft, nbrright, nbrdown, nbrup};
+  MPI_Group cart_group;
+  MPI_Comm_group(cart_comm, &cart_group);
+
+  FILE* csv = NULL;
+  if (cart_rank == 0) {
+    char csv_filename[256];
+    sprintf(csv_filename, "halo2dnprocs%d.csv", nprocs);
+    csv = fopen(csv_filename, "w");
+    if (!csv) {
+      fprintf(stderr, "Error opening file %s for writing\n", csv_filename);
+      MPI_Abort(cart_comm, 1);
+    }
+    fprintf(csv, "library,nprocs,px,py,lnx,lny,exchange,reps,bytes,min,"
+                 "median,mean,max,stddev,bandwidth\n");
+    printf("Halo exchange benchmark with %d processes on a %d x %d process "
+           "grid\n%s\n\n",
+           nprocs, dims[1], dims[0], library);
+    printf("%6s %9s %10s %12s %12s %12s %11s %12s\n", "Block", "Exchange",
+           "Bytes", "Min (us)", "Median (us)", "Mean (us)", "Stddev/mean",
+           "MB/s");
+  }
+
+  double* t   = (double*) malloc(reps * sizeof(double));
+  double* t_g = (double*) malloc(reps * sizeof(double));
+  if (!t || !t_g) {
+    fprintf(stderr, "Memory allocation error\n");
+    MPI_Abort(cart_comm, 1);
+  }
+
+  for (int size = min_size; size <= max_size; size *= 2) {
+
+    // Global grid such that every process owns a size x size block, split as
+    // in main.c
+    int nx = size * dims[1];
+    int ny = size * dims[0];
+    int row_s, row_e, col_s, col_e;
+    MPE_Decomp2d(ny, nx, cart_rank, coords, &row_s, &row_e, &col_s, &col_e,
+                 dims);
+    int lnx = col_e - col_s + 1;
+    int lny = row_e - row_s + 1;
+
+    double(*x)[lny + 2] = malloc(sizeof(double[lnx + 2][lny + 2]));
+    if (!x) {
+      fprintf(stderr, "Memory allocation error\n");
+      MPI_Abort(cart_comm, 1);
+    }
+
+    // Datatypes and window used by the solver
+    MPI_Datatype row_type, full_row_type;
+    MPI_Type_vector(lnx, 1, lny + 2, MPI_DOUBLE, &row_type);
+    MPI_Type_commit(&row_type);
+    MPI_Type_vector(lnx + 2, 1, lny + 2, MPI_DOUBLE, &full_row_type);
+    MPI_Type_commit(&full_row_type);
+    int          nbr_lsize[4] = {lnx, lnx, lny, lny};
+    MPI_Datatype recv_types[4], get_types[4];
+    create_rma_types2d(lnx, lny, nbr_lsize, recv_types, get_types);
+    MPI_Win win;
+    MPI_Win_create(x, sizeof(double[lnx + 2][lny + 2]), sizeof(double),
+                   MPI_INFO_NULL, cart_comm, &win);
+
+    for (int e = 0; e < NEXCH; e++) {
+
+      // Bytes received by the process with the most neighbors
+      long bytes = 0;
+      for (int d = 0; d < 4; d++) {
+        if (nbrs[d] != MPI_PROC_NULL) {
+          bytes += (d < 2) ? lny : ((e == 4) ? lnx + 2 : lnx);
+        }
+      }
+      bytes *= sizeof(double);
+      long max_bytes;
+      MPI_Reduce(&bytes, &max_bytes, 1, MPI_LONG, MPI_MAX, 0, cart_comm);
+
+      // The interior holds the pattern of the global grid and the ghost cells
+      // are cleared
+      for (int i = 0; i <= lnx + 1; i++) {
+        for (int j = 0; j <= lny + 1; j++) {
+          int ghost = i == 0 || i == lnx + 1 || j == 0 || j == lny + 1;
+          x[i][j]   = ghost ? -1.0 : pattern(col_s - 1 + i, row_s - 1 + j);
+        }
+      }
+
+      for (int r = -warmup; r < reps; r++) {
+        MPI_Barrier(cart_comm);
+        double t0 = MPI_Wtime();
+        switch (e) {
+          case 0:
+            exchang2d_1(lnx, lny, x, cart_comm, nbrleft, nbrright, nbrup,
+                        nbrdown, row_type);
+            break;
+          case 1:
+            exchang2d_nb(lnx, lny, x, cart_comm, nbrleft, nbrright, nbrup,
+                         nbrdown, row_type);
+            break;
+          case 2:
+            exchang2d_rma_fence(&x[0][0], nbrs, recv_types, get_types, win);
+            break;
+          case 3:
+            exchang2d_rma_pscw(&x[0][0], nbrs, recv_types, get_types, win,
+                               cart_group);
+            break;
+          case 4:
+            exchang2d_corner(lnx, lny, x, cart_comm, nbrleft, nbrright, nbrup,
+                             nbrdown, full_row_type);
+            break;
+        }
+        if (r >= 0) {
+          t[r] = MPI_Wtime() - t0;
+        }
+      }
+
+      // Check that the exchange did its job
+      int wrong = check_ghosts(lnx, lny, x, row_s, col_s, nbrs, e == 4);
+      int wrong_g;
+      MPI_Reduce(&wrong, &wrong_g, 1, MPI_INT, MPI_SUM, 0, cart_comm);
+
+      // A repetition takes as long as its slowest process
+      MPI_Reduce(t, t_g, reps, MPI_DOUBLE, MPI_MAX, 0, cart_comm);
+      if (cart_rank == 0) {
+        double mean = 0.0, var = 0.0;
+        for (int r = 0; r < reps; r++) {
+          mean += t_g[r];
+        }
+        mean /= reps;
+        for (int r = 0; r < reps; r++) {
+          var += (t_g[r] - mean) * (t_g[r] - mean);
+        }
+        var /= reps;
+        qsort(t_g, reps, sizeof(double), compare_doubles);
+        double median = (reps % 2) ? t_g[reps / 2]
+                                   : 0.5 * (t_g[reps / 2 - 1] + t_g[reps / 2]);
+        double stddev    = sqrt(var);
+        double bandwidth = max_bytes / median / 1.0e6;
+        printf("%6d %9s %10ld %12.3f %12.3f %12.3f %11.3f %12.1f%s\n", size,
+               exch_name[e], max_bytes, 1.0e6 * t_g[0], 1.0e6 * median,
+               1.0e6 * mean, stddev / mean, bandwidth,
+               wrong_g ? "  WRONG GHOST CELLS" : "");
+        fprintf(csv, "%s,%d,%d,%d,%d,%d,%s,%d,%ld,%.9e,%.9e,%.9e,%.9e,%.9e,"
+                     "%.3f\n",
+                library, nprocs, dims[1], dims[0], lnx, lny, exch_name[e],
+                reps, max_bytes, t_g[0], median, mean, t_g[reps - 1], stddev,
+                bandwidth);
+      }
+    }
+
+    MPI_Win_free(&win);
+    free_rma_types2d(recv_types, get_types);
+    MPI_Type_free(&row_type);
+    MPI_Type_free(&full_row_type);
+    free(x);
+  }
+
+  if (cart_rank == 0) {
+    fclose(csv);
+    printf("\nResults written to halo2dnprocs%d.csv\n", nprocs);
+  }
+  free(t);
+  free(t_g);
+  MPI_Group_free(&cart_group);
+  MPI_Comm_free(&cart_comm);
+  MPI_Finalize();
+  return 0;
+}
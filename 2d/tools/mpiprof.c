@@ -0,0 +1,740 @@
+/**
+ * @file  mpiprof.c
+ * @brief MPI profiling layer that accounts for the messages of every call.
+ *
+ * Linked into the solver with make PMPI=1, these wrappers take the place of
+ * the MPI library's own point-to-point, one-sided, window synchronisation and
+ * collective calls, and pass them on through the PMPI profiling interface,
+ * so that no call site has to change. Every call is counted, timed and
+ * charged with the bytes it passes, per call site: the caller's return
+ * address, which is named with dladdr when the executable exports its
+ * symbols (-rdynamic). The data each process sends to each other process,
+ * by message or by MPI_Put and MPI_Get, is kept in world ranks.
+ *
+ * When the job calls MPI_Finalize, the root process prints the call sites
+ * with their total calls and bytes and the minimum, average and maximum time
+ * over all processes, the traffic of every rank and, for up to 16
+ * processes, the full traffic matrix, which is also written to
+ * mpiprofnprocs<nprocs>.csv.
+ */
+
+#if defined(__linux__)
+#define _GNU_SOURCE
+#endif
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <dlfcn.h>
+#define HAVE_DLADDR
+#endif
+
+#define MAX_SITES 256  // Call sites kept per process; the rest share one
+#define CACHE_SIZE 16  // Communicators and windows whose ranks are cached
+#define MAX_MATRIX 16  // Largest number of processes whose matrix is printed
+#define CALLER_LEN 40  // Length kept of the name of a caller
+
+// Calls that are intercepted
+enum {
+  CALL_SEND,
+  CALL_RECV,
+  CALL_SENDRECV,
+  CALL_ISEND,
+  CALL_IRECV,
+  CALL_WAIT,
+  CALL_WAITALL,
+  CALL_PUT,
+  CALL_GET,
+  CALL_WIN_CREATE,
+  CALL_WIN_FREE,
+  CALL_WIN_FENCE,
+  CALL_WIN_POST,
+  CALL_WIN_START,
+  CALL_WIN_COMPLETE,
+  CALL_WIN_WAIT,
+  CALL_BARRIER,
+  CALL_BCAST,
+  CALL_REDUCE,
+  CALL_ALLREDUCE,
+  CALL_GATHER,
+  CALL_ALLGATHER,
+  CALL_ALLTOALLW,
+  CALL_EXSCAN,
+  NCALLS
+};
+
+static const char* call_names[NCALLS] = {
+    "MPI_Send",         "MPI_Recv",       "MPI_Sendrecv",   "MPI_Isend",
+    "MPI_Irecv",        "MPI_Wait",       "MPI_Waitall",    "MPI_Put",
+    "MPI_Get",          "MPI_Win_create", "MPI_Win_free",   "MPI_Win_fence",
+    "MPI_Win_post",     "MPI_Win_start",  "MPI_Win_complete",
+    "MPI_Win_wait",     "MPI_Barrier",    "MPI_Bcast",      "MPI_Reduce",
+    "MPI_Allreduce",    "MPI_Gather",     "MPI_Allgather",  "MPI_Alltoallw",
+    "MPI_Exscan"};
+
+// Totals of one call site of one process; the caller and its offset are
+// filled in when the sites are reported
+typedef struct {
+  int    call;
+  char   caller[CALLER_LEN];
+  long   offset; // Return address relative to the start of its object file
+  long   calls;
+  double bytes;
+  double time;
+} prof_site;
+
+static prof_site sites[MAX_SITES];
+static void*     site_addr[MAX_SITES]; // Return address of each site
+static int       nsites = 0;
+
+// Messages and bytes this process sent to every world rank, and fetched
+// from every world rank with MPI_Get
+static int   world_size = 0;
+static long* msgs_to    = NULL;
+static long* bytes_to   = NULL;
+static long* msgs_from  = NULL;
+static long* bytes_from = NULL;
+
+// World ranks of the processes of recently used communicators and windows
+typedef struct {
+  MPI_Comm comm;
+  MPI_Win  win;
+  int*     world;
+} rank_map;
+
+static rank_map cache[CACHE_SIZE];
+static int      ncached = 0, next_evict = 0;
+
+/**
+ * @brief Charges a call to the site it was made from.
+ *
+ * @param[in] call  Call made.
+ * @param[in] addr  Return address of the call.
+ * @param[in] bytes Bytes passed by the call.
+ * @param[in] time  Time spent in the call.
+ */
+static void record(int call, void* addr, double bytes, double time) {
+  int s = 0;
+  while (s < nsites && !(sites[s].call == call && site_addr[s] == addr)) {
+    s++;
+  }
+  if (s == nsites) {
+
+    // Once out of sites, the last one takes every new site, shown as other
+    if (nsites == MAX_SITES) {
+      s = MAX_SITES - 1;
+    } else {
+      nsites++;
+      sites[s].call = call;
+      site_addr[s]  = (nsites == MAX_SITES) ? NULL : addr;
+    }
+  }
+  sites[s].calls++;
+  sites[s].bytes += bytes;
+  sites[s].time += time;
+}
+
+/**
+ * @brief Number of bytes in count elements of a datatype.
+ *
+ * @param[in] count    Number of elements.
+ * @param[in] datatype Datatype of the elements.
+ *
+ * @returns Number of bytes.
+ */
+static double type_bytes(int count, MPI_Datatype datatype) {
+  int size;
+  PMPI_Type_size(datatype, &size);
+  return (double) count * size;
+}
+
+/**
+ * @brief Number of bytes passed to or from a peer process, which is none
+ *        for MPI_PROC_NULL, as in the traffic matrix.
+ *
+ * @param[in] peer     Rank of the peer process, or MPI_PROC_NULL.
+ * @param[in] count    Number of elements.
+ * @param[in] datatype Datatype of the elements.
+ *
+ * @returns Number of bytes.
+ */
+static double peer_bytes(int peer, int count, MPI_Datatype datatype) {
+  return (peer == MPI_PROC_NULL) ? 0.0 : type_bytes(count, datatype);
+}
+
+/**
+ * @brief World rank of a process of a communicator or window.
+ *
+ * @param[in] comm Communicator, or MPI_COMM_NULL if win is given.
+ * @param[in] win  Window, or MPI_WIN_NULL if comm is given.
+ * @param[in] rank Rank of the process in the group of comm or win.
+ *
+ * @returns World rank of the process, or -1 if there is none.
+ */
+static int world_rank(MPI_Comm comm, MPI_Win win, int rank) {
+  if (rank < 0 || !msgs_to) {
+    return -1; // MPI_PROC_NULL, or MPI not initialised through the wrappers
+  }
+  if (comm == MPI_COMM_WORLD) {
+    return rank;
+  }
+  for (int k = 0; k < ncached; k++) {
+    if (cache[k].comm == comm && cache[k].win == win) {
+      return cache[k].world[rank];
+    }
+  }
+
+  // Translate all ranks of the group at once
+  MPI_Group group, world_group;
+  int       n;
+  if (comm != MPI_COMM_NULL) {
+    PMPI_Comm_group(comm, &group);
+  } else {
+    PMPI_Win_get_group(win, &group);
+  }
+  PMPI_Comm_group(MPI_COMM_WORLD, &world_group);
+  PMPI_Group_size(group, &n);
+  int* ranks = (int*) malloc(n * sizeof(int));
+  int* world = (int*) malloc(n * sizeof(int));
+  if (!ranks || !world) {
+    fprintf(stderr, "Memory allocation error\n");
+    PMPI_Abort(MPI_COMM_WORLD, 1);
+  }
+  for (int k = 0; k < n; k++) {
+    ranks[k] = k;
+  }
+  PMPI_Group_translate_ranks(group, n, ranks, world_group, world);
+  PMPI_Group_free(&group);
+  PMPI_Group_free(&world_group);
+  free(ranks);
+
+  int k;
+  if (ncached < CACHE_SIZE) {
+    k = ncached++;
+  } else {
+    k = next_evict;
+    free(cache[k].world);
+    next_evict = (next_evict + 1) % CACHE_SIZE;
+  }
+  cache[k].comm  = comm;
+  cache[k].win   = win;
+  cache[k].world = world;
+  return world[rank];
+}
+
+/**
+ * @brief Forgets the ranks of a communicator or window that is being freed,
+ *        as its handle may be reused.
+ *
+ * @param[in] comm Communicator, or MPI_COMM_NULL if win is given.
+ * @param[in] win  Window, or MPI_WIN_NULL if comm is given.
+ */
+static void forget(MPI_Comm comm, MPI_Win win) {
+  for (int k = 0; k < ncached; k++) {
+    if (cache[k].comm == comm && cache[k].win == win) {
+      free(cache[k].world);
+      cache[k] = cache[--ncached];
+      next_evict = 0;
+      return;
+    }
+  }
+}
+
+/**
+ * @brief Counts a message sent to a process.
+ *
+ * @param[in] world Its world rank, or -1 if there is none.
+ * @param[in] bytes Size of the message.
+ */
+static void sent_to(int world, double bytes) {
+  if (world >= 0) {
+    msgs_to[world]++;
+    bytes_to[world] += (long) bytes;
+  }
+}
+
+/**
+ * @brief Allocates the traffic counters once MPI has been initialised.
+ */
+static void prof_init(void) {
+  PMPI_Comm_size(MPI_COMM_WORLD, &world_size);
+  msgs_to    = (long*) calloc(world_size, sizeof(long));
+  bytes_to   = (long*) calloc(world_size, sizeof(long));
+  msgs_from  = (long*) calloc(world_size, sizeof(long));
+  bytes_from = (long*) calloc(world_size, sizeof(long));
+  if (!msgs_to || !bytes_to || !msgs_from || !bytes_from) {
+    fprintf(stderr, "Memory allocation error\n");
+    PMPI_Abort(MPI_COMM_WORLD, 1);
+  }
+}
+
+/**
+ * @brief Orders merged call sites by decreasing total time.
+ *
+ * @param[in] p First site.
+ * @param[in] q Second site.
+ *
+ * @returns Negative, zero or positive as p comes before, with or after q.
+ */
+static int compare_sites(const void* p, const void* q) {
+  double a = ((const prof_site*) p)->time, b = ((const prof_site*) q)->time;
+  return (a < b) - (a > b);
+}
+
+/**
+ * @brief Orders traffic edges by source and then destination process.
+ *
+ * @param[in] p First edge of source, destination, messages and bytes.
+ * @param[in] q Second edge.
+ *
+ * @returns Negative, zero or positive as p comes before, with or after q.
+ */
+static int compare_edges(const void* p, const void* q) {
+  const long* a = (const long*) p;
+  const long* b = (const long*) q;
+  return (a[0] != b[0]) ? (a[0] > b[0]) - (a[0] < b[0])
+                        : (a[1] > b[1]) - (a[1] < b[1]);
+}
+
+/**
+ * @brief Prints the call sites and the traffic of all processes on the root
+ *        process, and writes the traffic matrix.
+ */
+static void prof_report(void) {
+  int rank, n = world_size;
+  PMPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+  // Name the sites; offsets within the object file agree between processes
+  // even when the executable is loaded at different addresses
+  for (int s = 0; s < nsites; s++) {
+    snprintf(sites[s].caller, CALLER_LEN, "%s", site_addr[s] ? "?" : "other");
+    sites[s].offset = (long) site_addr[s];
+#ifdef HAVE_DLADDR
+    Dl_info info;
+    if (site_addr[s] && dladdr(site_addr[s], &info)) {
+      sites[s].offset = (long) ((char*) site_addr[s] - (char*) info.dli_fbase);
+      if (info.dli_sname) {
+        snprintf(sites[s].caller, CALLER_LEN, "%s+0x%lx", info.dli_sname,
+                 (unsigned long) ((char*) site_addr[s] -
+                                  (char*) info.dli_saddr));
+      }
+    }
+#endif
+  }
+
+  // Gather the sites and traffic of every process
+  int* counts = NULL;
+  int* displs = NULL;
+  if (rank == 0) {
+    counts = (int*) malloc(n * sizeof(int));
+    displs = (int*) malloc(n * sizeof(int));
+    if (!counts || !displs) {
+      fprintf(stderr, "Memory allocation error\n");
+      PMPI_Abort(MPI_COMM_WORLD, 1);
+    }
+  }
+  int nbytes = nsites * (int) sizeof(prof_site);
+  PMPI_Gather(&nbytes, 1, MPI_INT, counts, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  int total = 0;
+  if (rank == 0) {
+    for (int r = 0; r < n; r++) {
+      displs[r] = total;
+      total += counts[r];
+    }
+  }
+  prof_site* all = (rank == 0) ? (prof_site*) malloc(total + 1) : NULL;
+  if (rank == 0 && !all) {
+    fprintf(stderr, "Memory allocation error\n");
+    PMPI_Abort(MPI_COMM_WORLD, 1);
+  }
+  PMPI_Gatherv(sites, nbytes, MPI_BYTE, all, counts, displs, MPI_BYTE, 0,
+               MPI_COMM_WORLD);
+
+  // Only the edges that carried data are gathered, as (source, destination,
+  // messages, bytes); a halo exchange has a handful per process
+  int nmine = 0;
+  for (int r = 0; r < n; r++) {
+    nmine += (msgs_to[r] > 0) + (msgs_from[r] > 0);
+  }
+  long* mine = (long*) malloc((4 * (size_t) nmine + 1) * sizeof(long));
+  if (!mine) {
+    fprintf(stderr, "Memory allocation error\n");
+    PMPI_Abort(MPI_COMM_WORLD, 1);
+  }
+  int m4 = 0;
+  for (int r = 0; r < n; r++) {
+    if (msgs_to[r] > 0) {
+      long edge[4] = {rank, r, msgs_to[r], bytes_to[r]};
+      memcpy(&mine[m4], edge, sizeof(edge));
+      m4 += 4;
+    }
+    if (msgs_from[r] > 0) {
+      long edge[4] = {r, rank, msgs_from[r], bytes_from[r]};
+      memcpy(&mine[m4], edge, sizeof(edge));
+      m4 += 4;
+    }
+  }
+  PMPI_Gather(&m4, 1, MPI_INT, counts, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  int nedges = 0;
+  if (rank == 0) {
+    for (int r = 0; r < n; r++) {
+      displs[r] = nedges;
+      nedges += counts[r];
+    }
+  }
+  long* edges = (rank == 0) ? (long*) malloc((nedges + 1) * sizeof(long))
+                            : NULL;
+  if (rank == 0 && !edges) {
+    fprintf(stderr, "Memory allocation error\n");
+    PMPI_Abort(MPI_COMM_WORLD, 1);
+  }
+  PMPI_Gatherv(mine, m4, MPI_LONG, edges, counts, displs, MPI_LONG, 0,
+               MPI_COMM_WORLD);
+  free(mine);
+  if (rank != 0) {
+    return;
+  }
+
+  // An edge fetched with MPI_Get may also have carried messages, so the
+  // edges are sorted and the duplicates merged
+  nedges /= 4;
+  qsort(edges, nedges, 4 * sizeof(long), compare_edges);
+  int nmerged = 0;
+  for (int e = 0; e < nedges; e++) {
+    long* edge = &edges[4 * e];
+    long* last = &edges[4 * (nmerged > 0 ? nmerged - 1 : 0)];
+    if (nmerged > 0 && last[0] == edge[0] && last[1] == edge[1]) {
+      last[2] += edge[2];
+      last[3] += edge[3];
+    } else {
+      memmove(&edges[4 * nmerged], edge, 4 * sizeof(long));
+      nmerged++;
+    }
+  }
+  nedges = nmerged;
+
+  // Merge the sites of all processes, along with the least and most time a
+  // process spent in each
+  int        nall   = total / (int) sizeof(prof_site);
+  int        nmerge = 0;
+  prof_site* merged = (prof_site*) malloc((nall + 1) * sizeof(prof_site));
+  double*    t_min  = (double*) malloc((nall + 1) * sizeof(double));
+  double*    t_max  = (double*) malloc((nall + 1) * sizeof(double));
+  int*       nprocs = (int*) malloc((nall + 1) * sizeof(int));
+  if (!merged || !t_min || !t_max || !nprocs) {
+    fprintf(stderr, "Memory allocation error\n");
+    PMPI_Abort(MPI_COMM_WORLD, 1);
+  }
+  for (int k = 0; k < nall; k++) {
+    int m = 0;
+    while (m < nmerge && !(merged[m].call == all[k].call &&
+                           merged[m].offset == all[k].offset)) {
+      m++;
+    }
+    if (m == nmerge) {
+      merged[m]       = all[k];
+      merged[m].calls = 0;
+      merged[m].bytes = 0.0;
+      merged[m].time  = 0.0;
+      t_min[m]        = all[k].time;
+      t_max[m]        = all[k].time;
+      nprocs[m]       = 0;
+      nmerge++;
+    }
+    merged[m].calls += all[k].calls;
+    merged[m].bytes += all[k].bytes;
+    merged[m].time += all[k].time;
+    t_min[m] = (all[k].time < t_min[m]) ? all[k].time : t_min[m];
+    t_max[m] = (all[k].time > t_max[m]) ? all[k].time : t_max[m];
+    nprocs[m]++;
+  }
+
+  // Sort the sites by total time; their offsets are no longer needed, so
+  // they are replaced with the index of the extremes of each site
+  for (int m = 0; m < nmerge; m++) {
+    merged[m].offset = m;
+  }
+  qsort(merged, nmerge, sizeof(prof_site), compare_sites);
+
+  printf("\nMPI calls per call site over %d processes\n", n);
+  printf("%-16s %-28s %10s %14s %33s\n", "Call", "Caller", "Calls", "Bytes",
+         "Time min / avg / max (s)");
+  for (int m = 0; m < nmerge; m++) {
+    int k = (int) merged[m].offset;
+
+    // Processes that never made a call from a site spent no time there
+    double lo = (nprocs[k] < n) ? 0.0 : t_min[k];
+    printf("%-16s %-28s %10ld %14.0f %10.6f / %9.6f / %9.6f\n",
+           call_names[merged[m].call], merged[m].caller, merged[m].calls,
+           merged[m].bytes, lo, merged[m].time / n, t_max[k]);
+  }
+
+  // Traffic of each rank; a message sent is counted by its sender and data
+  // fetched with MPI_Get by the process that fetched it
+  printf("\nPoint-to-point and one-sided traffic per process\n");
+  printf("%6s %10s %10s %14s %14s\n", "Rank", "Neighbours", "Messages",
+         "Bytes sent", "Bytes recvd");
+  long* totals = (long*) calloc(4 * (size_t) n, sizeof(long));
+  if (!totals) {
+    fprintf(stderr, "Memory allocation error\n");
+    PMPI_Abort(MPI_COMM_WORLD, 1);
+  }
+  for (int e = 0; e < nedges; e++) {
+    long* edge = &edges[4 * e];
+    totals[4 * edge[0]] += (edge[3] > 0 && edge[1] != edge[0]);
+    totals[4 * edge[0] + 1] += edge[2];
+    totals[4 * edge[0] + 2] += edge[3];
+    totals[4 * edge[1] + 3] += edge[3];
+  }
+  for (int r = 0; r < n; r++) {
+    long* t = &totals[4 * r];
+    printf("%6d %10ld %10ld %14ld %14ld\n", r, t[0], t[1], t[2], t[3]);
+  }
+  free(totals);
+  if (n <= MAX_MATRIX) {
+    long matrix_bytes[MAX_MATRIX * MAX_MATRIX] = {0};
+    for (int e = 0; e < nedges; e++) {
+      matrix_bytes[edges[4 * e] * n + edges[4 * e + 1]] = edges[4 * e + 3];
+    }
+    printf("\nBytes sent from each process (row) to each process (column)\n");
+    printf("%6s", "");
+    for (int c = 0; c < n; c++) {
+      printf(" %9d", c);
+    }
+    printf("\n");
+    for (int r = 0; r < n; r++) {
+      printf("%6d", r);
+      for (int c = 0; c < n; c++) {
+        printf(" %9ld", matrix_bytes[r * n + c]);
+      }
+      printf("\n");
+    }
+  }
+
+  char filename[256];
+  sprintf(filename, "mpiprofnprocs%d.csv", n);
+  FILE* file = fopen(filename, "w");
+  if (!file) {
+    fprintf(stderr, "Error opening file %s for writing\n", filename);
+  } else {
+    fprintf(file, "source,destination,messages,bytes\n");
+    for (int e = 0; e < nedges; e++) {
+      long* edge = &edges[4 * e];
+      fprintf(file, "%ld,%ld,%ld,%ld\n", edge[0], edge[1], edge[2], edge[3]);
+    }
+    fclose(file);
+    printf("Traffic matrix written to %s\n", filename);
+  }
+
+  free(counts);
+  free(displs);
+  free(edges);
+  free(all);
+  free(merged);
+  free(t_min);
+  free(t_max);
+  free(nprocs);
+}
+
+// Times the call of a PMPI function and charges it with bytes to the caller
+#define PROFILE(call, bytes, pmpi_call)                                        \
+  double t   = PMPI_Wtime();                                                   \
+  int    err = pmpi_call;                                                      \
+  record(call, __builtin_return_address(0), bytes, PMPI_Wtime() - t);          \
+  return err
+
+int MPI_Init(int* argc, char*** argv) {
+  int err = PMPI_Init(argc, argv);
+  prof_init();
+  return err;
+}
+
+int MPI_Init_thread(int* argc, char*** argv, int required, int* provided) {
+  int err = PMPI_Init_thread(argc, argv, required, provided);
+  prof_init();
+  return err;
+}
+
+int MPI_Finalize(void) {
+  prof_report();
+  for (int k = 0; k < ncached; k++) {
+    free(cache[k].world);
+  }
+  free(msgs_to);
+  free(bytes_to);
+  free(msgs_from);
+  free(bytes_from);
+  return PMPI_Finalize();
+}
+
+int MPI_Comm_free(MPI_Comm* comm) {
+  forget(*comm, MPI_WIN_NULL);
+  return PMPI_Comm_free(comm);
+}
+
+int MPI_Send(const void* buf, int count, MPI_Datatype datatype, int dest,
+             int tag, MPI_Comm comm) {
+  double bytes = peer_bytes(dest, count, datatype);
+  sent_to(world_rank(comm, MPI_WIN_NULL, dest), bytes);
+  PROFILE(CALL_SEND, bytes,
+          PMPI_Send(buf, count, datatype, dest, tag, comm));
+}
+
+int MPI_Recv(void* buf, int count, MPI_Datatype datatype, int source, int tag,
+             MPI_Comm comm, MPI_Status* status) {
+  PROFILE(CALL_RECV, peer_bytes(source, count, datatype),
+          PMPI_Recv(buf, count, datatype, source, tag, comm, status));
+}
+
+int MPI_Sendrecv(const void* sendbuf, int sendcount, MPI_Datatype sendtype,
+                 int dest, int sendtag, void* recvbuf, int recvcount,
+                 MPI_Datatype recvtype, int source, int recvtag,
+                 MPI_Comm comm, MPI_Status* status) {
+  double bytes = peer_bytes(dest, sendcount, sendtype);
+  sent_to(world_rank(comm, MPI_WIN_NULL, dest), bytes);
+  PROFILE(CALL_SENDRECV, bytes,
+          PMPI_Sendrecv(sendbuf, sendcount, sendtype, dest, sendtag, recvbuf,
+                        recvcount, recvtype, source, recvtag, comm, status));
+}
+
+int MPI_Isend(const void* buf, int count, MPI_Datatype datatype, int dest,
+              int tag, MPI_Comm comm, MPI_Request* request) {
+  double bytes = peer_bytes(dest, count, datatype);
+  sent_to(world_rank(comm, MPI_WIN_NULL, dest), bytes);
+  PROFILE(CALL_ISEND, bytes,
+          PMPI_Isend(buf, count, datatype, dest, tag, comm, request));
+}
+
+int MPI_Irecv(void* buf, int count, MPI_Datatype datatype, int source,
+              int tag, MPI_Comm comm, MPI_Request* request) {
+  PROFILE(CALL_IRECV, peer_bytes(source, count, datatype),
+          PMPI_Irecv(buf, count, datatype, source, tag, comm, request));
+}
+
+int MPI_Wait(MPI_Request* request, MPI_Status* status) {
+  PROFILE(CALL_WAIT, 0.0, PMPI_Wait(request, status));
+}
+
+int MPI_Waitall(int count, MPI_Request array_of_requests[],
+                MPI_Status array_of_statuses[]) {
+  PROFILE(CALL_WAITALL, 0.0,
+          PMPI_Waitall(count, array_of_requests, array_of_statuses));
+}
+
+int MPI_Put(const void* origin_addr, int origin_count,
+            MPI_Datatype origin_datatype, int target_rank,
+            MPI_Aint target_disp, int target_count,
+            MPI_Datatype target_datatype, MPI_Win win) {
+  double bytes = peer_bytes(target_rank, origin_count, origin_datatype);
+  sent_to(world_rank(MPI_COMM_NULL, win, target_rank), bytes);
+  PROFILE(CALL_PUT, bytes,
+          PMPI_Put(origin_addr, origin_count, origin_datatype, target_rank,
+                   target_disp, target_count, target_datatype, win));
+}
+
+int MPI_Get(void* origin_addr, int origin_count, MPI_Datatype origin_datatype,
+            int target_rank, MPI_Aint target_disp, int target_count,
+            MPI_Datatype target_datatype, MPI_Win win) {
+  double bytes = peer_bytes(target_rank, origin_count, origin_datatype);
+  int    world = world_rank(MPI_COMM_NULL, win, target_rank);
+  if (world >= 0) {
+    msgs_from[world]++;
+    bytes_from[world] += (long) bytes;
+  }
+  PROFILE(CALL_GET, bytes,
+          PMPI_Get(origin_addr, origin_count, origin_datatype, target_rank,
+                   target_disp, target_count, target_datatype, win));
+}
+
+int MPI_Win_create(void* base, MPI_Aint size, int disp_unit, MPI_Info info,
+                   MPI_Comm comm, MPI_Win* win) {
+  PROFILE(CALL_WIN_CREATE, 0.0,
+          PMPI_Win_create(base, size, disp_unit, info, comm, win));
+}
+
+int MPI_Win_free(MPI_Win* win) {
+  forget(MPI_COMM_NULL, *win);
+  PROFILE(CALL_WIN_FREE, 0.0, PMPI_Win_free(win));
+}
+
+int MPI_Win_fence(int assert, MPI_Win win) {
+  PROFILE(CALL_WIN_FENCE, 0.0, PMPI_Win_fence(assert, win));
+}
+
+int MPI_Win_post(MPI_Group group, int assert, MPI_Win win) {
+  PROFILE(CALL_WIN_POST, 0.0, PMPI_Win_post(group, assert, win));
+}
+
+int MPI_Win_start(MPI_Group group, int assert, MPI_Win win) {
+  PROFILE(CALL_WIN_START, 0.0, PMPI_Win_start(group, assert, win));
+}
+
+int MPI_Win_complete(MPI_Win win) {
+  PROFILE(CALL_WIN_COMPLETE, 0.0, PMPI_Win_complete(win));
+}
+
+int MPI_Win_wait(MPI_Win win) {
+  PROFILE(CALL_WIN_WAIT, 0.0, PMPI_Win_wait(win));
+}
+
+int MPI_Barrier(MPI_Comm comm) {
+  PROFILE(CALL_BARRIER, 0.0, PMPI_Barrier(comm));
+}
+
+int MPI_Bcast(void* buffer, int count, MPI_Datatype datatype, int root,
+              MPI_Comm comm) {
+  PROFILE(CALL_BCAST, type_bytes(count, datatype),
+          PMPI_Bcast(buffer, count, datatype, root, comm));
+}
+
+int MPI_Reduce(const void* sendbuf, void* recvbuf, int count,
+               MPI_Datatype datatype, MPI_Op op, int root, MPI_Comm comm) {
+  PROFILE(CALL_REDUCE, type_bytes(count, datatype),
+          PMPI_Reduce(sendbuf, recvbuf, count, datatype, op, root, comm));
+}
+
+int MPI_Allreduce(const void* sendbuf, void* recvbuf, int count,
+                  MPI_Datatype datatype, MPI_Op op, MPI_Comm comm) {
+  PROFILE(CALL_ALLREDUCE, type_bytes(count, datatype),
+          PMPI_Allreduce(sendbuf, recvbuf, count, datatype, op, comm));
+}
+
+int MPI_Gather(const void* sendbuf, int sendcount, MPI_Datatype sendtype,
+               void* recvbuf, int recvcount, MPI_Datatype recvtype, int root,
+               MPI_Comm comm) {
+  PROFILE(CALL_GATHER, type_bytes(sendcount, sendtype),
+          PMPI_Gather(sendbuf, sendcount, sendtype, recvbuf, recvcount,
+                      recvtype, root, comm));
+}
+
+int MPI_Allgather(const void* sendbuf, int sendcount, MPI_Datatype sendtype,
+                  void* recvbuf, int recvcount, MPI_Datatype recvtype,
+                  MPI_Comm comm) {
+  PROFILE(CALL_ALLGATHER, type_bytes(sendcount, sendtype),
+          PMPI_Allgather(sendbuf, sendcount, sendtype, recvbuf, recvcount,
+                         recvtype, comm));
+}
+
+int MPI_Alltoallw(const void* sendbuf, const int sendcounts[],
+                  const int sdispls[], const MPI_Datatype sendtypes[],
+                  void* recvbuf, const int recvcounts[], const int rdispls[],
+                  const MPI_Datatype recvtypes[], MPI_Comm comm) {
+  int    n;
+  double bytes = 0.0;
+  PMPI_Comm_size(comm, &n);
+  for (int k = 0; k < n; k++) {
+    bytes += type_bytes(sendcounts[k], sendtypes[k]);
+  }
+  PROFILE(CALL_ALLTOALLW, bytes,
+          PMPI_Alltoallw(sendbuf, sendcounts, sdispls, sendtypes, recvbuf,
+                         recvcounts, rdispls, recvtypes, comm));
+}
+
+int MPI_Exscan(const void* sendbuf, void* recvbuf, int count,
+               MPI_Datatype datatype, MPI_Op op, MPI_Comm comm) {
+  PROFILE(CALL_EXSCAN, type_bytes(count, datatype),
+          PMPI_Exscan(sendbuf, recvbuf, count, datatype, op, comm));
+}
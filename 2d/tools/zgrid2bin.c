@@ -0,0 +1,107 @@
+/**
+ * @file  zgrid2bin.c
+ * @brief Decompresses grid files written by write_grid_compressed.
+ *
+ * Usage: zgrid2bin file.zgrid [file]. The result is written in the binary
+ * grid format to file.bin, which defaults to file.zgrid.bin so that it never
+ * replaces the uncompressed grid file of the same name; use grid2txt to turn
+ * it into text.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../include/compress.h"
+#include "../include/gridfile.h"
+
+/**
+ * @brief Main function.
+ *
+ * @param[in] argc Number of command-line arguments.
+ * @param[in] argv Command-line arguments.
+ *
+ * @returns 0 on success, non-zero on error.
+ */
+int main(int argc, char** argv) {
+  if (argc < 2 || argc > 3) {
+    fprintf(stderr, "Usage is as follows: %s file.zgrid [file]\n", argv[0]);
+    return 1;
+  }
+
+  // Default output name; file.zgrid becomes file.zgrid(.bin), as file(.bin)
+  // may hold the same grid at full precision
+  char out_filename[256];
+  snprintf(out_filename, sizeof(out_filename), "%s",
+           (argc == 3) ? argv[2] : argv[1]);
+
+  // Read the whole file
+  FILE* file = fopen(argv[1], "rb");
+  if (!file) {
+    fprintf(stderr, "Error opening file %s for reading\n", argv[1]);
+    return 1;
+  }
+  fseek(file, 0, SEEK_END);
+  long len = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  unsigned char* in = (unsigned char*) malloc(len > 0 ? len : 1);
+  if (!in) {
+    fprintf(stderr, "Memory allocation error\n");
+    return 1;
+  }
+  int bad = fread(in, 1, len, file) != (size_t) len;
+  fclose(file);
+
+  zgrid_header zhdr;
+  if (bad || (size_t) len < sizeof(zgrid_header)) {
+    bad = 1;
+  } else {
+    memcpy(&zhdr, in, sizeof(zgrid_header));
+    bad = memcmp(zhdr.magic, ZGRID_MAGIC, sizeof(ZGRID_MAGIC)) != 0 ||
+          zhdr.order != GRID_ORDER || zhdr.version != ZGRID_VERSION ||
+          zhdr.nx < 1 || zhdr.ny < 1;
+  }
+  if (bad) {
+    fprintf(stderr, "%s is not a compressed grid file\n", argv[1]);
+    free(in);
+    return 1;
+  }
+
+  // Global grid with a zero boundary; each block goes into its place
+  int nx = zhdr.nx;
+  int ny = zhdr.ny;
+  double(*g)[ny + 2] = calloc((size_t) (nx + 2) * (ny + 2), sizeof(double));
+  if (!g) {
+    fprintf(stderr, "Memory allocation error\n");
+    free(in);
+    return 1;
+  }
+  size_t pos = sizeof(zgrid_header);
+  for (int b = 0; b < zhdr.nblocks && !bad; b++) {
+    zgrid_block blk;
+    if ((size_t) len - pos < sizeof(zgrid_block)) {
+      bad = 1;
+      break;
+    }
+    memcpy(&blk, in + pos, sizeof(zgrid_block));
+    pos += sizeof(zgrid_block);
+    bad = blk.col_s < 1 || blk.row_s < 1 || blk.nx < 0 || blk.ny < 0 ||
+          blk.col_s - 1 + blk.nx > nx || blk.row_s - 1 + blk.ny > ny ||
+          blk.nbytes > (size_t) len - pos ||
+          decompress_grid(in + pos, blk.nbytes, blk.nx, blk.ny, zhdr.tol,
+                          &g[blk.col_s][blk.row_s], ny + 2) != 0;
+    pos += blk.nbytes;
+  }
+  free(in);
+  if (bad) {
+    fprintf(stderr, "%s is truncated or corrupt\n", argv[1]);
+    free(g);
+    return 1;
+  }
+
+  grid_header hdr;
+  grid_header_init(&hdr, nx, ny, 1, 1, zhdr.h, zhdr.it, zhdr.residual);
+  bad = write_grid_bin(out_filename, nx, ny, g, &hdr);
+  free(g);
+  return bad;
+}
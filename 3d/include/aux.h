@@ -0,0 +1,42 @@
+/**
+ * @file  aux.h
+ * @brief Utility functions for grid initialization.
+ */
+
+#include "poisson3d.h"
+
+/**
+ * @brief Evaluates the analytical solution of the 3D Poisson problem.
+ *
+ * The problem is set up so that u(x,y,z)=1/sqrt((1+x)^2+(1+y)^2+(1+z)^2), a
+ * point source outside the domain, solves it exactly with f = 0; this is used
+ * both for the Dirichlet boundary conditions and for checking the numerical
+ * solution.
+ *
+ * @param[in] x Physical x-coordinate.
+ * @param[in] y Physical y-coordinate.
+ * @param[in] z Physical z-coordinate.
+ *
+ * @returns The value of the analytical solution at (x, y, z).
+ */
+double analytical3d(double x, double y, double z);
+
+/**
+ * @brief Initializes the local grid portion with boundary conditions.
+ *
+ * Interior points and ghost cells are set to zero, and every ghost cell that
+ * lies on the physical boundary is set to the analytical solution. The grid
+ * spacing is h = 1/(nx+1) along every axis.
+ *
+ * @param[in]  lnx Number of local interior grid points in x-axis.
+ * @param[in]  lny Number of local interior grid points in y-axis.
+ * @param[in]  lnz Number of local interior grid points in z-axis.
+ * @param[out] a   Grid array for current solution iteration.
+ * @param[out] b   Grid array for next solution iteration.
+ * @param[out] f   Grid array for right-hand side function values.
+ * @param[in]  n   Number of global interior grid points along each axis.
+ * @param[in]  s   Starting global index of the local domain along each axis.
+ */
+void init_threed(int lnx, int lny, int lnz, double a[][lny + 2][lnz + 2],
+                 double b[][lny + 2][lnz + 2], double f[][lny + 2][lnz + 2],
+                 int* n, int* s);
@@ -0,0 +1,132 @@
+/**
+ * @file  jacobi.h
+ * @brief Jacobi iteration functions for the 3D problem.
+ *
+ * The six faces of a local block are numbered d = 2 * axis + side, where axis
+ * is 0, 1 or 2 for x, y or z, and side is 0 for the neighbor at the lower end
+ * of that axis and 1 for the neighbor at the upper end. All neighbor ranks and
+ * face datatypes are passed as arrays of six entries in this order.
+ */
+
+#include "poisson3d.h"
+
+/**
+ * @brief Creates the MPI datatypes describing the faces of a local block.
+ *
+ * All faces are described with MPI_Type_create_subarray relative to the start
+ * of the local array. The x-faces cover the whole (lny + 2) x (lnz + 2) plane
+ * and are therefore contiguous in memory, whereas the y- and z-faces only
+ * cover the interior and are strided.
+ *
+ * @param[in]  lsize      Local interior size along each axis.
+ * @param[in]  nbr_lsize  Local interior size of the neighbor across each face;
+ *                        only used for get_types.
+ * @param[out] send_types Interior layer next to each face, to be sent.
+ * @param[out] recv_types Ghost layer on each face, to be received into.
+ * @param[out] get_types  Interior layer of the neighbor across each face, in
+ *                        the neighbor's memory layout, for use with MPI_Get.
+ */
+void create_face_types3d(int* lsize, int nbr_lsize[][3],
+                         MPI_Datatype* send_types, MPI_Datatype* recv_types,
+                         MPI_Datatype* get_types);
+
+/**
+ * @brief Frees the datatypes created by create_face_types3d.
+ *
+ * @param[in,out] send_types Interior layer next to each face.
+ * @param[in,out] recv_types Ghost layer on each face.
+ * @param[in,out] get_types  Interior layer of the neighbor across each face.
+ */
+void free_face_types3d(MPI_Datatype* send_types, MPI_Datatype* recv_types,
+                       MPI_Datatype* get_types);
+
+/**
+ * @brief Exchanges ghost cells with neighboring processes using blocking
+ *        communication.
+ *
+ * Performs the exchange one axis at a time with a pair of MPI_Sendrecv calls
+ * per axis.
+ *
+ * @param[in,out] x          Grid array to exchange ghost cells for.
+ * @param[in]     comm       MPI communicator.
+ * @param[in]     nbrs       Ranks of the six neighboring processes.
+ * @param[in]     send_types Interior layer next to each face.
+ * @param[in]     recv_types Ghost layer on each face.
+ */
+void exchang3d_1(double* x, MPI_Comm comm, int* nbrs, MPI_Datatype* send_types,
+                 MPI_Datatype* recv_types);
+
+/**
+ * @brief Exchanges ghost cells with neighboring processes using non-blocking
+ *        communication.
+ *
+ * Posts all six MPI_Irecv calls followed by all six MPI_Isend calls and waits
+ * for them to complete.
+ *
+ * @param[in,out] x          Grid array to exchange ghost cells for.
+ * @param[in]     comm       MPI communicator.
+ * @param[in]     nbrs       Ranks of the six neighboring processes.
+ * @param[in]     send_types Interior layer next to each face.
+ * @param[in]     recv_types Ghost layer on each face.
+ */
+void exchang3d_nb(double* x, MPI_Comm comm, int* nbrs,
+                  MPI_Datatype* send_types, MPI_Datatype* recv_types);
+
+/**
+ * @brief Exchanges ghost cells with neighboring processes using RMA with
+ *        MPI_Win_fence synchronization.
+ *
+ * @param[in,out] x          Grid array exposed by win.
+ * @param[in]     nbrs       Ranks of the six neighboring processes.
+ * @param[in]     recv_types Ghost layer on each face.
+ * @param[in]     get_types  Interior layer of the neighbor across each face.
+ * @param[in]     win        MPI window object exposing the grid array.
+ */
+void exchang3d_rma_fence(double* x, int* nbrs, MPI_Datatype* recv_types,
+                         MPI_Datatype* get_types, MPI_Win win);
+
+/**
+ * @brief Exchanges ghost cells with neighboring processes using RMA with
+ *        general active target (post-start-complete-wait) synchronization.
+ *
+ * @param[in,out] x          Grid array exposed by win.
+ * @param[in]     nbrs       Ranks of the six neighboring processes.
+ * @param[in]     recv_types Ghost layer on each face.
+ * @param[in]     get_types  Interior layer of the neighbor across each face.
+ * @param[in]     win        MPI window object exposing the grid array.
+ * @param[in]     group      MPI group of the communicator used for win.
+ */
+void exchang3d_rma_pscw(double* x, int* nbrs, MPI_Datatype* recv_types,
+                        MPI_Datatype* get_types, MPI_Win win, MPI_Group group);
+
+/**
+ * @brief Calculates the squared difference between two grid arrays.
+ *
+ * @param[in] lnx Number of local interior grid points in x-axis.
+ * @param[in] lny Number of local interior grid points in y-axis.
+ * @param[in] lnz Number of local interior grid points in z-axis.
+ * @param[in] a   First grid array.
+ * @param[in] b   Second grid array.
+ *
+ * @returns Sum of squared differences between the two grid arrays.
+ */
+double griddiff3d(int lnx, int lny, int lnz, double a[][lny + 2][lnz + 2],
+                  double b[][lny + 2][lnz + 2]);
+
+/**
+ * @brief Performs one Jacobi iteration step.
+ *
+ * For each point, computes the average of its six neighbors, adjusted by the
+ * right-hand side function values, i.e., the 7-point stencil.
+ *
+ * @param[in]  lnx Number of local interior grid points in x-axis.
+ * @param[in]  lny Number of local interior grid points in y-axis.
+ * @param[in]  lnz Number of local interior grid points in z-axis.
+ * @param[in]  a   Current iteration grid array.
+ * @param[in]  f   Right-hand side function values.
+ * @param[in]  h   Grid spacing.
+ * @param[out] b   Next iteration grid array to store the updated values.
+ */
+void sweep3d(int lnx, int lny, int lnz, double a[][lny + 2][lnz + 2],
+             double f[][lny + 2][lnz + 2], double h,
+             double b[][lny + 2][lnz + 2]);
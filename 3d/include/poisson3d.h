@@ -0,0 +1,11 @@
+/**
+ * @file  poisson3d.h
+ * @brief Header defining default grid dimensions.
+ *
+ * Grids are stored per process as (lnx + 2) x (lny + 2) x (lnz + 2) arrays,
+ * i.e., the local interior plus one layer of ghost cells on each face. The
+ * indices are [x][y][z], so that z-lines are contiguous in memory and whole
+ * x-planes are contiguous as well.
+ */
+
+#define default_n 31
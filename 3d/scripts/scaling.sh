@@ -0,0 +1,95 @@
+#!/bin/bash
+#
+# Strong- and weak-scaling benchmarks for the 3D solver on a single node.
+#
+# Usage: ./scripts/scaling.sh strong|weak
+#
+# Strong scaling keeps the global grid fixed at N^3 while the number of
+# processes grows; weak scaling keeps roughly N^3 points per process. Every
+# run does a fixed number of iterations (convergence is disabled with -t 0)
+# and the results are appended to scaling-<mode>.csv. The following variables
+# can be overridden from the environment:
+#
+#   NPROCS    Process counts to run         (default "1 2 4 8")
+#   N         Grid points per axis          (default 512 strong, 128 weak)
+#   ITERS     Iterations per run            (default 20)
+#   EXCHANGES Exchange strategies to run    (default "blocking nb fence pscw")
+#   MPIRUN    Launcher                      (default "mpirun")
+
+set -e
+
+mode=${1:-strong}
+if [ "$mode" != "strong" ] && [ "$mode" != "weak" ]; then
+  echo "Usage: $0 strong|weak" >&2
+  exit 1
+fi
+
+NPROCS=${NPROCS:-"1 2 4 8"}
+ITERS=${ITERS:-20}
+EXCHANGES=${EXCHANGES:-"blocking nb fence pscw"}
+MPIRUN=${MPIRUN:-mpirun}
+if [ "$mode" = "strong" ]; then
+  N=${N:-512}
+else
+  N=${N:-128}
+fi
+
+# Process grid of np processes over nd axes, largest first: every prime
+# factor of np in turn goes to the axis with the fewest processes
+proc_grid() {
+  awk -v np="$1" -v nd="$2" 'BEGIN {
+    for (i = 1; i <= nd; i++) d[i] = 1
+    p = np
+    for (f = 2; p > 1; f++) {
+      while (p % f == 0) {
+        m = 1
+        for (i = 2; i <= nd; i++) if (d[i] < d[m]) m = i
+        d[m] *= f
+        p /= f
+      }
+    }
+    for (i = 1; i <= nd; i++)
+      for (j = i + 1; j <= nd; j++)
+        if (d[j] > d[i]) { t = d[i]; d[i] = d[j]; d[j] = t }
+    s = d[1]
+    for (i = 2; i <= nd; i++) s = s " " d[i]
+    print s
+  }'
+}
+
+out="scaling-$mode.csv"
+echo "mode,exchange,nprocs,nx,ny,nz,iterations,time,time_per_iteration,efficiency" > "$out"
+
+for exch in $EXCHANGES; do
+  base=""
+  for np in $NPROCS; do
+
+    # For weak scaling, grow the global grid with the process grid chosen by
+    # MPI_Dims_create so that every process keeps about N^3 points
+    if [ "$mode" = "weak" ]; then
+      read -r px py pz <<< "$(proc_grid "$np" 3)"
+      nx=$((N * px)); ny=$((N * py)); nz=$((N * pz))
+    else
+      nx=$N; ny=$N; nz=$N
+    fi
+
+    log=$($MPIRUN -np "$np" ./bin/main -e "$exch" -i "$ITERS" -t 0 \
+          "$nx" "$ny" "$nz")
+    time=$(echo "$log" | awk '/Solver completed in/ {print $4}')
+    tpi=$(echo "$log" | awk '/Time per iteration/ {print $4}')
+
+    # Parallel efficiency relative to the first process count
+    if [ -z "$base" ]; then
+      base=$tpi
+      base_np=$np
+    fi
+    if [ "$mode" = "strong" ]; then
+      eff=$(awk -v b="$base" -v t="$tpi" -v p0="$base_np" -v p="$np" \
+            'BEGIN {printf "%.3f", (b * p0) / (t * p)}')
+    else
+      eff=$(awk -v b="$base" -v t="$tpi" 'BEGIN {printf "%.3f", b / t}')
+    fi
+
+    echo "$mode,$exch,$np,$nx,$ny,$nz,$ITERS,$time,$tpi,$eff" | tee -a "$out"
+  done
+done
@@ -0,0 +1,73 @@
+/**
+ * @file  aux.c
+ * @brief Implementation of utility functions for grid initialization.
+ */
+
+#include <math.h>
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../include/aux.h"
+#include "../include/poisson3d.h"
+
+/**
+ * @brief Evaluates the analytical solution of the 3D Poisson problem.
+ *
+ * The problem is set up so that u(x,y,z)=1/sqrt((1+x)^2+(1+y)^2+(1+z)^2), a
+ * point source outside the domain, solves it exactly with f = 0; this is used
+ * both for the Dirichlet boundary conditions and for checking the numerical
+ * solution.
+ *
+ * @param[in] x Physical x-coordinate.
+ * @param[in] y Physical y-coordinate.
+ * @param[in] z Physical z-coordinate.
+ *
+ * @returns The value of the analytical solution at (x, y, z).
+ */
+double analytical3d(double x, double y, double z) {
+  return 1.0 / sqrt((1.0 + x) * (1.0 + x) + (1.0 + y) * (1.0 + y) +
+                    (1.0 + z) * (1.0 + z));
+}
+
+/**
+ * @brief Initializes the local grid portion with boundary conditions.
+ *
+ * Interior points and ghost cells are set to zero, and every ghost cell that
+ * lies on the physical boundary is set to the analytical solution. The grid
+ * spacing is h = 1/(nx+1) along every axis.
+ *
+ * @param[in]  lnx Number of local interior grid points in x-axis.
+ * @param[in]  lny Number of local interior grid points in y-axis.
+ * @param[in]  lnz Number of local interior grid points in z-axis.
+ * @param[out] a   Grid array for current solution iteration.
+ * @param[out] b   Grid array for next solution iteration.
+ * @param[out] f   Grid array for right-hand side function values.
+ * @param[in]  n   Number of global interior grid points along each axis.
+ * @param[in]  s   Starting global index of the local domain along each axis.
+ */
+void init_threed(int lnx, int lny, int lnz, double a[][lny + 2][lnz + 2],
+                 double b[][lny + 2][lnz + 2], double f[][lny + 2][lnz + 2],
+                 int* n, int* s) {
+  double h = 1.0 / ((double) (n[0] + 1)); // Grid spacing
+
+  for (int i = 0; i <= lnx + 1; i++) {
+    int gi = s[0] - 1 + i; // Global indices of this cell
+    for (int j = 0; j <= lny + 1; j++) {
+      int gj = s[1] - 1 + j;
+      for (int k = 0; k <= lnz + 1; k++) {
+        int gk     = s[2] - 1 + k;
+        a[i][j][k] = 0.0;
+        b[i][j][k] = 0.0;
+        f[i][j][k] = 0.0;
+
+        // Dirichlet boundary conditions on the faces of the domain
+        if (gi == 0 || gi == n[0] + 1 || gj == 0 || gj == n[1] + 1 ||
+            gk == 0 || gk == n[2] + 1) {
+          a[i][j][k] = analytical3d(gi * h, gj * h, gk * h);
+          b[i][j][k] = a[i][j][k];
+        }
+      }
+    }
+  }
+}
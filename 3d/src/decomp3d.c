@@ -0,0 +1,57 @@
+/**
+ * @file  decomp3d.c
+ * @brief Implementation of the 3D domain decomposition utility.
+ */
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../include/decomp3d.h"
+
+/**
+ * @brief Calculates a 1D block decomposition.
+ *
+ * Divides n elements as evenly as possible among size processes, giving one
+ * extra element to the first n % size processes.
+ *
+ * @param[in]  n    Total number of elements.
+ * @param[in]  size Number of processes.
+ * @param[in]  rank Position of this process (0 to size - 1).
+ * @param[out] s    Pointer to store the starting index (1-based).
+ * @param[out] e    Pointer to store the ending index (1-based).
+ *
+ * @returns MPI_SUCCESS on successful completion.
+ */
+int MPE_Decomp1d(int n, int size, int rank, int* s, int* e) {
+  int nlocal  = n / size;
+  int deficit = n % size;
+  *s          = rank * nlocal + ((rank < deficit) ? rank : deficit) + 1;
+  if (rank < deficit)
+    nlocal++;
+  *e = *s + nlocal - 1;
+  if (*e > n || rank == size - 1)
+    *e = n;
+  return MPI_SUCCESS;
+}
+
+/**
+ * @brief Calculates 3D domain decomposition for an MPI process.
+ *
+ * Applies MPE_Decomp1d to each axis independently, using the process's
+ * coordinates in the 3D process grid.
+ *
+ * @param[in]  n      Number of interior grid points along each axis.
+ * @param[in]  coords Coordinates of the process in the 3D process grid.
+ * @param[in]  dims   Dimensions of the 3D process grid.
+ * @param[out] s      Starting index along each axis.
+ * @param[out] e      Ending index along each axis.
+ *
+ * @returns MPI_SUCCESS on successful completion.
+ */
+int MPE_Decomp3d(int* n, int* coords, int* dims, int* s, int* e) {
+  for (int d = 0; d < 3; d++) {
+    MPE_Decomp1d(n[d], dims[d], coords[d], &s[d], &e[d]);
+  }
+  return MPI_SUCCESS;
+}
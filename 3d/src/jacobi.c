@@ -0,0 +1,280 @@
+/**
+ * @file  jacobi.c
+ * @brief Implementation of Jacobi iteration functions for the 3D problem.
+ */
+
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../include/jacobi.h"
+#include "../include/poisson3d.h"
+
+/**
+ * @brief Creates the MPI datatypes describing the faces of a local block.
+ *
+ * All faces are described with MPI_Type_create_subarray relative to the start
+ * of the local array. The x-faces cover the whole (lny + 2) x (lnz + 2) plane
+ * and are therefore contiguous in memory, whereas the y- and z-faces only
+ * cover the interior and are strided.
+ *
+ * @param[in]  lsize      Local interior size along each axis.
+ * @param[in]  nbr_lsize  Local interior size of the neighbor across each face;
+ *                        only used for get_types.
+ * @param[out] send_types Interior layer next to each face, to be sent.
+ * @param[out] recv_types Ghost layer on each face, to be received into.
+ * @param[out] get_types  Interior layer of the neighbor across each face, in
+ *                        the neighbor's memory layout, for use with MPI_Get.
+ */
+void create_face_types3d(int* lsize, int nbr_lsize[][3],
+                         MPI_Datatype* send_types, MPI_Datatype* recv_types,
+                         MPI_Datatype* get_types) {
+  int sizes[3]    = {lsize[0] + 2, lsize[1] + 2, lsize[2] + 2};
+  int subsizes[3] = {0, 0, 0};
+  int starts[3]   = {0, 0, 0};
+
+  for (int d = 0; d < 6; d++) {
+    int axis = d / 2;
+    int side = d % 2;
+
+    // Extent across the face; the x-faces take the whole plane so that they
+    // are one contiguous block, the others only the interior
+    for (int k = 0; k < 3; k++) {
+      subsizes[k] = (axis == 0) ? lsize[k] + 2 : lsize[k];
+      starts[k]   = (axis == 0) ? 0 : 1;
+    }
+    subsizes[axis] = 1;
+
+    // Interior layer next to the face
+    starts[axis] = side ? lsize[axis] : 1;
+    MPI_Type_create_subarray(3, sizes, subsizes, starts, MPI_ORDER_C,
+                             MPI_DOUBLE, &send_types[d]);
+    MPI_Type_commit(&send_types[d]);
+
+    // Ghost layer on the face
+    starts[axis] = side ? lsize[axis] + 1 : 0;
+    MPI_Type_create_subarray(3, sizes, subsizes, starts, MPI_ORDER_C,
+                             MPI_DOUBLE, &recv_types[d]);
+    MPI_Type_commit(&recv_types[d]);
+
+    // The neighbor's interior layer on the opposite side of its block; its
+    // array only differs from ours in the extent along the exchange axis
+    int nbr_sizes[3] = {sizes[0], sizes[1], sizes[2]};
+    nbr_sizes[axis]  = nbr_lsize[d][axis] + 2;
+    starts[axis]     = side ? 1 : nbr_lsize[d][axis];
+    MPI_Type_create_subarray(3, nbr_sizes, subsizes, starts, MPI_ORDER_C,
+                             MPI_DOUBLE, &get_types[d]);
+    MPI_Type_commit(&get_types[d]);
+  }
+}
+
+/**
+ * @brief Frees the datatypes created by create_face_types3d.
+ *
+ * @param[in,out] send_types Interior layer next to each face.
+ * @param[in,out] recv_types Ghost layer on each face.
+ * @param[in,out] get_types  Interior layer of the neighbor across each face.
+ */
+void free_face_types3d(MPI_Datatype* send_types, MPI_Datatype* recv_types,
+                       MPI_Datatype* get_types) {
+  for (int d = 0; d < 6; d++) {
+    MPI_Type_free(&send_types[d]);
+    MPI_Type_free(&recv_types[d]);
+    MPI_Type_free(&get_types[d]);
+  }
+}
+
+/**
+ * @brief Exchanges ghost cells with neighboring processes using blocking
+ *        communication.
+ *
+ * Performs the exchange one axis at a time with a pair of MPI_Sendrecv calls
+ * per axis.
+ *
+ * @param[in,out] x          Grid array to exchange ghost cells for.
+ * @param[in]     comm       MPI communicator.
+ * @param[in]     nbrs       Ranks of the six neighboring processes.
+ * @param[in]     send_types Interior layer next to each face.
+ * @param[in]     recv_types Ghost layer on each face.
+ */
+void exchang3d_1(double* x, MPI_Comm comm, int* nbrs, MPI_Datatype* send_types,
+                 MPI_Datatype* recv_types) {
+  for (int axis = 0; axis < 3; axis++) {
+    int lo = 2 * axis; // Face towards the lower neighbor
+    int hi = lo + 1;   // Face towards the upper neighbor
+
+    // Sends the upper interior layer to the upper neighbor and simultaneously
+    // receives the lower ghost layer from the lower neighbor
+    MPI_Sendrecv(x, 1, send_types[hi], nbrs[hi], hi, x, 1, recv_types[lo],
+                 nbrs[lo], hi, comm, MPI_STATUS_IGNORE);
+
+    // Sends the lower interior layer to the lower neighbor and simultaneously
+    // receives the upper ghost layer from the upper neighbor
+    MPI_Sendrecv(x, 1, send_types[lo], nbrs[lo], lo, x, 1, recv_types[hi],
+                 nbrs[hi], lo, comm, MPI_STATUS_IGNORE);
+  }
+}
+
+/**
+ * @brief Exchanges ghost cells with neighboring processes using non-blocking
+ *        communication.
+ *
+ * Posts all six MPI_Irecv calls followed by all six MPI_Isend calls and waits
+ * for them to complete.
+ *
+ * @param[in,out] x          Grid array to exchange ghost cells for.
+ * @param[in]     comm       MPI communicator.
+ * @param[in]     nbrs       Ranks of the six neighboring processes.
+ * @param[in]     send_types Interior layer next to each face.
+ * @param[in]     recv_types Ghost layer on each face.
+ */
+void exchang3d_nb(double* x, MPI_Comm comm, int* nbrs,
+                  MPI_Datatype* send_types, MPI_Datatype* recv_types) {
+  MPI_Request reqs[12]; // Array to hold twelve MPI request handles
+
+  // Receive each ghost layer; the tag is the direction in which the neighbor
+  // sent it, which is the opposite of the face it arrives on
+  for (int d = 0; d < 6; d++) {
+    MPI_Irecv(x, 1, recv_types[d], nbrs[d], d ^ 1, comm, &reqs[d]);
+  }
+
+  // Send each interior layer to the neighbor across that face
+  for (int d = 0; d < 6; d++) {
+    MPI_Isend(x, 1, send_types[d], nbrs[d], d, comm, &reqs[6 + d]);
+  }
+
+  // Wait for all communications to complete
+  MPI_Waitall(12, reqs, MPI_STATUSES_IGNORE);
+}
+
+/**
+ * @brief Exchanges ghost cells with neighboring processes using RMA with
+ *        MPI_Win_fence synchronization.
+ *
+ * @param[in,out] x          Grid array exposed by win.
+ * @param[in]     nbrs       Ranks of the six neighboring processes.
+ * @param[in]     recv_types Ghost layer on each face.
+ * @param[in]     get_types  Interior layer of the neighbor across each face.
+ * @param[in]     win        MPI window object exposing the grid array.
+ */
+void exchang3d_rma_fence(double* x, int* nbrs, MPI_Datatype* recv_types,
+                         MPI_Datatype* get_types, MPI_Win win) {
+
+  // Start the RMA access epoch
+  MPI_Win_fence(0, win);
+
+  // Get the neighbor's interior layer into our ghost layer on each face; both
+  // datatypes already carry their offsets, so the displacement is zero
+  for (int d = 0; d < 6; d++) {
+    if (nbrs[d] != MPI_PROC_NULL) {
+      MPI_Get(x, 1, recv_types[d], nbrs[d], 0, 1, get_types[d], win);
+    }
+  }
+
+  // End the RMA access epoch
+  MPI_Win_fence(0, win);
+}
+
+/**
+ * @brief Exchanges ghost cells with neighboring processes using RMA with
+ *        general active target (post-start-complete-wait) synchronization.
+ *
+ * @param[in,out] x          Grid array exposed by win.
+ * @param[in]     nbrs       Ranks of the six neighboring processes.
+ * @param[in]     recv_types Ghost layer on each face.
+ * @param[in]     get_types  Interior layer of the neighbor across each face.
+ * @param[in]     win        MPI window object exposing the grid array.
+ * @param[in]     group      MPI group of the communicator used for win.
+ */
+void exchang3d_rma_pscw(double* x, int* nbrs, MPI_Datatype* recv_types,
+                        MPI_Datatype* get_types, MPI_Win win, MPI_Group group) {
+  int neighbors[6];      // Processes we read from, which also read from us
+  int num_neighbors = 0; // Counter for neighbors
+
+  // Build the list of neighbors; with non-periodic boundaries no rank appears
+  // twice
+  for (int d = 0; d < 6; d++) {
+    if (nbrs[d] != MPI_PROC_NULL) {
+      neighbors[num_neighbors++] = nbrs[d];
+    }
+  }
+  if (num_neighbors == 0) {
+    return;
+  }
+
+  // The access and exposure groups are the same
+  MPI_Group nbr_group;
+  MPI_Group_incl(group, num_neighbors, neighbors, &nbr_group);
+
+  // Post our window for exposure and start our access epoch
+  MPI_Win_post(nbr_group, 0, win);
+  MPI_Win_start(nbr_group, 0, win);
+
+  // Get the neighbor's interior layer into our ghost layer on each face
+  for (int d = 0; d < 6; d++) {
+    if (nbrs[d] != MPI_PROC_NULL) {
+      MPI_Get(x, 1, recv_types[d], nbrs[d], 0, 1, get_types[d], win);
+    }
+  }
+
+  // Complete our access epoch and wait for our exposure to complete
+  MPI_Win_complete(win);
+  MPI_Win_wait(win);
+
+  MPI_Group_free(&nbr_group);
+}
+
+/**
+ * @brief Calculates the squared difference between two grid arrays.
+ *
+ * @param[in] lnx Number of local interior grid points in x-axis.
+ * @param[in] lny Number of local interior grid points in y-axis.
+ * @param[in] lnz Number of local interior grid points in z-axis.
+ * @param[in] a   First grid array.
+ * @param[in] b   Second grid array.
+ *
+ * @returns Sum of squared differences between the two grid arrays.
+ */
+double griddiff3d(int lnx, int lny, int lnz, double a[][lny + 2][lnz + 2],
+                  double b[][lny + 2][lnz + 2]) {
+  double sum = 0.0;
+  double tmp;
+  for (int i = 1; i <= lnx; i++) {
+    for (int j = 1; j <= lny; j++) {
+      for (int k = 1; k <= lnz; k++) {
+        tmp = (a[i][j][k] - b[i][j][k]);
+        sum = sum + tmp * tmp;
+      }
+    }
+  }
+  return sum;
+}
+
+/**
+ * @brief Performs one Jacobi iteration step.
+ *
+ * For each point, computes the average of its six neighbors, adjusted by the
+ * right-hand side function values, i.e., the 7-point stencil.
+ *
+ * @param[in]  lnx Number of local interior grid points in x-axis.
+ * @param[in]  lny Number of local interior grid points in y-axis.
+ * @param[in]  lnz Number of local interior grid points in z-axis.
+ * @param[in]  a   Current iteration grid array.
+ * @param[in]  f   Right-hand side function values.
+ * @param[in]  h   Grid spacing.
+ * @param[out] b   Next iteration grid array to store the updated values.
+ */
+void sweep3d(int lnx, int lny, int lnz, double a[][lny + 2][lnz + 2],
+             double f[][lny + 2][lnz + 2], double h,
+             double b[][lny + 2][lnz + 2]) {
+  for (int i = 1; i <= lnx; i++) {
+    for (int j = 1; j <= lny; j++) {
+      for (int k = 1; k <= lnz; k++) {
+        b[i][j][k] = (a[i - 1][j][k] + a[i + 1][j][k] + a[i][j - 1][k] +
+                      a[i][j + 1][k] + a[i][j][k - 1] + a[i][j][k + 1] -
+                      h * h * f[i][j][k]) /
+                     6.0;
+      }
+    }
+  }
+}
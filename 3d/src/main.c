@@ -0,0 +1,288 @@
+/**
+ * @file main.c
+ */
+
+#include <math.h>
+#include <mpi.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../include/aux.h"
+#include "../include/decomp3d.h"
+#include "../include/jacobi.h"
+#include "../include/poisson3d.h"
+
+#define maxit 2000
+
+/**
+ * @brief Ghost cell exchange strategies which can be selected with -e.
+ */
+enum exchange { EXCH_BLOCKING, EXCH_NB, EXCH_FENCE, EXCH_PSCW };
+
+/**
+ * @brief Main function.
+ *
+ * Usage: mpirun -np nprocs main [-e blocking|nb|fence|pscw] [-i maxit]
+ *        [-t tol] [nx [ny [nz]]]
+ *
+ * @param[in] argc Number of command-line arguments.
+ * @param[in] argv Command-line arguments.
+ *
+ * @returns 0 on success, non-zero on error.
+ */
+int main(int argc, char** argv) {
+
+  // Problem size
+  int n[3];     // Global size along each axis; interior points only
+  int s[3];     // Starting global index of the local domain along each axis
+  int e[3];     // Ending global index of the local domain along each axis
+  int lsize[3]; // Size of the local domain; interior points only
+
+  // MPI process information
+  int myid, nprocs; // Process rank and number of processes
+
+  // Iteration and convergence
+  int    it;            // Iteration counter
+  double glob_diff;     // Global differences between iterations
+  double ldiff;         // Local difference on the respective process
+  double tol   = 1.0E-11; // Convergence tolerance
+  int    niter = maxit;   // Maximum number of iterations
+
+  // Ghost cell exchange strategy
+  enum exchange    exch        = EXCH_NB;
+  const char*      exch_name[] = {"blocking", "nb", "fence", "pscw"};
+
+  double t1, t2; // Timing
+
+  // Initialise the MPI environment
+  MPI_Init(&argc, &argv);
+  MPI_Comm_rank(MPI_COMM_WORLD, &myid);
+  MPI_Comm_size(MPI_COMM_WORLD, &nprocs);
+
+  // Process the command-line arguments; every process parses them so that no
+  // broadcast is needed
+  int opt;
+  int bad = 0;
+  while ((opt = getopt(argc, argv, "e:i:t:")) != -1) {
+    switch (opt) {
+      case 'e':
+        bad = 1;
+        for (int k = 0; k < 4; k++) {
+          if (strcmp(optarg, exch_name[k]) == 0) {
+            exch = (enum exchange) k;
+            bad  = 0;
+          }
+        }
+        break;
+      case 'i': niter = atoi(optarg); break;
+      case 't': tol = atof(optarg); break;
+      default: bad = 1;
+    }
+  }
+  n[0] = (optind < argc) ? atoi(argv[optind]) : default_n;
+  n[1] = (optind + 1 < argc) ? atoi(argv[optind + 1]) : n[0];
+  n[2] = (optind + 2 < argc) ? atoi(argv[optind + 2]) : n[1];
+  if (bad || argc - optind > 3 || n[0] < 1 || n[1] < 1 || n[2] < 1) {
+    if (myid == 0) {
+      fprintf(stderr,
+              "Usage is as follows: mpirun -np nprocs %s "
+              "[-e blocking|nb|fence|pscw] [-i maxit] [-t tol] "
+              "[nx [ny [nz]]]\n",
+              argv[0]);
+    }
+    MPI_Abort(MPI_COMM_WORLD, 1);
+  }
+
+  // Programme header
+  if (myid == 0) {
+    printf("\n=======================================================\n");
+    printf("                   3D Implementation                   \n");
+    printf("=======================================================\n\n");
+    printf("Solving the Poisson equation on a %d x %d x %d grid with %d "
+           "processors\n",
+           n[0], n[1], n[2], nprocs);
+    printf("Ghost cells are exchanged using %s\n", exch_name[exch]);
+  }
+
+  // Create the 3D Cartesian communicator
+  int      dims[3]    = {0, 0, 0}; // Let MPI_Dims_create choose the grid
+  int      periods[3] = {0, 0, 0}; // Non-periodic boundaries
+  int      reorder    = 1;         // Allow MPI to reorder process ranks
+  int      cart_rank;              // Process rank in cart_comm
+  int      coords[3];              // Coordinates in the process grid
+  MPI_Comm cart_comm;
+  MPI_Dims_create(nprocs, 3, dims);
+  MPI_Cart_create(MPI_COMM_WORLD, 3, dims, periods, reorder, &cart_comm);
+  MPI_Comm_rank(cart_comm, &cart_rank);
+  MPI_Cart_coords(cart_comm, cart_rank, 3, coords);
+
+  // Find the neighbouring processes across each of the six faces, ordered as
+  // (x-, x+, y-, y+, z-, z+)
+  int nbrs[6];
+  for (int axis = 0; axis < 3; axis++) {
+    MPI_Cart_shift(cart_comm, axis, 1, &nbrs[2 * axis], &nbrs[2 * axis + 1]);
+  }
+
+  // Compute local domain bounds, and those of each neighbour which are needed
+  // to address their memory with RMA
+  MPE_Decomp3d(n, coords, dims, s, e);
+  for (int axis = 0; axis < 3; axis++) {
+    lsize[axis] = e[axis] - s[axis] + 1;
+  }
+  int nbr_lsize[6][3];
+  for (int d = 0; d < 6; d++) {
+    int nbr_coords[3] = {coords[0], coords[1], coords[2]};
+    int nbr_s[3], nbr_e[3];
+    nbr_coords[d / 2] += (d % 2) ? 1 : -1;
+    if (nbrs[d] == MPI_PROC_NULL) {
+      nbr_coords[d / 2] = coords[d / 2]; // Unused, but keep it in range
+    }
+    MPE_Decomp3d(n, nbr_coords, dims, nbr_s, nbr_e);
+    for (int axis = 0; axis < 3; axis++) {
+      nbr_lsize[d][axis] = nbr_e[axis] - nbr_s[axis] + 1;
+    }
+  }
+  int lnx = lsize[0];
+  int lny = lsize[1];
+  int lnz = lsize[2];
+
+  if (cart_rank == 0) {
+    printf("Process grid is %d x %d x %d\n", dims[0], dims[1], dims[2]);
+  }
+
+  // Solution storage arrays; these only cover the local domain plus ghost
+  // cells
+  size_t bytes = sizeof(double[lnx + 2][lny + 2][lnz + 2]);
+  double(*a)[lny + 2][lnz + 2] = malloc(bytes); // Current solution grid
+  double(*b)[lny + 2][lnz + 2] = malloc(bytes); // Next iteration grid
+  double(*f)[lny + 2][lnz + 2] = malloc(bytes); // Right-hand side
+  if (!a || !b || !f) {
+    fprintf(stderr, "Memory allocation error\n");
+    MPI_Abort(cart_comm, 1);
+  }
+
+  // Initialise grid with boundary conditions
+  init_threed(lnx, lny, lnz, a, b, f, n, s);
+
+  // Create the subarray datatypes for the six faces
+  MPI_Datatype send_types[6], recv_types[6], get_types[6];
+  create_face_types3d(lsize, nbr_lsize, send_types, recv_types, get_types);
+
+  // Windows are only needed by the RMA exchanges
+  MPI_Win   win_a = MPI_WIN_NULL, win_b = MPI_WIN_NULL;
+  MPI_Group cart_group;
+  MPI_Comm_group(cart_comm, &cart_group);
+  if (exch == EXCH_FENCE || exch == EXCH_PSCW) {
+    MPI_Win_create(a, bytes, sizeof(double), MPI_INFO_NULL, cart_comm, &win_a);
+    MPI_Win_create(b, bytes, sizeof(double), MPI_INFO_NULL, cart_comm, &win_b);
+  }
+
+  // Start timing
+  if (cart_rank == 0) {
+    printf("\nStarting iterative solver\n");
+  }
+  MPI_Barrier(cart_comm);
+  t1 = MPI_Wtime();
+
+  // Main iteration loop
+  double h  = 1.0 / ((double) (n[0] + 1)); // Grid spacing
+  glob_diff = 1000;
+  for (it = 0; it < niter; it++) {
+    for (int half = 0; half < 2; half++) {
+      double(*x)[lny + 2][lnz + 2] = half ? b : a; // Grid to exchange
+      double(*y)[lny + 2][lnz + 2] = half ? a : b; // Grid to update
+      switch (exch) {
+        case EXCH_BLOCKING:
+          exchang3d_1(&x[0][0][0], cart_comm, nbrs, send_types, recv_types);
+          break;
+        case EXCH_NB:
+          exchang3d_nb(&x[0][0][0], cart_comm, nbrs, send_types, recv_types);
+          break;
+        case EXCH_FENCE:
+          exchang3d_rma_fence(&x[0][0][0], nbrs, recv_types, get_types,
+                              half ? win_b : win_a);
+          break;
+        case EXCH_PSCW:
+          exchang3d_rma_pscw(&x[0][0][0], nbrs, recv_types, get_types,
+                             half ? win_b : win_a, cart_group);
+          break;
+      }
+      sweep3d(lnx, lny, lnz, x, f, h, y);
+    }
+
+    // Check for convergence
+    ldiff = griddiff3d(lnx, lny, lnz, a, b);
+    MPI_Allreduce(&ldiff, &glob_diff, 1, MPI_DOUBLE, MPI_SUM, cart_comm);
+
+    // Print progress every 100 iterations
+    if (cart_rank == 0 && (it % 100 == 0 || glob_diff < tol)) {
+      printf("Iteration %4d: Global difference = %.6e\n", it, glob_diff);
+    }
+
+    // Break if convergence criteria is satisfied
+    if (glob_diff < tol) {
+      if (cart_rank == 0) {
+        printf("\nConverged after %d iterations\n", it + 1);
+      }
+      it++;
+      break;
+    }
+  }
+
+  // Stop timing and report performance
+  t2 = MPI_Wtime();
+  if (cart_rank == 0) {
+    if (glob_diff >= tol) {
+      printf("Maximum iterations reached without convergence\n");
+    }
+    printf("Solver completed in %.6f seconds\n", t2 - t1);
+    printf("Time per iteration: %.6e seconds\n\n", (t2 - t1) / it);
+  }
+
+  // Error statistics against the analytical solution, computed on each
+  // process for its own block and then combined
+  double lerr[2] = {0.0, 0.0}; // Maximum and sum of the pointwise error
+  for (int i = 1; i <= lnx; i++) {
+    for (int j = 1; j <= lny; j++) {
+      for (int k = 1; k <= lnz; k++) {
+        double error = fabs(a[i][j][k] - analytical3d((s[0] - 1 + i) * h,
+                                                      (s[1] - 1 + j) * h,
+                                                      (s[2] - 1 + k) * h));
+        lerr[1] += error;
+        if (error > lerr[0]) {
+          lerr[0] = error;
+        }
+      }
+    }
+  }
+  double max_error, sum_error;
+  MPI_Reduce(&lerr[0], &max_error, 1, MPI_DOUBLE, MPI_MAX, 0, cart_comm);
+  MPI_Reduce(&lerr[1], &sum_error, 1, MPI_DOUBLE, MPI_SUM, 0, cart_comm);
+  if (cart_rank == 0) {
+    printf("Error analysis\n");
+    printf("Maximum error: %.8e\n", max_error);
+    printf("Average error: %.8e\n",
+           sum_error / ((double) n[0] * n[1] * n[2]));
+  }
+
+  // Clean up and finalise
+  if (win_a != MPI_WIN_NULL) {
+    MPI_Win_free(&win_a);
+    MPI_Win_free(&win_b);
+  }
+  MPI_Group_free(&cart_group);
+  free_face_types3d(send_types, recv_types, get_types);
+  free(a);
+  free(b);
+  free(f);
+  if (cart_rank == 0) {
+    printf("\n=======================================================\n");
+    printf("                        SUCCESS                        \n");
+    printf("=======================================================\n\n");
+  }
+  MPI_Comm_free(&cart_comm);
+  MPI_Finalize();
+  return 0;
+}